@@ -0,0 +1,52 @@
+//bench_max31856.c
+// Reading n chips: one blocking transaction each (the old path), one polling
+// transaction each, or one queued sweep (max31856_sweep)
+/*
+Runs the real driver against fake_max31856.c with its cost model on the
+virtual clock, so the figures are what that model says, not measurements:
+they show where the time goes (per-transaction overhead vs wire time),
+not what a board will do. Every result's temperature is checked.
+*/
+#include <stdio.h>
+#include "max31856.h"
+#include "fake_max31856.h"
+#include "host_stubs.h"
+
+#define N_CHIPS 8
+
+int main(void)
+{
+    max31856_handle_t h[N_CHIPS];
+    fake_chip_t *c[N_CHIPS];
+    for (int i = 0; i < N_CHIPS; ++i) {
+        c[i] = fake_chip_add(20 + i, -1);
+        max31856_cfg_t cfg = { .cs_pin = 20 + i, .drdy_pin = -1, .tc_type = MAX31856_TC_K, .avg_sel = 1 };
+        if (max31856_add(SPI2_HOST, &cfg, &h[i]) != ESP_OK) return 1;
+        max31856_init(h[i]);
+        fake_conversion(c[i], -18.0f + i, 0);
+    }
+
+    int bad = 0;
+    printf("chips  blocking (old)  polling  queued sweep   (us, fake_max31856.c cost model)\n");
+    for (int n = 1; n <= N_CHIPS; n *= 2) {
+        int64_t us[3];
+        for (int m = 0; m < 3; ++m) {
+            fake_time = m == 0 ? FAKE_TIME_INTERRUPT : FAKE_TIME_POLLING;
+            int64_t t0 = host_now_us;
+            max31856_conv_t cv[N_CHIPS];
+            if (m < 2) {
+                for (int i = 0; i < n; ++i) cv[i].ok = max31856_get_temp_c(h[i], &cv[i].t_c, &cv[i].sr);
+            } else {
+                max31856_sweep(h, n, cv);
+            }
+            us[m] = host_now_us - t0;
+            for (int i = 0; i < n; ++i) {
+                if (!cv[i].ok || cv[i].t_c < -18.01f + i || cv[i].t_c > -17.99f + i) bad++;
+            }
+        }
+        printf("%5d  %11lld     %7lld  %12lld\n", n, (long long)us[0], (long long)us[1], (long long)us[2]);
+    }
+    fake_time = FAKE_TIME_NONE;
+    if (bad || fake_cs_errors) printf("%d bad result(s), %d CS error(s)\n", bad, fake_cs_errors);
+    return bad || fake_cs_errors;
+}
@@ -0,0 +1,120 @@
+//bench_probe.c
+// Time to a selected base at boot: the old one-after-another /health probes
+// vs ep_pick.c's parallel ones, with a slow and a dead server
+/*
+The slow server is standin/ingest_standin.py (its --delay-ms holds every
+answer back); the dead one is a socket here that listens and never
+answers, as a hung LAN server does: connect succeeds, /health times out
+after EP_PICK_TIMEOUT_MS. A refused connection would fail at once and
+flatter the sequential pick. Sequential probes each sink's endpoints in
+priority order until one answers, as pick_base_url did (with the same
+timeout here; it used 8 s). Real time, real sockets; the probe tasks are
+threads.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "ep_pick.h"
+#include "endpoints.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+
+#define DEAD_PORT 18099
+
+static const char *s_host = "127.0.0.1";
+static int s_slow_port = 18080;
+
+typedef enum { SLOW, DEAD } kind_t;
+
+// the endpoint table ep_pick reads: a scenario's servers, in priority order
+static struct { kind_t kind; int sink; } s_ep[EP_MAX];
+static int s_nep;
+int ep_count(void) { return s_nep; }
+int ep_sink(int i) { return s_ep[i].sink; }
+
+// GET /health; true on a 200 within timeout_ms
+static bool probe(int i, int timeout_ms)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_port = htons(s_ep[i].kind == DEAD ? DEAD_PORT : s_slow_port) };
+    inet_pton(AF_INET, s_host, &a.sin_addr);
+    bool ok = false;
+    if (connect(fd, (struct sockaddr *)&a, sizeof(a)) == 0) {
+        static const char req[] = "GET /health HTTP/1.1\r\nHost: bench\r\n\r\n";
+        char resp[256];
+        if (send(fd, req, sizeof(req) - 1, MSG_NOSIGNAL) == (ssize_t)(sizeof(req) - 1) &&
+            recv(fd, resp, sizeof(resp) - 1, 0) >= 12) {
+            ok = strncmp(resp + 9, "200", 3) == 0;
+        }
+    }
+    close(fd);
+    return ok;
+}
+
+// one sink after another, each endpoint in turn until one answers
+static int64_t pick_sequential(int sinks, int *winner)
+{
+    int64_t t0 = esp_timer_get_time();
+    for (int k = 0; k < sinks; ++k) {
+        winner[k] = -1;
+        for (int i = 0; i < s_nep && winner[k] < 0; ++i) {
+            if (s_ep[i].sink == k && probe(i, EP_PICK_TIMEOUT_MS)) winner[k] = i;
+        }
+    }
+    return esp_timer_get_time() - t0;
+}
+
+static void run(const char *name, int sinks, int n, const kind_t *kinds, const int *sink_of)
+{
+    s_nep = n;
+    for (int i = 0; i < n; ++i) { s_ep[i].kind = kinds[i]; s_ep[i].sink = sink_of[i]; }
+    int ws[2], wp[2];
+    int64_t seq = pick_sequential(sinks, ws);
+    int64_t par = ep_pick(probe, sinks, wp);
+    int live = ep_pick_live();
+    char pick[32] = "";
+    for (int k = 0; k < sinks; ++k) {
+        size_t l = strlen(pick);
+        snprintf(pick + l, sizeof(pick) - l, "%s%d", k ? "/" : "", wp[k]);
+        if (ws[k] != wp[k]) snprintf(pick + strlen(pick), sizeof(pick) - strlen(pick), "(seq %d)", ws[k]);
+    }
+    printf("%-26s %8.0f %9.0f   %-8s %d\n", name, seq / 1000.0, par / 1000.0, pick, live);
+    while (ep_pick_live()) vTaskDelay(50);   // the dead probes time out before the next run
+}
+
+int main(int argc, char **argv)
+{
+    // bench_probe [host [slow_port]]
+    if (argc > 1) s_host = argv[1];
+    if (argc > 2) s_slow_port = atoi(argv[2]);
+
+    int dead = socket(AF_INET, SOCK_STREAM, 0), one = 1;
+    setsockopt(dead, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_port = htons(DEAD_PORT) };
+    inet_pton(AF_INET, s_host, &a.sin_addr);
+    if (bind(dead, (struct sockaddr *)&a, sizeof(a)) != 0 || listen(dead, 64) != 0) {
+        perror("dead server");
+        return 1;
+    }
+    s_nep = 1;
+    s_ep[0].kind = SLOW;
+    if (!probe(0, 2000)) {
+        printf("probe: no stand-in on %s:%d\n", s_host, s_slow_port);
+        return 0;
+    }
+
+    printf("endpoints (priority order)  seq ms   par ms   winner   probes left\n");
+    run("dead LAN, slow cloud", 1, 2, (kind_t[]){ DEAD, SLOW }, (int[]){ 0, 0 });
+    run("slow LAN, dead cloud", 1, 2, (kind_t[]){ SLOW, DEAD }, (int[]){ 0, 0 });
+    run("dead, dead", 1, 2, (kind_t[]){ DEAD, DEAD }, (int[]){ 0, 0 });
+    run("2 sinks: dead | slow", 2, 2, (kind_t[]){ DEAD, SLOW }, (int[]){ 0, 1 });
+    run("2 sinks: dead+slow | slow", 2, 3, (kind_t[]){ DEAD, SLOW, SLOW }, (int[]){ 0, 0, 1 });
+    close(dead);
+    return 0;
+}
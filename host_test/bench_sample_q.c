@@ -0,0 +1,158 @@
+//bench_sample_q.c
+// Lock-free sample_q.c against the portMUX ring it replaced, producer vs one consumer
+/*
+The reference ring is the pre-sample_q rb_push / rb_pop (16-byte reading_t
+slots, head/tail under one lock), with portMUX stood in for by a spinlock.
+On the ESP32 taskENTER_CRITICAL also masks interrupts on the calling core,
+so this understates the locked version's cost; the contention pattern
+(both sides serialising on one lock word and one cache line) is the same.
+Both rings get the same capacity. The producer spins while the ring is
+full, so nothing is dropped and both runs move the same readings.
+With fewer than two host cores the contended run mostly measures the
+scheduler (a lock holder can be descheduled, which a critical section on
+the chip cannot be); the one-thread figures are the per-operation cost.
+*/
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sample_q.h"
+#include "fake_spool.h"
+
+#define N_READINGS 100000
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// ---------- reference: the portMUX ring ----------
+static reading_t   s_rb[SQ_CAP];
+static volatile int s_rb_head = 0, s_rb_tail = 0;
+static atomic_flag s_rb_lock = ATOMIC_FLAG_INIT;
+
+static void enter(void) { while (atomic_flag_test_and_set_explicit(&s_rb_lock, memory_order_acquire)) { } }
+static void leave(void) { atomic_flag_clear_explicit(&s_rb_lock, memory_order_release); }
+
+static bool rb_push(reading_t r)
+{
+    enter();
+    int nhead = (s_rb_head + 1) % SQ_CAP;
+    bool full = (nhead == s_rb_tail);
+    if (!full) { s_rb[s_rb_head] = r; s_rb_head = nhead; }
+    leave();
+    return !full;
+}
+
+static bool rb_pop(reading_t *out)
+{
+    enter();
+    bool ok = (s_rb_tail != s_rb_head);
+    if (ok) { *out = s_rb[s_rb_tail]; s_rb_tail = (s_rb_tail + 1) % SQ_CAP; }
+    leave();
+    return ok;
+}
+
+// ---------- the two queues behind one interface ----------
+typedef struct {
+    const char *name;
+    bool (*push)(const reading_t *r);
+    bool (*pop)(reading_t *r);
+} queue_t;
+
+static bool ref_push(const reading_t *r) { return rb_push(*r); }
+static bool ref_pop(reading_t *r) { return rb_pop(r); }
+// sq_push never fails without a spool unless full; the bench keeps it from filling
+static bool sq_push_wait(const reading_t *r) { return sq_count() < SQ_CAP - 1 && sq_push(r); }
+static bool sq_pop0(reading_t *r) { return sq_pop(0, r); }
+
+static const queue_t QUEUES[] = {
+    { "portMUX ring (before)", ref_push, ref_pop },
+    { "sample_q (lock-free)", sq_push_wait, sq_pop0 },
+};
+
+// ---------- measurement ----------
+static const queue_t *s_q;
+static int64_t s_push_ns[N_READINGS];   // per-push latency, including waits for space
+static atomic_int s_go;
+
+static int cmp64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void *producer(void *arg)
+{
+    while (!atomic_load(&s_go)) { }
+    for (int i = 0; i < N_READINGS; ++i) {
+        reading_t r = { .t_c = (i % 4096) / 128.0f, .sr = 0, .ts_ms_utc = 1760000000000LL + i };
+        int64_t t0 = now_ns();
+        while (!s_q->push(&r)) { }
+        s_push_ns[i] = now_ns() - t0;
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    int64_t *bad = arg;
+    while (!atomic_load(&s_go)) { }
+    for (int i = 0; i < N_READINGS; ) {
+        reading_t r;
+        if (!s_q->pop(&r)) continue;
+        if (r.ts_ms_utc != 1760000000000LL + i) (*bad)++;   // FIFO, nothing lost or repeated
+        i++;
+    }
+    return NULL;
+}
+
+static void run(const queue_t *q)
+{
+    pthread_t p, c;
+    int64_t bad = 0;
+    s_q = q;
+    atomic_store(&s_go, 0);
+    pthread_create(&p, NULL, producer, NULL);
+    pthread_create(&c, NULL, consumer, &bad);
+    int64_t t0 = now_ns();
+    atomic_store(&s_go, 1);
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+    int64_t dt = now_ns() - t0;
+
+    qsort(s_push_ns, N_READINGS, sizeof(s_push_ns[0]), cmp64);
+    printf("%-22s %6.1f ns/reading  push p50 %4lld ns  p99 %5lld ns  max %8lld ns  %s\n",
+           q->name, (double)dt / N_READINGS,
+           (long long)s_push_ns[N_READINGS / 2], (long long)s_push_ns[N_READINGS / 100 * 99],
+           (long long)s_push_ns[N_READINGS - 1], bad ? "ORDER BROKEN" : "in order");
+}
+
+// one thread, no contention: the cost of the operations themselves
+static void run_uncontended(const queue_t *q)
+{
+    enum { ROUNDS = 4000000 };
+    reading_t r = { .t_c = 1.0f, .ts_ms_utc = 1760000000000LL };
+    int64_t t0 = now_ns();
+    for (int i = 0; i < ROUNDS; ++i) {
+        q->push(&r);
+        q->pop(&r);
+    }
+    printf("%-22s %6.1f ns per push+pop, one thread\n", q->name, (double)(now_ns() - t0) / ROUNDS);
+}
+
+int main(void)
+{
+    sq_init(1);
+    printf("%d readings, capacity %d, producer and consumer on their own threads (%ld core(s))\n",
+           N_READINGS, SQ_CAP, sysconf(_SC_NPROCESSORS_ONLN));
+    for (size_t i = 0; i < sizeof(QUEUES) / sizeof(QUEUES[0]); ++i) run(&QUEUES[i]);
+    for (size_t i = 0; i < sizeof(QUEUES) / sizeof(QUEUES[0]); ++i) run_uncontended(&QUEUES[i]);
+    return 0;
+}
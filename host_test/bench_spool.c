@@ -0,0 +1,119 @@
+//bench_spool.c
+// Sustained append/drain through spool.c over fake_flash.c's partition, the
+// size of the real one (256 KB): host time, flash operations and the chip's
+// modeled flash time per reading
+/*
+Each row appends N_READINGS readings and drains them through every sink,
+peeking and committing `batch` at a time as sample_q.c does for an upload.
+"steady" drains after every batch, so the ring stays nearly empty; "backlog"
+fills three quarters of the ring first (an outage) and then drains it while
+appends go on; "overrun" appends a full ring and a half with nothing
+drained, so every sector entry drops one (the drain then gets what's left).
+The modeled flash time is fake_flash.c's cost model, not a measurement:
+what matters is the split between erases, programs and reads.
+*/
+#include <stdio.h>
+#include <time.h>
+#include "spool.h"
+#include "fake_flash.h"
+
+#define SECTORS     64   // partitions.csv: spool, 256K
+#define N_READINGS  100000
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+typedef struct { int64_t ns; fake_flash_ops_t ops; } phase_t;
+
+static void add_ops(phase_t *p, const fake_flash_ops_t *a, const fake_flash_ops_t *b, int64_t ns)
+{
+    p->ns += ns;
+    p->ops.reads += b->reads - a->reads;
+    p->ops.writes += b->writes - a->writes;
+    p->ops.erases += b->erases - a->erases;
+    p->ops.model_us += b->model_us - a->model_us;
+}
+
+static void append_n(phase_t *p, int n, int *next)
+{
+    fake_flash_ops_t a = fake_flash_ops;
+    int64_t t0 = now_ns();
+    for (int i = 0; i < n; ++i) {
+        reading_t r = { .t_c = 21.5f, .ts_ms_utc = 1700000000000LL + *next };
+        (*next)++;
+        spool_append(&r);
+    }
+    add_ops(p, &a, &fake_flash_ops, now_ns() - t0);
+}
+
+// up to max readings through each sink; how many the last sink took
+static int drain_n(phase_t *p, int sinks, int batch, int max)
+{
+    reading_t out[SPOOL_PEEK_MAX];
+    fake_flash_ops_t a = fake_flash_ops;
+    int64_t t0 = now_ns();
+    int total = 0;
+    for (int k = 0; k < sinks; ++k) {
+        int n;
+        total = 0;
+        while (total < max && (n = spool_peek_n(k, out, batch < max - total ? batch : max - total)) > 0) {
+            spool_commit_n(k, n);
+            total += n;
+        }
+    }
+    add_ops(p, &a, &fake_flash_ops, now_ns() - t0);
+    return total;
+}
+
+static void row(const char *name, int sinks, int batch, int prefill, int overrun)
+{
+    fake_flash_init(SECTORS, false);
+    spool_init(sinks);
+    spool_stats_t s0;
+    spool_get_stats(&s0);
+
+    phase_t ap = {0}, dr = {0};
+    int next = 0;
+    if (overrun) {
+        append_n(&ap, overrun, &next);
+        while (drain_n(&dr, sinks, batch, 1 << 30) > 0) { }
+    } else {
+        append_n(&ap, prefill, &next);
+        while (next < N_READINGS) {
+            append_n(&ap, batch, &next);
+            drain_n(&dr, sinks, batch, 2 * batch);
+        }
+        while (drain_n(&dr, sinks, batch, 1 << 30) > 0) { }
+    }
+    spool_stats_t s1;
+    spool_get_stats(&s1);
+    uint32_t app = s1.appended - s0.appended, out = s1.drained - s0.drained;
+
+    printf("%-8s %d %3d  %9.0f %9.0f   %4.2f %4.2f %6.4f   %4.2f %4.2f   %6.1f %6.1f   %u\n",
+           name, sinks, batch,
+           app * 1e9 / ap.ns, out ? out * 1e9 / dr.ns : 0.0,
+           (double)ap.ops.writes / app, (double)ap.ops.reads / app, (double)ap.ops.erases / app,
+           out ? (double)dr.ops.reads / out : 0.0, out ? (double)dr.ops.writes / out : 0.0,
+           (double)ap.ops.model_us / app, out ? (double)dr.ops.model_us / out : 0.0,
+           (unsigned)(s1.dropped - s0.dropped));
+}
+
+int main(void)
+{
+    const int slots = SECTORS * 128;
+    printf("%d readings, %d-slot ring\n", N_READINGS, slots);
+    printf("                 host readings/s       append / reading     drain / reading   flash us / reading\n");
+    printf("run   sinks batch    append     drain   wr   rd   erase      rd   wr      append  drain    dropped\n");
+    row("steady", 1, 1, 0, 0);
+    row("steady", 1, 8, 0, 0);
+    row("steady", 1, 64, 0, 0);
+    row("steady", 2, 8, 0, 0);
+    row("backlog", 1, 64, slots * 3 / 4, 0);
+    row("backlog", 2, 64, slots * 3 / 4, 0);
+    row("overrun", 1, 64, 0, slots * 3 / 2);
+    return 0;
+}
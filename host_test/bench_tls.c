@@ -0,0 +1,131 @@
+//bench_tls.c
+// Full vs resumed TLS handshakes against the stand-in's HTTPS port, the way
+// the HTTP session reconnects to a TLS base: request start -> connected
+/*
+The firmware's client is esp_http_client over mbedTLS, TLS 1.2, with
+save_client_session: the transport keeps the server's session ticket and
+the next connect after a close offers it. Here OpenSSL plays the client
+(mbedTLS has no headers on the dev container): each connect is a fresh
+socket, verified against the stand-in's certificate, then one GET /health
+and a close, as http_session_close leaves it. "full" never offers a
+session; "resumed" offers the one from the previous connect and checks
+the server took it. Loopback, so the times are CPU (key exchange,
+signature, certificate check) and the round trips cost nothing; a
+resumed TLS 1.2 handshake also saves one round trip of the two.
+*/
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include "esp_timer.h"
+
+#define N_CONNECTS 100
+
+static const char *s_host = "127.0.0.1";
+static int s_port = 18443;
+static const char *s_ca = "build/standin.crt";
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// One connect + GET /health; the times and handshake bytes, false on an error
+static bool once(SSL_CTX *ctx, SSL_SESSION **sess, bool resume, int64_t *conn_us, int64_t *req_us,
+                 long *hs_bytes, bool *reused)
+{
+    int64_t t0 = esp_timer_get_time();
+    int fd = socket(AF_INET, SOCK_STREAM, 0), one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_port = htons(s_port) };
+    inet_pton(AF_INET, s_host, &a.sin_addr);
+    if (connect(fd, (struct sockaddr *)&a, sizeof(a)) != 0) { close(fd); return false; }
+
+    SSL *ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    SSL_set1_host(ssl, s_host);
+    if (resume && *sess) SSL_set_session(ssl, *sess);
+    bool ok = SSL_connect(ssl) == 1;
+    if (ok) {
+        *conn_us = esp_timer_get_time() - t0;
+        *hs_bytes = BIO_number_read(SSL_get_rbio(ssl)) + BIO_number_written(SSL_get_wbio(ssl));
+        *reused = SSL_session_reused(ssl);
+
+        static const char req[] = "GET /health HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+        char resp[512];
+        ok = SSL_write(ssl, req, sizeof(req) - 1) == (int)sizeof(req) - 1 &&
+             SSL_read(ssl, resp, sizeof(resp) - 1) >= 12 && strncmp(resp + 9, "200", 3) == 0;
+        *req_us = esp_timer_get_time() - t0;
+        // TLS 1.2 hands the ticket over in the handshake: the session is complete here
+        if (ok && resume) {
+            SSL_SESSION_free(*sess);
+            *sess = SSL_get1_session(ssl);
+        }
+        SSL_shutdown(ssl);
+    }
+    SSL_free(ssl);
+    close(fd);
+    return ok;
+}
+
+static void run(SSL_CTX *ctx, const char *name, bool resume)
+{
+    static int64_t conn[N_CONNECTS], req[N_CONNECTS];
+    SSL_SESSION *sess = NULL;
+    long bytes = 0, b;
+    int reused = 0, n = 0;
+    if (resume) {
+        int64_t c, r;
+        bool ru;
+        if (!once(ctx, &sess, true, &c, &r, &b, &ru)) { printf("%s: first connect failed\n", name); return; }
+    }
+    for (int i = 0; i < N_CONNECTS; ++i) {
+        bool ru = false;
+        if (!once(ctx, &sess, resume, &conn[n], &req[n], &b, &ru)) {
+            printf("%s: connect %d failed\n", name, i);
+            ERR_print_errors_fp(stdout);
+            break;
+        }
+        bytes += b;
+        reused += ru;
+        n++;
+    }
+    SSL_SESSION_free(sess);
+    if (!n) return;
+    qsort(conn, (size_t)n, sizeof(conn[0]), cmp_i64);
+    qsort(req, (size_t)n, sizeof(req[0]), cmp_i64);
+    printf("%-8s %4d   %3d   %6.2f %6.2f   %6.2f %6.2f   %6ld\n", name, n, reused,
+           conn[n / 2] / 1000.0, conn[n * 99 / 100] / 1000.0, req[n / 2] / 1000.0, req[n * 99 / 100] / 1000.0,
+           bytes / n);
+}
+
+int main(int argc, char **argv)
+{
+    // bench_tls [host [port [ca_file]]]
+    if (argc > 1) s_host = argv[1];
+    if (argc > 2) s_port = atoi(argv[2]);
+    if (argc > 3) s_ca = argv[3];
+
+    SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);   // CONFIG_MBEDTLS_SSL_PROTO_TLS1_2 only
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    if (SSL_CTX_load_verify_locations(ctx, s_ca, NULL) != 1) {
+        printf("tls: no stand-in certificate at %s\n", s_ca);
+        return 0;
+    }
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, NULL);
+
+    printf("         conn  resumed  connect ms     request ms    handshake B\n");
+    printf("                         p50    p99     p50    p99\n");
+    run(ctx, "full", false);
+    run(ctx, "resumed", true);
+    SSL_CTX_free(ctx);
+    return 0;
+}
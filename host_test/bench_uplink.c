@@ -0,0 +1,237 @@
+//bench_uplink.c
+// Drains one backlog through each uplink against standin/ingest_standin.py:
+// HTTP stop-and-wait keep-alive POSTs (what upl_flush does, per sample to
+// /ingest and in batches to /ingest/batch) vs the real
+// windowed MQTT publisher, WebSocket streamer and CoAP client (mqtt_up.c /
+// ws_up.c / coap_up.c + ack_win.c over shim_mqtt.c / shim_ws.c / host UDP)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "sample_q.h"
+#include "ingest_enc.h"
+#include "mqtt_up.h"
+#include "ws_up.h"
+#include "coap_up.h"
+#include "dns_cache.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "fake_spool.h"
+
+#define N_READINGS 1000
+#define HTTP_BATCH 8          // INGEST_BATCH_MAX
+#define DEVICE_ID  "esp32-0123456789AB"
+
+static const char *s_host = "127.0.0.1";
+static const char *s_http_port = "18080";
+static const char *s_mqtt_port = "11883";
+static const char *s_ws_port = "18081";
+static const char *s_coap_port = "15683";
+
+// mqtt_up_probe's and coap_up's resolver; the bench only uses IP literals
+bool dns_cache_lookup(const char *host, char *ip, size_t n) { snprintf(ip, n, "%s", host); return true; }
+void dns_cache_expire(const char *host) { }
+
+static void fill(void)
+{
+    int64_t ts = 1760000000000LL;
+    for (int i = 0; i < N_READINGS; ++i) {
+        reading_t r = { .t_c = -18.0f + (i % 7) * 0.0625f, .ts_ms_utc = ts };
+        ts += 15000;
+        sq_push(&r);
+    }
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report(const char *name, int64_t dt_us, int msgs, long bytes, int64_t *lat, int nlat)
+{
+    printf("%-6s %5d readings in %4d msg(s), %7ld B, %7.1f ms total, %7.0f readings/s",
+           name, N_READINGS, msgs, bytes, dt_us / 1000.0, N_READINGS * 1e6 / (double)dt_us);
+    if (nlat) {
+        qsort(lat, (size_t)nlat, sizeof(lat[0]), cmp_i64);
+        printf(", per msg p50 %.1f ms p99 %.1f ms", lat[nlat / 2] / 1000.0, lat[nlat * 99 / 100] / 1000.0);
+    }
+    printf("\n");
+}
+
+static int tcp_connect(const char *port)
+{
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM }, *res;
+    if (getaddrinfo(s_host, port, &hints, &res) != 0) return -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, res->ai_addr, res->ai_addrlen) != 0) { close(fd); fd = -1; }
+    freeaddrinfo(res);
+    return fd;
+}
+
+// One POST to path on the keep-alive connection; the status, or -1
+static int http_post(int fd, const char *path, const char *body, int len)
+{
+    char req[INGEST_JSON_MAX(HTTP_BATCH) + 512];
+    int n = snprintf(req, sizeof(req),
+                     "POST %s HTTP/1.1\r\nUser-Agent: ESP32 HTTP Client/1.0\r\nHost: %s:%s\r\n"
+                     "X-API-Key: super_secret_key_here\r\nContent-Type: application/json\r\n"
+                     "Content-Length: %d\r\n\r\n%.*s", path, s_host, s_http_port, len, len, body);
+    if (send(fd, req, (size_t)n, MSG_NOSIGNAL) != n) return -1;
+
+    // headers, then Content-Length bytes of body
+    char resp[1024];
+    int got = 0, hdr = -1;
+    while (hdr < 0) {
+        ssize_t k = recv(fd, resp + got, sizeof(resp) - 1 - (size_t)got, 0);
+        if (k <= 0) return -1;
+        got += (int)k;
+        resp[got] = 0;
+        char *e = strstr(resp, "\r\n\r\n");
+        if (e) hdr = (int)(e - resp) + 4;
+    }
+    const char *cl = strstr(resp, "Content-Length:");
+    int body_len = cl ? atoi(cl + 15) : 0;
+    while (got < hdr + body_len) {
+        ssize_t k = recv(fd, resp + got, sizeof(resp) - 1 - (size_t)got, 0);
+        if (k <= 0) return -1;
+        got += (int)k;
+    }
+    return atoi(resp + 9);
+}
+
+// batch readings per POST: 1 to /ingest (INGEST_BATCH_MAX 1, the legacy
+// path), more to /ingest/batch
+static void bench_http(const char *name, const char *path, int batch)
+{
+    int fd = tcp_connect(s_http_port);
+    if (fd < 0) { printf("%s: no stand-in on %s:%s\n", name, s_host, s_http_port); return; }
+    fill();
+    static int64_t lat[N_READINGS];
+    int posts = 0;
+    long bytes = 0;
+    reading_t rs[HTTP_BATCH];
+    char body[INGEST_JSON_MAX(HTTP_BATCH)];
+    int64_t t0 = esp_timer_get_time();
+    int n;
+    while ((n = sq_peek_n(0, rs, batch)) > 0) {
+        int len = ingest_enc_json(body, sizeof(body), DEVICE_ID, rs, n);
+        int64_t tr = esp_timer_get_time();
+        int sc = http_post(fd, path, body, len);
+        lat[posts++] = esp_timer_get_time() - tr;
+        bytes += len;
+        if (sc != 200) { printf("%s: POST failed (%d)\n", name, sc); sq_abort(0); break; }
+        sq_commit_n(0, n);
+    }
+    report(name, esp_timer_get_time() - t0, posts, bytes, lat, posts);
+    close(fd);
+}
+
+static long s_enc_bytes;   // body bytes the transport under test encoded
+
+static int enc_json(uint8_t *dst, size_t cap, const reading_t *rs, int n)
+{
+    int len = ingest_enc_json((char *)dst, cap, DEVICE_ID, rs, n);
+    if (len > 0) s_enc_bytes += len;
+    return len;
+}
+
+static void bench_mqtt(void)
+{
+    char base[64];
+    snprintf(base, sizeof(base), "mqtt://%s:%s", s_host, s_mqtt_port);
+    mqtt_up_cfg_t cfg = {
+        .base = base, .client_id = DEVICE_ID "-0", .username = DEVICE_ID,
+        .password = "super_secret_key_here", .topic = "freezer/" DEVICE_ID "/ingest", .enc = enc_json,
+    };
+    if (!mqtt_up_open(0, &cfg) || !mqtt_up_connected(0, 2000)) {
+        printf("mqtt:  no stand-in on %s\n", base);
+        mqtt_up_close(0);
+        return;
+    }
+    fill();
+    s_enc_bytes = 0;
+    int msgs = 0;
+    int64_t t0 = esp_timer_get_time();
+    while (sq_count_sink(0) > 0) {
+        int m, sent = mqtt_up_flush(0, &m);
+        msgs += m;
+        if (sent < 0) { printf("mqtt:  flush failed\n"); break; }
+    }
+    report("mqtt", esp_timer_get_time() - t0, msgs, s_enc_bytes, NULL, 0);
+    mqtt_up_log_stats(0);   // per-publish ack times (avg / max)
+    mqtt_up_close(0);
+}
+
+// JSON in text frames, as the firmware sends with INGEST_FMT_JSON
+static void bench_ws(void)
+{
+    char uri[96];
+    snprintf(uri, sizeof(uri), "ws://%s:%s/ingest/ws", s_host, s_ws_port);
+    ws_up_cfg_t cfg = { .uri = uri, .headers = "X-API-Key: super_secret_key_here\r\n", .text = true, .enc = enc_json };
+    if (!ws_up_open(0, &cfg) || !ws_up_connected(0, 2000)) {
+        printf("ws:    no stand-in on %s\n", uri);
+        ws_up_close(0);
+        return;
+    }
+    fill();
+    s_enc_bytes = 0;
+    int frames = 0;
+    int64_t t0 = esp_timer_get_time();
+    while (sq_count_sink(0) > 0) {
+        int f, sent = ws_up_flush(0, &f);
+        frames += f;
+        if (sent < 0) { printf("ws:    flush failed\n"); break; }
+    }
+    report("ws", esp_timer_get_time() - t0, frames, s_enc_bytes, NULL, 0);
+    ws_up_log_stats(0);
+    ws_up_close(0);
+}
+
+// JSON CON POSTs to ingest/batch, as the firmware's CoAP sinks send with INGEST_FMT_JSON
+static void bench_coap(void)
+{
+    char base[64];
+    snprintf(base, sizeof(base), "coap://%s:%s", s_host, s_coap_port);
+    coap_up_cfg_t cfg = { .base = base, .path = "ingest/batch", .json = true, .enc = enc_json };
+    if (!coap_up_open(0, &cfg) || !coap_up_ping(0, 2000)) {
+        printf("coap:  no stand-in on %s\n", base);
+        coap_up_close(0);
+        return;
+    }
+    fill();
+    s_enc_bytes = 0;
+    int msgs = 0;
+    int64_t t0 = esp_timer_get_time();
+    while (sq_count_sink(0) > 0) {
+        int m, sent = coap_up_flush(0, &m);
+        msgs += m;
+        if (sent < 0) { printf("coap:  flush failed\n"); break; }
+    }
+    report("coap", esp_timer_get_time() - t0, msgs, s_enc_bytes, NULL, 0);
+    coap_up_log_stats(0);   // datagrams per message, retransmits, separate responses
+    coap_up_close(0);
+}
+
+int main(int argc, char **argv)
+{
+    // bench_uplink [host [http_port [mqtt_port [ws_port [coap_port]]]]]
+    if (argc > 1) s_host = argv[1];
+    if (argc > 2) s_http_port = argv[2];
+    if (argc > 3) s_mqtt_port = argv[3];
+    if (argc > 4) s_ws_port = argv[4];
+    if (argc > 5) s_coap_port = argv[5];
+    fake_spool_reset(1);
+    sq_init(1);
+    bench_http("http1", "/ingest", 1);
+    bench_http("http8", "/ingest/batch", HTTP_BATCH);
+    bench_mqtt();
+    bench_ws();
+    bench_coap();
+    return 0;
+}
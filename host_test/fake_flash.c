@@ -0,0 +1,104 @@
+//fake_flash.c
+// A "spool" data partition in RAM with NOR flash semantics, for spool.c's host tests
+/*
+As on the chip's SPI flash: an erase sets a whole 4 KB sector to 0xFF and
+must be sector-aligned; a write can only clear bits (the stored byte is
+the old one AND the new one), so writing twice without an erase shows up
+as corrupted data instead of silently working. Reads and writes must stay
+inside the partition. A torn write (fake_flash_tear) is a power cut in
+the middle of a program: a prefix of the bytes lands, nothing after.
+
+model_us is what the same operations would keep an ESP32-S3's SPI NOR
+busy, from typical datasheet figures for its 4 MB/8 MB parts (W25Q/GD25Q
+class): a 4 KB sector erase ~45 ms, a program ~30 us of command and
+status polling plus ~2.5 us a byte, a read ~5 us plus ~0.1 us a byte at
+80 MHz QIO. A model, not a measurement: the worst-case erase is ~10x the
+typical one, and the cache-disable around each operation is left out.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "fake_flash.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+#define MODEL_ERASE_US        45000
+#define MODEL_PROG_US         30
+#define MODEL_PROG_NS_BYTE    2500
+#define MODEL_READ_US         5
+#define MODEL_READ_NS_BYTE    100
+
+fake_flash_ops_t fake_flash_ops;
+bool fake_flash_present = true;
+int  fake_flash_tear = -1;
+
+static esp_partition_t s_part = { .type = ESP_PARTITION_TYPE_DATA, .erase_size = FAKE_FLASH_SECTOR, .label = "spool" };
+static uint8_t *s_data;
+static bool s_dead;   // power cut: writes fail until the next init
+
+void fake_flash_init(int sectors, bool keep)
+{
+    uint32_t size = (uint32_t)sectors * FAKE_FLASH_SECTOR;
+    if (!keep || size != s_part.size) {
+        free(s_data);
+        s_data = malloc(size);
+        memset(s_data, 0xFF, size);
+        s_part.size = size;
+    }
+    memset(&fake_flash_ops, 0, sizeof(fake_flash_ops));
+    fake_flash_tear = -1;
+    s_dead = false;
+}
+
+uint8_t *fake_flash_data(void) { return s_data; }
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+    return fake_flash_present && s_data && strcmp(label, s_part.label) == 0 ? &s_part : NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *p, size_t off, void *dst, size_t len)
+{
+    if (off + len > p->size) return ESP_ERR_INVALID_SIZE;
+    memcpy(dst, s_data + off, len);
+    fake_flash_ops.reads++;
+    fake_flash_ops.read_bytes += len;
+    fake_flash_ops.model_us += MODEL_READ_US + (int64_t)len * MODEL_READ_NS_BYTE / 1000;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *p, size_t off, const void *src, size_t len)
+{
+    if (off + len > p->size) return ESP_ERR_INVALID_SIZE;
+    if (s_dead) return ESP_FAIL;
+    if (fake_flash_tear >= 0 && (size_t)fake_flash_tear < len) {
+        len = (size_t)fake_flash_tear;
+        s_dead = true;
+    }
+    const uint8_t *b = src;
+    for (size_t i = 0; i < len; ++i) s_data[off + i] &= b[i];
+    fake_flash_ops.writes++;
+    fake_flash_ops.write_bytes += len;
+    fake_flash_ops.model_us += MODEL_PROG_US + (int64_t)len * MODEL_PROG_NS_BYTE / 1000;
+    return s_dead ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *p, size_t off, size_t len)
+{
+    if (off % FAKE_FLASH_SECTOR || len % FAKE_FLASH_SECTOR || off + len > p->size) return ESP_ERR_INVALID_ARG;
+    if (s_dead) return ESP_FAIL;
+    memset(s_data + off, 0xFF, len);
+    fake_flash_ops.erases += (uint32_t)(len / FAKE_FLASH_SECTOR);
+    fake_flash_ops.model_us += (int64_t)(len / FAKE_FLASH_SECTOR) * MODEL_ERASE_US;
+    return ESP_OK;
+}
+
+// the ROM's: reflected 0xEDB88320, inverted in and out (crc 0 = a fresh CRC-32)
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; ++k) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
@@ -0,0 +1,27 @@
+//fake_flash.h
+// A "spool" data partition in RAM with NOR flash semantics, for spool.c's host tests
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FAKE_FLASH_SECTOR 4096
+
+// What the partition has been asked to do since fake_flash_init, and how
+// long the chip's flash would have been busy with it (fake_flash.c's model)
+typedef struct {
+    uint32_t reads, writes, erases;
+    uint64_t read_bytes, write_bytes;
+    int64_t  model_us;
+} fake_flash_ops_t;
+
+extern fake_flash_ops_t fake_flash_ops;
+extern bool fake_flash_present;   // false: esp_partition_find_first finds nothing
+extern int  fake_flash_tear;      // >= 0: the next write stores only this many bytes, then
+                                  // every write fails (the power is gone until fake_flash_init)
+
+// A fresh partition of `sectors` erased sectors (or, with keep, the same
+// contents after a power cycle: only the counters and the tear reset)
+void fake_flash_init(int sectors, bool keep);
+// The partition's bytes, for a test to inspect or corrupt
+uint8_t *fake_flash_data(void);
@@ -0,0 +1,290 @@
+//fake_max31856.c
+// MAX31856 chips on a fake SPI bus and GPIO matrix, for the driver's host tests
+/*
+The bus runs a transaction as the real one does with software CS: pre_cb,
+the bytes, post_cb. The chip addressed is whichever has its CS pin low;
+none or several is counted as an error and the bytes go nowhere. Register
+access follows the datasheet: bit 7 of the first byte = write, the address
+auto-increments, reading a temperature byte releases DRDY. GPIO interrupts
+fire as the pin controller would: an edge type once per transition, a
+level type for as long as the level holds and the interrupt is enabled.
+Queued transactions run when queued; results come back in order.
+
+With fake_time set, transactions advance the virtual clock by a cost model
+(ESP32-S3 at 160 MHz, ballpark, not measured): the wire time is the bit
+count at 1 MHz; a polling transaction adds 5 us of setup, an interrupt
+one (the pre-sweep blocking path) 25 us of queueing, ISR and task wake.
+Queued: 4 us per enqueue, 3 us of ISR between back-to-back transactions,
+and one 15 us task wake when a result has to be waited for.
+*/
+#include <string.h>
+#include "fake_max31856.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "esp_sleep.h"
+#include "hal/gpio_ll.h"
+#include "freertos/task.h"
+#include "host_stubs.h"
+
+#define NPINS 64
+
+int      fake_cs_errors;
+int      fake_isr_calls;
+int      fake_isr_storms;
+uint32_t fake_notify_bits;
+int      fake_spi_fail;
+int      fake_spi_pass;
+int      fake_devices;
+bool     fake_sleep_wakeup;
+int      fake_isr_unsafe;
+int      fake_hw_cs;
+fake_time_t fake_time;
+
+static fake_chip_t s_chips[FAKE_MAX_CHIPS];
+static int s_nchips;
+
+typedef struct {
+    int             level;
+    gpio_int_type_t type;
+    bool            en;
+    gpio_isr_t      fn;
+    void           *arg;
+    gpio_int_type_t wakeup;
+} pin_t;
+static pin_t s_pins[NPINS];
+static bool s_pins_init;
+static bool s_in_isr;   // in an SPI callback or a GPIO ISR
+
+static spi_device_interface_config_t s_dev;
+static spi_transaction_t *s_done[16];
+static int64_t s_done_us[16];   // when the bus finishes it
+static int s_ndone;
+static int64_t s_busy_until;
+
+gpio_dev_t GPIO;
+
+static pin_t *pin(int p)
+{
+    if (!s_pins_init) {
+        for (int i = 0; i < NPINS; ++i) s_pins[i].level = 1;   // pulled up
+        s_pins_init = true;
+    }
+    return &s_pins[p];
+}
+
+// the interrupt controller after a change of the pin, its type or its enable
+static void pin_eval(int p, bool fell)
+{
+    pin_t *g = pin(p);
+    for (int k = 0; g->en && g->fn; ++k) {
+        bool pending = (g->type == GPIO_INTR_LOW_LEVEL && g->level == 0) ||
+                       (g->type == GPIO_INTR_HIGH_LEVEL && g->level == 1) ||
+                       (k == 0 && fell && (g->type == GPIO_INTR_NEGEDGE || g->type == GPIO_INTR_ANYEDGE));
+        if (!pending) return;
+        if (k == FAKE_ISR_MAX) { fake_isr_storms++; return; }
+        fake_isr_calls++;
+        s_in_isr = true;
+        g->fn(g->arg);
+        s_in_isr = false;
+        if (g->type != GPIO_INTR_LOW_LEVEL && g->type != GPIO_INTR_HIGH_LEVEL) return;
+    }
+}
+
+static void pin_drive(int p, int level)
+{
+    if (p < 0) return;
+    bool fell = pin(p)->level == 1 && level == 0;
+    pin(p)->level = level;
+    pin_eval(p, fell);
+}
+
+fake_chip_t *fake_chip_add(int cs_pin, int drdy_pin)
+{
+    static const uint8_t por[16] = { 0x00, 0x03, 0xFF, 0x7F, 0xC0, 0x7F, 0xFF, 0x80, 0x00 };
+    fake_chip_t *c = &s_chips[s_nchips++];
+    memset(c, 0, sizeof(*c));
+    c->cs_pin = cs_pin;
+    c->drdy_pin = drdy_pin;
+    memcpy(c->regs, por, sizeof(por));
+    return c;
+}
+
+void fake_conversion(fake_chip_t *c, float t_c, uint8_t sr)
+{
+    int32_t raw = (int32_t)(t_c * 128.0f + (t_c < 0 ? -0.5f : 0.5f));   // 19 bits, 1/128 °C
+    uint32_t v = ((uint32_t)raw & 0x7FFFF) << 5;
+    c->regs[0x0C] = (uint8_t)(v >> 16);
+    c->regs[0x0D] = (uint8_t)(v >> 8);
+    c->regs[0x0E] = (uint8_t)v;
+    c->regs[0x0F] = sr;
+    c->regs[0x00] &= (uint8_t)~0x40;   // 1SHOT clears when the conversion is done
+    c->drdy_low = true;
+    pin_drive(c->drdy_pin, 0);
+}
+
+int fake_pin_level(int p) { return pin(p)->level; }
+int fake_pin_intr_type(int p) { return pin(p)->type; }
+bool fake_pin_intr_enabled(int p) { return pin(p)->en; }
+int fake_pin_wakeup_type(int p) { return pin(p)->wakeup; }
+int fake_spi_pending(void) { return s_ndone; }
+
+// ---- GPIO ----
+esp_err_t gpio_config(const gpio_config_t *cfg)
+{
+    for (int p = 0; p < NPINS; ++p) {
+        if (!(cfg->pin_bit_mask & (1ULL << p))) continue;
+        pin(p)->type = cfg->intr_type;
+        pin(p)->en = cfg->intr_type != GPIO_INTR_DISABLE;   // as IDF's gpio_config
+    }
+    return ESP_OK;
+}
+esp_err_t gpio_set_level(gpio_num_t p, uint32_t level)
+{
+    if (s_in_isr) fake_isr_unsafe++;
+    pin(p)->level = level ? 1 : 0;
+    return ESP_OK;
+}
+int gpio_get_level(gpio_num_t p) { return pin(p)->level; }
+esp_err_t gpio_install_isr_service(int flags) { return ESP_OK; }
+esp_err_t gpio_isr_handler_add(gpio_num_t p, gpio_isr_t fn, void *arg)
+{
+    pin(p)->fn = fn;
+    pin(p)->arg = arg;
+    return ESP_OK;
+}
+esp_err_t gpio_set_intr_type(gpio_num_t p, gpio_int_type_t type)
+{
+    pin(p)->type = type;
+    pin_eval(p, false);
+    return ESP_OK;
+}
+esp_err_t gpio_intr_enable(gpio_num_t p)
+{
+    if (s_in_isr) fake_isr_unsafe++;
+    pin(p)->en = true;
+    pin_eval(p, false);
+    return ESP_OK;
+}
+esp_err_t gpio_intr_disable(gpio_num_t p)
+{
+    if (s_in_isr) fake_isr_unsafe++;
+    pin(p)->en = false;
+    return ESP_OK;
+}
+// as IDF: the wakeup level becomes the pin's interrupt type too
+esp_err_t gpio_wakeup_enable(gpio_num_t p, gpio_int_type_t type)
+{
+    pin(p)->wakeup = type;
+    return gpio_set_intr_type(p, type);
+}
+esp_err_t esp_sleep_enable_gpio_wakeup(void)
+{
+    fake_sleep_wakeup = true;
+    return ESP_OK;
+}
+void gpio_ll_intr_disable(gpio_dev_t *hw, uint32_t p) { pin((int)p)->en = false; }
+void gpio_ll_wakeup_disable(gpio_dev_t *hw, uint32_t p) { pin((int)p)->wakeup = GPIO_INTR_DISABLE; }
+void gpio_ll_set_level(gpio_dev_t *hw, uint32_t p, uint32_t level) { pin((int)p)->level = level ? 1 : 0; }
+
+// ---- FreeRTOS ----
+BaseType_t xTaskNotifyFromISR(TaskHandle_t t, uint32_t value, eNotifyAction action, BaseType_t *woken)
+{
+    fake_notify_bits |= value;
+    if (woken) *woken = pdTRUE;
+    return pdPASS;
+}
+void vTaskDelay(TickType_t ticks) { host_now_us += (int64_t)ticks * 1000; }
+
+// ---- SPI ----
+static fake_chip_t *selected(void)
+{
+    fake_chip_t *sel = NULL;
+    int n = 0;
+    for (int i = 0; i < s_nchips; ++i) {
+        if (pin(s_chips[i].cs_pin)->level == 0) { sel = &s_chips[i]; n++; }
+    }
+    if (n != 1) { fake_cs_errors++; return NULL; }
+    return sel;
+}
+
+static esp_err_t run(spi_transaction_t *t)
+{
+    if (fake_spi_pass > 0) fake_spi_pass--;
+    else if (fake_spi_fail > 0) { fake_spi_fail--; return ESP_FAIL; }
+    s_in_isr = true;
+    if (s_dev.pre_cb) s_dev.pre_cb(t);
+    s_in_isr = false;
+    fake_chip_t *c = selected();
+    size_t n = t->length / 8;
+    const uint8_t *tx = t->tx_buffer;
+    uint8_t *rx = t->rx_buffer;
+    if (c && n) {
+        uint8_t a = tx[0] & 0x7F;
+        if (tx[0] & 0x80) {
+            c->writes++;
+            for (size_t i = 1; i < n; ++i) {
+                uint8_t r = (uint8_t)((a + i - 1) & 0x0F), v = tx[i];
+                if (r == 0x00) {
+                    if (v & 0x40) c->one_shots++;
+                    v &= (uint8_t)~0x02;   // FAULTCLR clears itself
+                }
+                c->regs[r] = v;
+            }
+        } else {
+            c->reads++;
+            if (rx) rx[0] = 0;
+            for (size_t i = 1; i < n; ++i) {
+                uint8_t r = (uint8_t)((a + i - 1) & 0x0F);
+                if (rx) rx[i] = c->regs[r];
+                if (r >= 0x0C && r <= 0x0E && c->drdy_low) {
+                    c->drdy_low = false;
+                    pin_drive(c->drdy_pin, 1);
+                }
+            }
+        }
+    }
+    s_in_isr = true;
+    if (s_dev.post_cb) s_dev.post_cb(t);
+    s_in_isr = false;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *cfg, spi_device_handle_t *out)
+{
+    s_dev = *cfg;
+    fake_devices++;
+    fake_hw_cs = cfg->spics_io_num;
+    *out = (spi_device_handle_t)&s_dev;
+    return ESP_OK;
+}
+static esp_err_t single(spi_transaction_t *t)
+{
+    if (fake_time != FAKE_TIME_NONE) host_now_us += (fake_time == FAKE_TIME_POLLING ? 5 : 25) + (int64_t)t->length;
+    return run(t);
+}
+esp_err_t spi_device_polling_transmit(spi_device_handle_t d, spi_transaction_t *t) { return single(t); }
+esp_err_t spi_device_transmit(spi_device_handle_t d, spi_transaction_t *t) { return single(t); }
+esp_err_t spi_device_queue_trans(spi_device_handle_t d, spi_transaction_t *t, TickType_t wait)
+{
+    if (s_ndone >= s_dev.queue_size || s_ndone >= 16) return ESP_ERR_TIMEOUT;   // queue full
+    esp_err_t err = run(t);
+    if (err != ESP_OK) return err;
+    if (fake_time != FAKE_TIME_NONE) {
+        host_now_us += 4;
+        int64_t start = s_busy_until > host_now_us ? s_busy_until + 3 : host_now_us;
+        s_busy_until = start + (int64_t)t->length;
+    }
+    s_done_us[s_ndone] = s_busy_until;
+    s_done[s_ndone++] = t;
+    return ESP_OK;
+}
+esp_err_t spi_device_get_trans_result(spi_device_handle_t d, spi_transaction_t **t, TickType_t wait)
+{
+    if (!s_ndone) return ESP_ERR_TIMEOUT;
+    if (fake_time != FAKE_TIME_NONE && s_done_us[0] > host_now_us) host_now_us = s_done_us[0] + 15;
+    *t = s_done[0];
+    --s_ndone;
+    memmove(s_done, s_done + 1, (size_t)s_ndone * sizeof(s_done[0]));
+    memmove(s_done_us, s_done_us + 1, (size_t)s_ndone * sizeof(s_done_us[0]));
+    return ESP_OK;
+}
@@ -0,0 +1,46 @@
+//fake_max31856.h
+// MAX31856 chips on a fake SPI bus and GPIO matrix, for the driver's host tests
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FAKE_MAX_CHIPS 8
+#define FAKE_ISR_MAX   16   // a level interrupt still pending after this many calls in a row is a storm
+
+// What a transaction costs on the virtual clock (host_now_us): nothing (the
+// tests), or ballpark ESP32-S3 figures at 1 MHz (the benchmark; see the .c)
+typedef enum { FAKE_TIME_NONE, FAKE_TIME_POLLING, FAKE_TIME_INTERRUPT } fake_time_t;
+
+typedef struct {
+    int      cs_pin;
+    int      drdy_pin;      // -1: not wired
+    uint8_t  regs[16];
+    bool     drdy_low;      // a conversion waits to be read
+    int      one_shots;     // CR0 writes carrying 1SHOT
+    uint32_t reads, writes; // transactions addressed to it
+} fake_chip_t;
+
+extern int      fake_cs_errors;     // transactions with not exactly one chip selected
+extern int      fake_isr_calls;     // GPIO ISR invocations
+extern int      fake_isr_storms;    // level interrupts that kept firing (FAKE_ISR_MAX)
+extern uint32_t fake_notify_bits;   // xTaskNotifyFromISR values, or'd
+extern int      fake_spi_fail;      // the next n transactions fail...
+extern int      fake_spi_pass;      // ...after this many have gone through
+extern int      fake_devices;       // spi_bus_add_device calls
+extern bool     fake_sleep_wakeup;  // esp_sleep_enable_gpio_wakeup was called
+extern int      fake_isr_unsafe;    // driver-level GPIO calls from ISR context (SPI callbacks,
+                                    // GPIO ISRs): not in IRAM on the chip
+extern int      fake_hw_cs;         // the device's spics_io_num (-1: CS is the driver's)
+extern fake_time_t fake_time;       // single transactions as polled or interrupt-driven ones
+
+// A chip with its power-on registers (CR0 0x00, CR1 0x03, wide thresholds), DRDY high
+fake_chip_t *fake_chip_add(int cs_pin, int drdy_pin);
+// A conversion completes: the temperature registers and SR take t_c / sr, DRDY falls
+void fake_conversion(fake_chip_t *c, float t_c, uint8_t sr);
+// What the host sees of a pin
+int  fake_pin_level(int pin);
+int  fake_pin_intr_type(int pin);   // gpio_int_type_t
+bool fake_pin_intr_enabled(int pin);
+int  fake_pin_wakeup_type(int pin); // gpio_int_type_t, GPIO_INTR_DISABLE if none
+// Queued transactions whose result nobody collected
+int  fake_spi_pending(void);
@@ -0,0 +1,86 @@
+//fake_spool.c
+// In-memory spool.h for host tests
+#include <string.h>
+#include "fake_spool.h"
+
+bool fake_spool_present = false;
+bool fake_spool_fail = false;
+
+static reading_t s_rec[FAKE_SPOOL_CAP];
+static uint32_t s_head;
+static uint32_t s_tail[SPOOL_SINKS_MAX];
+static int s_peeked[SPOOL_SINKS_MAX];
+static int s_sinks = 1;
+
+void fake_spool_reset(int sinks)
+{
+    s_sinks = sinks;
+    s_head = 0;
+    memset(s_tail, 0, sizeof(s_tail));
+    memset(s_peeked, 0, sizeof(s_peeked));
+}
+
+void fake_spool_drop(int n)
+{
+    for (int k = 0; k < s_sinks; ++k) {
+        if (s_tail[k] < (uint32_t)n) s_tail[k] = n;
+    }
+}
+
+esp_err_t spool_init(int sinks)
+{
+    fake_spool_reset(sinks);
+    return fake_spool_present ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+bool spool_append(const reading_t *r)
+{
+    if (!fake_spool_present || fake_spool_fail || spool_count() >= FAKE_SPOOL_CAP) return false;
+    s_rec[s_head++ % FAKE_SPOOL_CAP] = *r;
+    return true;
+}
+
+int spool_peek_n(int sink, reading_t *out, int max)
+{
+    int n = 0;
+    for (; n < max && s_tail[sink] + n < s_head; ++n) out[n] = s_rec[(s_tail[sink] + n) % FAKE_SPOOL_CAP];
+    s_peeked[sink] = n;
+    return n;
+}
+
+void spool_commit_n(int sink, int n)
+{
+    if (n > s_peeked[sink]) n = s_peeked[sink];
+    s_tail[sink] += n;
+    s_peeked[sink] = 0;
+}
+
+uint32_t spool_peek_seq(int sink, int i)
+{
+    return i >= 0 && i < s_peeked[sink] ? s_tail[sink] + i + 1 : 0;
+}
+
+void spool_commit_seq(int sink, uint32_t seq)
+{
+    if (seq > s_head) seq = s_head;
+    if (seq > s_tail[sink]) s_tail[sink] = seq;
+}
+
+uint32_t spool_count(void)
+{
+    uint32_t used = 0;
+    for (int k = 0; k < s_sinks; ++k) {
+        if (s_head - s_tail[k] > used) used = s_head - s_tail[k];
+    }
+    return used;
+}
+
+uint32_t spool_count_sink(int sink)
+{
+    return s_head - s_tail[sink];
+}
+
+void spool_get_stats(spool_stats_t *st)
+{
+    memset(st, 0, sizeof(*st));
+}
@@ -0,0 +1,15 @@
+//fake_spool.h
+// In-memory spool.h for host tests: same FIFO / per-sink ack semantics, no flash;
+// record i has sequence number i + 1
+#pragma once
+#include <stdbool.h>
+#include "spool.h"
+
+#define FAKE_SPOOL_CAP 4096
+
+extern bool fake_spool_present;   // false: no partition, every call is a no-op (the default)
+extern bool fake_spool_fail;      // true: spool_append fails (flash write error, erase failure)
+
+void fake_spool_reset(int sinks);
+// The ring recycled its oldest n records (spool.c's "Spool full: dropped"): every sink loses them
+void fake_spool_drop(int n);
@@ -0,0 +1,215 @@
+//host_rtos.c
+// Real-time stand-ins for the benchmarks: FreeRTOS tasks, queues and event groups over pthreads, a monotonic esp_timer
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = { .tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) { }
+}
+
+TickType_t xTaskGetTickCount(void) { return (TickType_t)(esp_timer_get_time() / 1000); }
+
+typedef struct { void (*fn)(void *); void *arg; } task_start_t;
+
+static void *task_main(void *p)
+{
+    task_start_t t = *(task_start_t *)p;
+    free(p);
+    t.fn(t.arg);
+    return NULL;
+}
+
+// priority and core are ignored; the handle is only ever compared with NULL
+static int s_task_handle;
+
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void *), const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *out, BaseType_t core)
+{
+    task_start_t *t = malloc(sizeof(*t));
+    pthread_t th;
+    if (!t) return pdFALSE;
+    *t = (task_start_t){ fn, arg };
+    if (out) *out = &s_task_handle;   // before the start: the task may clear it on exit
+    if (pthread_create(&th, NULL, task_main, t) != 0) { free(t); return pdFALSE; }
+    pthread_detach(th);
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t t) { pthread_exit(NULL); }
+
+struct host_queue {
+    pthread_mutex_t m;
+    pthread_cond_t  cv;
+    size_t   item, cap, head, count;
+    uint8_t *buf;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size)
+{
+    struct host_queue *q = calloc(1, sizeof(*q));
+    if (!q) return NULL;
+    q->item = item_size;
+    q->cap = len;
+    q->buf = calloc(len, item_size);
+    pthread_mutex_init(&q->m, NULL);
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&q->cv, &ca);
+    return q;
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->m);
+    q->head = q->count = 0;
+    pthread_mutex_unlock(&q->m);
+    return pdTRUE;
+}
+
+// no producer ever blocks in the modules under test: a full queue fails at once
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    pthread_mutex_lock(&q->m);
+    bool ok = q->count < q->cap;
+    if (ok) {
+        memcpy(q->buf + ((q->head + q->count) % q->cap) * q->item, item, q->item);
+        q->count++;
+        pthread_cond_signal(&q->cv);
+    }
+    pthread_mutex_unlock(&q->m);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+    struct timespec dl;
+    clock_gettime(CLOCK_MONOTONIC, &dl);
+    if (wait != portMAX_DELAY) {
+        dl.tv_sec += wait / 1000;
+        dl.tv_nsec += (long)(wait % 1000) * 1000000L;
+        if (dl.tv_nsec >= 1000000000L) { dl.tv_sec++; dl.tv_nsec -= 1000000000L; }
+    }
+    pthread_mutex_lock(&q->m);
+    while (q->count == 0) {
+        if (wait == 0) break;
+        if (wait == portMAX_DELAY) pthread_cond_wait(&q->cv, &q->m);
+        else if (pthread_cond_timedwait(&q->cv, &q->m, &dl) == ETIMEDOUT) break;
+    }
+    bool ok = q->count > 0;
+    if (ok) {
+        memcpy(item, q->buf + q->head * q->item, q->item);
+        q->head = (q->head + 1) % q->cap;
+        q->count--;
+    }
+    pthread_mutex_unlock(&q->m);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return xQueueCreate(1, 1); }
+
+// no priority inheritance and no recursion, which nothing here relies on
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t s = xSemaphoreCreateBinary();
+    if (s) xSemaphoreGive(s);
+    return s;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait)
+{
+    uint8_t v;
+    return xQueueReceive(s, &v, wait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+    uint8_t v = 1;
+    return xQueueSend(s, &v, 0);   // already given: fails, as on FreeRTOS
+}
+
+struct host_event_group {
+    pthread_mutex_t m;
+    pthread_cond_t  cv;
+    EventBits_t     bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    struct host_event_group *g = calloc(1, sizeof(*g));
+    if (!g) return NULL;
+    pthread_mutex_init(&g->m, NULL);
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&g->cv, &ca);
+    return g;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits)
+{
+    pthread_mutex_lock(&g->m);
+    g->bits |= bits;
+    EventBits_t v = g->bits;
+    pthread_cond_broadcast(&g->cv);
+    pthread_mutex_unlock(&g->m);
+    return v;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits)
+{
+    pthread_mutex_lock(&g->m);
+    EventBits_t v = g->bits;
+    g->bits &= ~bits;
+    pthread_mutex_unlock(&g->m);
+    return v;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t g)
+{
+    pthread_mutex_lock(&g->m);
+    EventBits_t v = g->bits;
+    pthread_mutex_unlock(&g->m);
+    return v;
+}
+
+// the bits when it returned (before any clear), as FreeRTOS does
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t bits, BaseType_t clear, BaseType_t all, TickType_t wait)
+{
+    struct timespec dl;
+    clock_gettime(CLOCK_MONOTONIC, &dl);
+    if (wait != portMAX_DELAY) {
+        dl.tv_sec += wait / 1000;
+        dl.tv_nsec += (long)(wait % 1000) * 1000000L;
+        if (dl.tv_nsec >= 1000000000L) { dl.tv_sec++; dl.tv_nsec -= 1000000000L; }
+    }
+    pthread_mutex_lock(&g->m);
+    for (;;) {
+        bool met = all ? (g->bits & bits) == bits : (g->bits & bits) != 0;
+        if (met || wait == 0) break;
+        if (wait == portMAX_DELAY) pthread_cond_wait(&g->cv, &g->m);
+        else if (pthread_cond_timedwait(&g->cv, &g->m, &dl) == ETIMEDOUT) break;
+    }
+    EventBits_t v = g->bits;
+    bool met = all ? (v & bits) == bits : (v & bits) != 0;
+    if (met && clear) g->bits &= ~bits;
+    pthread_mutex_unlock(&g->m);
+    return v;
+}
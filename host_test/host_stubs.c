@@ -0,0 +1,30 @@
+//host_stubs.c
+// Shared definitions behind stubs/: the critical section, a settable fake clock, no NVS
+#include <stddef.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "esp_err.h"
+#include "host_stubs.h"
+
+pthread_mutex_t host_crit = PTHREAD_MUTEX_INITIALIZER;
+
+int64_t host_now_us = 0;
+int64_t esp_timer_get_time(void) { return host_now_us; }
+
+const char *esp_err_to_name(esp_err_t err)
+{
+    static char buf[16];
+    snprintf(buf, sizeof(buf), "0x%x", (unsigned)err);
+    return buf;
+}
+
+// nvs_kv.h: nothing stored, so modules fall back to their defaults
+const char *host_kv_endpoints = NULL;
+int kv_get_str(const char *key, char *dst, size_t dst_len)
+{
+    if (!host_kv_endpoints || dst_len == 0) return -1;
+    size_t n = 0;
+    for (; host_kv_endpoints[n] && n + 1 < dst_len; ++n) dst[n] = host_kv_endpoints[n];
+    dst[n] = 0;
+    return 0;
+}
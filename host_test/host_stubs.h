@@ -0,0 +1,7 @@
+//host_stubs.h
+// Knobs of host_stubs.c
+#pragma once
+#include <stdint.h>
+
+extern int64_t host_now_us;             // what esp_timer_get_time() returns
+extern const char *host_kv_endpoints;   // value of NVS key "endpoints" (NULL = unset)
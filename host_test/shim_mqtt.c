@@ -0,0 +1,220 @@
+//shim_mqtt.c
+// esp-mqtt's client calls over a plain TCP socket, for the host benchmarks
+/*
+MQTT 3.1.1, just what mqtt_up.c needs from esp-mqtt: CONNECT / CONNACK,
+QoS1 PUBLISH / PUBACK, and the BEFORE_CONNECT / CONNECTED / PUBLISHED /
+DISCONNECTED events, raised from a reader thread as esp-mqtt raises them
+from its own task. No TLS, no outbox, no reconnect: publishing while
+disconnected fails with -1, as esp-mqtt does before the first CONNACK.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "mqtt_client.h"
+#include "esp_crt_bundle.h"
+
+struct esp_mqtt_client {
+    char host[96], port[8];
+    char client_id[64], user[64], pass[96];
+    bool clean;
+    int  keepalive;
+    int  fd;
+    volatile bool up;
+    uint16_t next_id;
+    pthread_t rx;
+    bool rx_started;
+    pthread_mutex_t tx;
+    esp_event_handler_t h;
+    void *arg;
+};
+
+esp_err_t esp_crt_bundle_attach(void *conf) { return ESP_OK; }
+
+static void emit(esp_mqtt_client_handle_t c, esp_mqtt_event_id_t id, int msg_id, int session_present)
+{
+    esp_mqtt_event_t ev = { .event_id = id, .client = c, .msg_id = msg_id, .session_present = session_present };
+    if (c->h) c->h(c->arg, "MQTT_EVENTS", id, &ev);
+}
+
+static bool write_all(int fd, const uint8_t *p, size_t n)
+{
+    while (n) {
+        ssize_t k = send(fd, p, n, MSG_NOSIGNAL);
+        if (k <= 0) return false;
+        p += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+static bool read_all(int fd, uint8_t *p, size_t n)
+{
+    while (n) {
+        ssize_t k = recv(fd, p, n, 0);
+        if (k <= 0) return false;
+        p += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+static size_t put_len(uint8_t *p, size_t len)
+{
+    size_t o = 0;
+    do {
+        uint8_t b = len % 128;
+        len /= 128;
+        p[o++] = b | (len ? 0x80 : 0);
+    } while (len);
+    return o;
+}
+
+static size_t put_str(uint8_t *p, const char *s)
+{
+    size_t n = strlen(s);
+    p[0] = (uint8_t)(n >> 8);
+    p[1] = (uint8_t)n;
+    memcpy(p + 2, s, n);
+    return n + 2;
+}
+
+static void *rx_main(void *arg)
+{
+    esp_mqtt_client_handle_t c = arg;
+    uint8_t hdr, body[256];
+    while (read_all(c->fd, &hdr, 1)) {
+        size_t len = 0, mul = 1;
+        uint8_t b;
+        do {
+            if (!read_all(c->fd, &b, 1)) goto down;
+            len += (b & 0x7F) * mul;
+            mul *= 128;
+        } while (b & 0x80);
+        if (len > sizeof(body) || !read_all(c->fd, body, len)) goto down;
+        switch (hdr >> 4) {
+        case 2:   // CONNACK
+            if (len >= 2 && body[1] == 0) {
+                c->up = true;
+                emit(c, MQTT_EVENT_CONNECTED, 0, body[0] & 1);
+            }
+            break;
+        case 4:   // PUBACK
+            if (len >= 2) emit(c, MQTT_EVENT_PUBLISHED, (body[0] << 8) | body[1], 0);
+            break;
+        default:
+            break;
+        }
+    }
+down:
+    if (c->up) {
+        c->up = false;
+        emit(c, MQTT_EVENT_DISCONNECTED, 0, 0);
+    }
+    return NULL;
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *cfg)
+{
+    // mqtt://host[:port]
+    const char *h = strstr(cfg->broker.address.uri, "://");
+    if (!h) return NULL;
+    h += 3;
+    struct esp_mqtt_client *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    size_t hl = strcspn(h, ":/");
+    snprintf(c->host, sizeof(c->host), "%.*s", (int)hl, h);
+    snprintf(c->port, sizeof(c->port), "%s", h[hl] == ':' ? h + hl + 1 : "1883");
+    snprintf(c->client_id, sizeof(c->client_id), "%s", cfg->credentials.client_id ? cfg->credentials.client_id : "");
+    snprintf(c->user, sizeof(c->user), "%s", cfg->credentials.username ? cfg->credentials.username : "");
+    snprintf(c->pass, sizeof(c->pass), "%s",
+             cfg->credentials.authentication.password ? cfg->credentials.authentication.password : "");
+    c->clean = !cfg->session.disable_clean_session;
+    c->keepalive = cfg->session.keepalive;
+    c->fd = -1;
+    pthread_mutex_init(&c->tx, NULL);
+    return c;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t c, esp_mqtt_event_id_t id,
+                                         esp_event_handler_t h, void *arg)
+{
+    c->h = h;
+    c->arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t c)
+{
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM }, *res;
+    if (getaddrinfo(c->host, c->port, &hints, &res) != 0) return ESP_FAIL;
+    emit(c, MQTT_EVENT_BEFORE_CONNECT, 0, 0);
+    c->fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));   // lwIP sends small segments at once too
+    bool ok = c->fd >= 0 && connect(c->fd, res->ai_addr, res->ai_addrlen) == 0;
+    freeaddrinfo(res);
+    if (!ok) return ESP_FAIL;
+
+    uint8_t p[512], v[400];
+    size_t n = 0;
+    n += put_str(v + n, "MQTT");
+    v[n++] = 4;                                       // 3.1.1
+    v[n++] = (c->clean ? 0x02 : 0) | (c->user[0] ? 0x80 : 0) | (c->pass[0] ? 0x40 : 0);
+    v[n++] = (uint8_t)(c->keepalive >> 8);
+    v[n++] = (uint8_t)c->keepalive;
+    n += put_str(v + n, c->client_id);
+    if (c->user[0]) n += put_str(v + n, c->user);
+    if (c->pass[0]) n += put_str(v + n, c->pass);
+    size_t o = 0;
+    p[o++] = 0x10;
+    o += put_len(p + o, n);
+    memcpy(p + o, v, n);
+    if (!write_all(c->fd, p, o + n)) return ESP_FAIL;
+    c->rx_started = pthread_create(&c->rx, NULL, rx_main, c) == 0;
+    return c->rx_started ? ESP_OK : ESP_FAIL;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t c, const char *topic, const char *data,
+                            int len, int qos, int retain)
+{
+    if (!c->up) return -1;
+    static uint8_t p[8192];
+    pthread_mutex_lock(&c->tx);
+    if (++c->next_id == 0) c->next_id = 1;
+    int id = c->next_id;
+    size_t tl = strlen(topic), vlen = 2 + tl + (qos ? 2 : 0) + (size_t)len;
+    size_t o = 0;
+    p[o++] = 0x30 | (qos << 1) | (retain ? 1 : 0);
+    o += put_len(p + o, vlen);
+    bool ok = o + vlen <= sizeof(p);
+    if (ok) {
+        o += put_str(p + o, topic);
+        if (qos) { p[o++] = (uint8_t)(id >> 8); p[o++] = (uint8_t)id; }
+        memcpy(p + o, data, (size_t)len);
+        ok = write_all(c->fd, p, o + (size_t)len);
+    }
+    pthread_mutex_unlock(&c->tx);
+    return ok ? id : -1;
+}
+
+esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t c)
+{
+    if (!c) return ESP_OK;
+    if (c->fd >= 0) {
+        static const uint8_t disc[2] = { 0xE0, 0x00 };
+        if (c->up) write_all(c->fd, disc, sizeof(disc));
+        c->up = false;                  // a destroyed client raises no events
+        c->h = NULL;
+        shutdown(c->fd, SHUT_RDWR);
+    }
+    if (c->rx_started) pthread_join(c->rx, NULL);
+    if (c->fd >= 0) close(c->fd);
+    free(c);
+    return ESP_OK;
+}
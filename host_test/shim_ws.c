@@ -0,0 +1,207 @@
+//shim_ws.c
+// esp_websocket_client's calls over a plain TCP socket, for the host benchmarks
+/*
+RFC 6455 client side, just what ws_up.c needs: the upgrade handshake (with
+the configured extra headers), masked text / binary frames out, unfragmented
+frames in, raised as WEBSOCKET_EVENT_DATA from a reader thread as the
+client's own task raises them. Pings are answered; no TLS, no reconnect.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "esp_websocket_client.h"
+
+struct esp_websocket_client {
+    char host[96], port[8], path[96], headers[256];
+    int  fd;
+    volatile bool up;
+    pthread_t rx;
+    bool rx_started;
+    pthread_mutex_t tx;
+    esp_event_handler_t h;
+    void *arg;
+};
+
+static void emit(esp_websocket_client_handle_t c, esp_websocket_event_id_t id, esp_websocket_event_data_t *d)
+{
+    esp_websocket_event_data_t none = { .client = c };
+    if (c->h) c->h(c->arg, "WEBSOCKET_EVENTS", id, d ? d : &none);
+}
+
+static bool write_all(int fd, const uint8_t *p, size_t n)
+{
+    while (n) {
+        ssize_t k = send(fd, p, n, MSG_NOSIGNAL);
+        if (k <= 0) return false;
+        p += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+static bool read_all(int fd, uint8_t *p, size_t n)
+{
+    while (n) {
+        ssize_t k = recv(fd, p, n, 0);
+        if (k <= 0) return false;
+        p += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+// one frame, client → server frames are masked (the mask is fixed: nothing to hide here)
+static int send_frame(esp_websocket_client_handle_t c, uint8_t op, const uint8_t *data, size_t len)
+{
+    static const uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+    uint8_t hdr[14];
+    size_t o = 0;
+    hdr[o++] = 0x80 | op;
+    if (len < 126) {
+        hdr[o++] = 0x80 | (uint8_t)len;
+    } else {
+        hdr[o++] = 0x80 | 126;
+        hdr[o++] = (uint8_t)(len >> 8);
+        hdr[o++] = (uint8_t)len;
+    }
+    memcpy(hdr + o, mask, 4);
+    o += 4;
+    uint8_t *buf = malloc(o + len);
+    if (!buf) return -1;
+    memcpy(buf, hdr, o);
+    for (size_t i = 0; i < len; ++i) buf[o + i] = data[i] ^ mask[i & 3];
+    pthread_mutex_lock(&c->tx);
+    bool ok = c->up && write_all(c->fd, buf, o + len);
+    pthread_mutex_unlock(&c->tx);
+    free(buf);
+    return ok ? (int)len : -1;
+}
+
+static void *rx_main(void *arg)
+{
+    esp_websocket_client_handle_t c = arg;
+    static uint8_t body[65536];
+    uint8_t h[2];
+    while (read_all(c->fd, h, 2)) {
+        uint8_t op = h[0] & 0x0F;
+        size_t len = h[1] & 0x7F;
+        if (len == 126) {
+            uint8_t x[2];
+            if (!read_all(c->fd, x, 2)) break;
+            len = (x[0] << 8) | x[1];
+        } else if (len == 127) {
+            break;   // never sent by the stand-in
+        }
+        if (len > sizeof(body) || !read_all(c->fd, body, len)) break;
+        if (op == 0x8) break;                                 // close
+        if (op == 0x9) { send_frame(c, 0xA, body, len); continue; }   // ping → pong
+        if (op != 0x1 && op != 0x2) continue;
+        esp_websocket_event_data_t d = {
+            .data_ptr = (const char *)body, .data_len = (int)len, .fin = true, .op_code = op,
+            .client = c, .payload_len = (int)len, .payload_offset = 0,
+        };
+        emit(c, WEBSOCKET_EVENT_DATA, &d);
+    }
+    if (c->up) {
+        c->up = false;
+        emit(c, WEBSOCKET_EVENT_DISCONNECTED, NULL);
+    }
+    return NULL;
+}
+
+esp_websocket_client_handle_t esp_websocket_client_init(const esp_websocket_client_config_t *cfg)
+{
+    // ws://host[:port]/path
+    const char *h = strstr(cfg->uri, "://");
+    if (!h) return NULL;
+    h += 3;
+    struct esp_websocket_client *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    size_t hl = strcspn(h, ":/");
+    snprintf(c->host, sizeof(c->host), "%.*s", (int)hl, h);
+    const char *p = h + hl;
+    if (*p == ':') {
+        size_t pl = strcspn(p + 1, "/");
+        snprintf(c->port, sizeof(c->port), "%.*s", (int)pl, p + 1);
+        p += 1 + pl;
+    } else {
+        snprintf(c->port, sizeof(c->port), "80");
+    }
+    snprintf(c->path, sizeof(c->path), "%s", *p ? p : "/");
+    snprintf(c->headers, sizeof(c->headers), "%s", cfg->headers ? cfg->headers : "");
+    c->fd = -1;
+    pthread_mutex_init(&c->tx, NULL);
+    return c;
+}
+
+esp_err_t esp_websocket_register_events(esp_websocket_client_handle_t c, esp_websocket_event_id_t id,
+                                        esp_event_handler_t h, void *arg)
+{
+    c->h = h;
+    c->arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t esp_websocket_client_start(esp_websocket_client_handle_t c)
+{
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM }, *res;
+    if (getaddrinfo(c->host, c->port, &hints, &res) != 0) return ESP_FAIL;
+    emit(c, WEBSOCKET_EVENT_BEFORE_CONNECT, NULL);
+    c->fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    bool ok = c->fd >= 0 && connect(c->fd, res->ai_addr, res->ai_addrlen) == 0;
+    freeaddrinfo(res);
+    if (!ok) return ESP_FAIL;
+
+    // the server's Sec-WebSocket-Accept isn't checked: it's our own stand-in
+    char req[640];
+    int n = snprintf(req, sizeof(req),
+                     "GET %s HTTP/1.1\r\nHost: %s:%s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                     "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n%s\r\n",
+                     c->path, c->host, c->port, c->headers);
+    if (!write_all(c->fd, (const uint8_t *)req, (size_t)n)) return ESP_FAIL;
+    char resp[512];
+    size_t got = 0;
+    while (got < sizeof(resp) - 1) {
+        if (recv(c->fd, resp + got, 1, 0) != 1) return ESP_FAIL;
+        resp[++got] = 0;
+        if (got >= 4 && memcmp(resp + got - 4, "\r\n\r\n", 4) == 0) break;
+    }
+    if (strncmp(resp, "HTTP/1.1 101", 12) != 0) return ESP_FAIL;
+    c->up = true;
+    emit(c, WEBSOCKET_EVENT_CONNECTED, NULL);
+    c->rx_started = pthread_create(&c->rx, NULL, rx_main, c) == 0;
+    return c->rx_started ? ESP_OK : ESP_FAIL;
+}
+
+int esp_websocket_client_send_bin(esp_websocket_client_handle_t c, const char *data, int len, TickType_t timeout)
+{
+    return send_frame(c, 0x2, (const uint8_t *)data, (size_t)len);
+}
+
+int esp_websocket_client_send_text(esp_websocket_client_handle_t c, const char *data, int len, TickType_t timeout)
+{
+    return send_frame(c, 0x1, (const uint8_t *)data, (size_t)len);
+}
+
+esp_err_t esp_websocket_client_destroy(esp_websocket_client_handle_t c)
+{
+    if (!c) return ESP_OK;
+    if (c->fd >= 0) {
+        if (c->up) send_frame(c, 0x8, NULL, 0);
+        c->up = false;                  // a destroyed client raises no events
+        c->h = NULL;
+        shutdown(c->fd, SHUT_RDWR);
+    }
+    if (c->rx_started) pthread_join(c->rx, NULL);
+    if (c->fd >= 0) close(c->fd);
+    free(c);
+    return ESP_OK;
+}
@@ -0,0 +1,283 @@
+#!/usr/bin/env python3
+# ingest_standin.py
+# Local stand-in for the ingest server (HTTP, WebSocket, CoAP) and an MQTT
+# broker, for the host uplink benchmarks (host_test/bench_uplink.c). Standard library only.
+#
+#   HTTP  POST /ingest, /ingest/batch, /ingest/bin -> 200 {}   GET /health -> 200
+#   HTTPS the same over TLS 1.2 (the firmware's mbedTLS config) with --tls-port;
+#         session tickets on, so a client that keeps its session resumes.
+#         The self-signed RSA-2048 certificate for 127.0.0.1 is made with the
+#         openssl tool into --tls-dir (standin.crt / standin.key) unless there.
+#   MQTT  3.1.1: CONNECT -> CONNACK, QoS1 PUBLISH -> PUBACK, PINGREQ -> PINGRESP
+#   WS    GET /ingest/ws upgrade; every data frame is acked as ws_up.h expects:
+#         text {"seq":N,...} -> text {"seq":N}, binary seq:u32|... -> its first
+#         4 bytes. --ws-echo sends whole frames back instead (also an ack).
+#   CoAP  UDP: CON POST -> ACK 2.04 with the request's token, CON ping -> RST.
+#         --coap-separate answers with an empty ACK at once and the 2.04
+#         as a separate CON response after the delay (RFC 7252 5.2.2).
+#         Retransmitted requests (same message id) are answered, not counted.
+#
+# Every answer is held back --delay-ms, standing in for the network round
+# trip and server work, so a stop-and-wait transport pays it once per
+# message while a windowed one overlaps it. Mosquitto can replace the MQTT
+# half (point the bench at it); this one exists so the numbers don't depend
+# on what happens to be installed.
+import argparse
+import asyncio
+import base64
+import hashlib
+import json
+import os
+import signal
+import ssl
+import struct
+import subprocess
+
+stats = {"http_requests": 0, "http_bytes": 0, "mqtt_publishes": 0, "mqtt_bytes": 0,
+         "ws_frames": 0, "ws_bytes": 0, "coap_posts": 0, "coap_bytes": 0, "coap_dups": 0,
+         "tls_connects": 0, "tls_resumed": 0}
+
+
+async def serve_http(reader, writer, delay):
+    tls = writer.get_extra_info("ssl_object")
+    if tls:
+        stats["tls_connects"] += 1
+        stats["tls_resumed"] += tls.session_reused
+    try:
+        while True:
+            head = await reader.readuntil(b"\r\n\r\n")
+            lines = head.decode("latin-1").split("\r\n")
+            method, path = lines[0].split(" ")[:2]
+            length = 0
+            for h in lines[1:]:
+                if h.lower().startswith("content-length:"):
+                    length = int(h.split(":", 1)[1])
+            body = await reader.readexactly(length) if length else b""
+            stats["http_requests"] += 1
+            stats["http_bytes"] += len(head) + len(body)
+            await asyncio.sleep(delay)
+            ok = path == "/health" or path.startswith("/ingest")
+            resp = b"{}" if ok else b'{"error":"not found"}'
+            writer.write(b"HTTP/1.1 %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n"
+                         b"Connection: keep-alive\r\n\r\n%s" % (b"200 OK" if ok else b"404 Not Found", len(resp), resp))
+            await writer.drain()
+    except (asyncio.IncompleteReadError, ConnectionError, ValueError):
+        pass
+    finally:
+        writer.close()
+
+
+async def mqtt_packet(reader):
+    hdr = (await reader.readexactly(1))[0]
+    length, mul = 0, 1
+    while True:
+        b = (await reader.readexactly(1))[0]
+        length += (b & 0x7F) * mul
+        mul *= 128
+        if not b & 0x80:
+            break
+    return hdr, await reader.readexactly(length)
+
+
+async def serve_mqtt(reader, writer, delay):
+    lock = asyncio.Lock()
+
+    async def send_later(data):
+        # acks are scheduled in arrival order with the same delay, so they leave in order
+        await asyncio.sleep(delay)
+        async with lock:
+            writer.write(data)
+            await writer.drain()
+
+    pending = set()
+    try:
+        while True:
+            hdr, body = await mqtt_packet(reader)
+            kind = hdr >> 4
+            if kind == 1:                       # CONNECT
+                task = asyncio.ensure_future(send_later(b"\x20\x02\x00\x00"))
+            elif kind == 3:                     # PUBLISH
+                stats["mqtt_publishes"] += 1
+                stats["mqtt_bytes"] += len(body) + 2
+                qos = (hdr >> 1) & 3
+                if not qos:
+                    continue
+                tl = (body[0] << 8) | body[1]
+                pid = body[2 + tl:4 + tl]
+                task = asyncio.ensure_future(send_later(b"\x40\x02" + pid))
+            elif kind == 12:                    # PINGREQ
+                task = asyncio.ensure_future(send_later(b"\xd0\x00"))
+            elif kind == 14:                    # DISCONNECT
+                break
+            else:
+                continue
+            pending.add(task)
+            task.add_done_callback(pending.discard)
+    except (asyncio.IncompleteReadError, ConnectionError):
+        pass
+    finally:
+        for t in pending:
+            t.cancel()
+        writer.close()
+
+
+async def ws_frame(reader):
+    h = await reader.readexactly(2)
+    op, length = h[0] & 0x0F, h[1] & 0x7F
+    if length == 126:
+        length = struct.unpack(">H", await reader.readexactly(2))[0]
+    elif length == 127:
+        length = struct.unpack(">Q", await reader.readexactly(8))[0]
+    mask = await reader.readexactly(4) if h[1] & 0x80 else b"\0\0\0\0"
+    data = bytearray(await reader.readexactly(length))
+    for i in range(length):
+        data[i] ^= mask[i & 3]
+    return op, bytes(data)
+
+
+def ws_out(op, data):
+    n = len(data)
+    head = bytes([0x80 | op, n]) if n < 126 else bytes([0x80 | op, 126]) + struct.pack(">H", n)
+    return head + data
+
+
+async def serve_ws(reader, writer, delay, echo):
+    lock = asyncio.Lock()
+    pending = set()
+
+    async def send_later(data):
+        await asyncio.sleep(delay)
+        async with lock:
+            writer.write(data)
+            await writer.drain()
+
+    try:
+        head = (await reader.readuntil(b"\r\n\r\n")).decode("latin-1")
+        key = next(h.split(":", 1)[1].strip() for h in head.split("\r\n")
+                   if h.lower().startswith("sec-websocket-key:"))
+        accept = base64.b64encode(hashlib.sha1((key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11")
+                                               .encode()).digest()).decode()
+        writer.write(("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                      f"Sec-WebSocket-Accept: {accept}\r\n\r\n").encode())
+        await writer.drain()
+        while True:
+            op, data = await ws_frame(reader)
+            if op == 0x8:                       # close
+                break
+            if op == 0x9:                       # ping
+                ack = ws_out(0xA, data)
+            elif op in (0x1, 0x2):
+                stats["ws_frames"] += 1
+                stats["ws_bytes"] += len(data)
+                if echo:
+                    ack = ws_out(op, data)
+                elif op == 0x1:
+                    ack = ws_out(0x1, json.dumps({"seq": json.loads(data)["seq"]}).encode())
+                else:
+                    ack = ws_out(0x2, data[:4])
+            else:
+                continue
+            task = asyncio.ensure_future(send_later(ack))
+            pending.add(task)
+            task.add_done_callback(pending.discard)
+    except (asyncio.IncompleteReadError, ConnectionError, StopIteration, ValueError, KeyError):
+        pass
+    finally:
+        for t in pending:
+            t.cancel()
+        writer.close()
+
+
+class CoapServer(asyncio.DatagramProtocol):
+    def __init__(self, delay, separate):
+        self.delay, self.separate = delay, separate
+        self.seen = {}                          # (peer, message id) -> answered
+        self.mid = 0x4000
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def later(self, data, peer):
+        asyncio.get_running_loop().call_later(self.delay, self.transport.sendto, data, peer)
+
+    def datagram_received(self, m, peer):
+        if len(m) < 4 or m[0] >> 6 != 1:
+            return
+        kind, tkl, code, mid = (m[0] >> 4) & 3, m[0] & 0x0F, m[1], m[2:4]
+        if kind != 0:                           # ACK of a separate response, RST
+            return
+        if code == 0:                           # ping
+            self.later(bytes([0x70, 0]) + mid, peer)
+            return
+        token = m[4:4 + tkl]
+        if (peer, mid) in self.seen:
+            stats["coap_dups"] += 1
+        else:
+            self.seen[(peer, mid)] = True
+            if len(self.seen) > 4096:
+                self.seen.pop(next(iter(self.seen)))
+            stats["coap_posts"] += 1
+            stats["coap_bytes"] += len(m)
+        if self.separate:
+            self.transport.sendto(bytes([0x60, 0]) + mid, peer)
+            self.mid = self.mid % 0xFFFF + 1
+            self.later(bytes([0x40 | tkl, 0x44]) + struct.pack(">H", self.mid) + token, peer)
+        else:
+            self.later(bytes([0x60 | tkl, 0x44]) + mid + token, peer)
+
+
+def tls_context(d):
+    crt, key = os.path.join(d, "standin.crt"), os.path.join(d, "standin.key")
+    if not (os.path.exists(crt) and os.path.exists(key)):
+        os.makedirs(d, exist_ok=True)
+        subprocess.run(["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "30",
+                        "-subj", "/CN=127.0.0.1", "-addext", "subjectAltName=IP:127.0.0.1",
+                        "-keyout", key, "-out", crt], check=True, capture_output=True)
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    ctx.maximum_version = ssl.TLSVersion.TLSv1_2
+    ctx.load_cert_chain(crt, key)
+    return ctx
+
+
+async def main():
+    ap = argparse.ArgumentParser(description="ingest server, MQTT broker, WebSocket and CoAP stand-in")
+    ap.add_argument("--host", default="127.0.0.1")
+    ap.add_argument("--http-port", type=int, default=18080)
+    ap.add_argument("--mqtt-port", type=int, default=11883)
+    ap.add_argument("--ws-port", type=int, default=18081)
+    ap.add_argument("--ws-echo", action="store_true", help="echo whole WebSocket frames instead of acks")
+    ap.add_argument("--coap-port", type=int, default=15683)
+    ap.add_argument("--coap-separate", action="store_true", help="empty ACK first, the response separately")
+    ap.add_argument("--tls-port", type=int, default=0, help="HTTPS on this port too (0: off)")
+    ap.add_argument("--tls-dir", default=".", help="where the certificate and key are kept")
+    ap.add_argument("--delay-ms", type=float, default=20.0)
+    a = ap.parse_args()
+    d = a.delay_ms / 1000.0
+
+    servers = [
+        await asyncio.start_server(lambda r, w: serve_http(r, w, d), a.host, a.http_port),
+        await asyncio.start_server(lambda r, w: serve_mqtt(r, w, d), a.host, a.mqtt_port),
+        await asyncio.start_server(lambda r, w: serve_ws(r, w, d, a.ws_echo), a.host, a.ws_port),
+    ]
+    if a.tls_port:
+        servers.append(await asyncio.start_server(lambda r, w: serve_http(r, w, d), a.host, a.tls_port,
+                                                  ssl=tls_context(a.tls_dir)))
+    coap, _ = await asyncio.get_running_loop().create_datagram_endpoint(
+        lambda: CoapServer(d, a.coap_separate), local_addr=(a.host, a.coap_port))
+    print(f"ingest stand-in: http {a.http_port}, mqtt {a.mqtt_port}, ws {a.ws_port}, "
+          f"coap {a.coap_port}{' (separate)' if a.coap_separate else ''}, "
+          f"{f'https {a.tls_port}, ' if a.tls_port else ''}delay {a.delay_ms} ms", flush=True)
+
+    stop = asyncio.Event()
+    loop = asyncio.get_running_loop()
+    for sig in (signal.SIGINT, signal.SIGTERM):
+        loop.add_signal_handler(sig, stop.set)
+    await stop.wait()
+    for s in servers:
+        s.close()
+    coap.close()
+    print("ingest stand-in:", ", ".join(f"{k} {v}" for k, v in stats.items()), flush=True)
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
@@ -0,0 +1,37 @@
+// driver/spi_master.h stand-in for the host tests (fake_max31856.c is the bus)
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef enum { SPI1_HOST, SPI2_HOST, SPI3_HOST } spi_host_device_t;
+typedef struct spi_device_t *spi_device_handle_t;
+
+typedef struct spi_transaction_t {
+    uint32_t flags;
+    uint16_t cmd;
+    uint64_t addr;
+    size_t   length;      // bits
+    size_t   rxlength;
+    void    *user;
+    union { const void *tx_buffer; uint8_t tx_data[4]; };
+    union { void *rx_buffer; uint8_t rx_data[4]; };
+} spi_transaction_t;
+typedef void (*transaction_cb_t)(spi_transaction_t *t);
+
+typedef struct {
+    uint8_t  command_bits, address_bits, dummy_bits, mode;
+    int      clock_speed_hz;
+    int      spics_io_num;
+    uint32_t flags;
+    int      queue_size;
+    transaction_cb_t pre_cb;
+    transaction_cb_t post_cb;
+} spi_device_interface_config_t;
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *cfg, spi_device_handle_t *out);
+esp_err_t spi_device_polling_transmit(spi_device_handle_t dev, spi_transaction_t *t);
+esp_err_t spi_device_transmit(spi_device_handle_t dev, spi_transaction_t *t);
+esp_err_t spi_device_queue_trans(spi_device_handle_t dev, spi_transaction_t *t, TickType_t wait);
+esp_err_t spi_device_get_trans_result(spi_device_handle_t dev, spi_transaction_t **t, TickType_t wait);
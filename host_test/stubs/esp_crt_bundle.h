@@ -0,0 +1,4 @@
+// esp_crt_bundle.h stand-in for the host tests (no TLS on the host)
+#pragma once
+#include "esp_err.h"
+esp_err_t esp_crt_bundle_attach(void *conf);
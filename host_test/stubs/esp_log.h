@@ -0,0 +1,11 @@
+// esp_log.h stand-in for the host tests: INFO and up to stdout, quiet with HOST_LOG_QUIET
+#pragma once
+#include <stdio.h>
+#ifdef HOST_LOG_QUIET
+#define ESP_LOGI(tag, fmt, ...) do { if (0) printf(fmt, ##__VA_ARGS__); (void)(tag); } while (0)
+#else
+#define ESP_LOGI(tag, fmt, ...) printf("I %s: " fmt "\n", tag, ##__VA_ARGS__)
+#endif
+#define ESP_LOGW(tag, fmt, ...) printf("W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGE(tag, fmt, ...) printf("E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) do { if (0) printf(fmt, ##__VA_ARGS__); (void)(tag); } while (0)
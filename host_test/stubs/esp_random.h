@@ -0,0 +1,5 @@
+// esp_random.h stand-in for the host tests
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+static inline uint32_t esp_random(void) { return (uint32_t)rand() ^ ((uint32_t)rand() << 16); }
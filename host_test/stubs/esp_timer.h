@@ -0,0 +1,4 @@
+// esp_timer.h stand-in for the host tests: the clock is the test's (see host_stubs.c)
+#pragma once
+#include <stdint.h>
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,48 @@
+// esp_websocket_client.h stand-in for the host tests: the part ws_up.c uses
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+#include "freertos/FreeRTOS.h"
+
+typedef struct esp_websocket_client *esp_websocket_client_handle_t;
+
+typedef enum {
+    WEBSOCKET_EVENT_ANY = -1,
+    WEBSOCKET_EVENT_ERROR = 0,
+    WEBSOCKET_EVENT_CONNECTED,
+    WEBSOCKET_EVENT_DISCONNECTED,
+    WEBSOCKET_EVENT_DATA,
+    WEBSOCKET_EVENT_CLOSED,
+    WEBSOCKET_EVENT_BEFORE_CONNECT,
+} esp_websocket_event_id_t;
+
+typedef struct {
+    const char *data_ptr;
+    int         data_len;
+    bool        fin;
+    uint8_t     op_code;
+    esp_websocket_client_handle_t client;
+    void       *user_context;
+    int         payload_len;
+    int         payload_offset;
+} esp_websocket_event_data_t;
+
+typedef struct {
+    const char *uri;
+    const char *headers;
+    esp_err_t (*crt_bundle_attach)(void *);
+    int    reconnect_timeout_ms;
+    int    network_timeout_ms;
+    size_t ping_interval_sec;
+} esp_websocket_client_config_t;
+
+esp_websocket_client_handle_t esp_websocket_client_init(const esp_websocket_client_config_t *cfg);
+esp_err_t esp_websocket_client_start(esp_websocket_client_handle_t c);
+esp_err_t esp_websocket_client_destroy(esp_websocket_client_handle_t c);
+esp_err_t esp_websocket_register_events(esp_websocket_client_handle_t c, esp_websocket_event_id_t id,
+                                        esp_event_handler_t h, void *arg);
+int esp_websocket_client_send_bin(esp_websocket_client_handle_t c, const char *data, int len, TickType_t timeout);
+int esp_websocket_client_send_text(esp_websocket_client_handle_t c, const char *data, int len, TickType_t timeout);
@@ -0,0 +1,25 @@
+// FreeRTOS.h stand-in for the host tests: types and a process-wide critical section
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+#define portMAX_DELAY    0xffffffffu
+#define pdMS_TO_TICKS(x) ((TickType_t)(x))   // 1 tick = 1 ms here
+
+// every portMUX maps onto one recursive-free mutex; enough for single-core semantics
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+extern pthread_mutex_t host_crit;
+#define taskENTER_CRITICAL(m)     ((void)(m), pthread_mutex_lock(&host_crit))
+#define taskEXIT_CRITICAL(m)      ((void)(m), pthread_mutex_unlock(&host_crit))
+#define taskENTER_CRITICAL_ISR(m) taskENTER_CRITICAL(m)
+#define taskEXIT_CRITICAL_ISR(m)  taskEXIT_CRITICAL(m)
+#define portYIELD_FROM_ISR(x)     ((void)(x))
+#define IRAM_ATTR
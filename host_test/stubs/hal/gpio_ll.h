@@ -0,0 +1,8 @@
+// hal/gpio_ll.h stand-in for the host tests: the register-level calls an
+// IRAM ISR may make (static inline in IDF, functions in fake_max31856.c here)
+#pragma once
+#include <stdint.h>
+#include "soc/gpio_struct.h"
+void gpio_ll_intr_disable(gpio_dev_t *hw, uint32_t gpio_num);
+void gpio_ll_wakeup_disable(gpio_dev_t *hw, uint32_t gpio_num);
+void gpio_ll_set_level(gpio_dev_t *hw, uint32_t gpio_num, uint32_t level);
@@ -0,0 +1,9 @@
+// lwip/dns.h stand-in for the host tests: dns_getserver is the test's
+#pragma once
+#include <stdint.h>
+typedef struct { uint32_t addr; } ip4_addr_t;
+typedef struct { ip4_addr_t u_addr_ip4; uint8_t type; } ip_addr_t;
+#define IP_IS_V4(a)          ((a)->type == 0)
+#define ip_2_ip4(a)          (&(a)->u_addr_ip4)
+#define ip4_addr_get_u32(a)  ((a)->addr)
+const ip_addr_t *dns_getserver(uint8_t numdns);
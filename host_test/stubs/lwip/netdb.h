@@ -0,0 +1,3 @@
+// lwip/netdb.h stand-in for the host tests
+#pragma once
+#include <netdb.h>
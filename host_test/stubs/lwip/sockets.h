@@ -0,0 +1,7 @@
+// lwip/sockets.h stand-in for the host tests: the host's BSD sockets
+#pragma once
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/time.h>
+#include <unistd.h>
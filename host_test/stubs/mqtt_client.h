@@ -0,0 +1,53 @@
+// mqtt_client.h stand-in for the host tests: the part of esp-mqtt's API mqtt_up.c uses
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+
+typedef enum {
+    MQTT_EVENT_ANY = -1,
+    MQTT_EVENT_ERROR = 0,
+    MQTT_EVENT_CONNECTED,
+    MQTT_EVENT_DISCONNECTED,
+    MQTT_EVENT_SUBSCRIBED,
+    MQTT_EVENT_UNSUBSCRIBED,
+    MQTT_EVENT_PUBLISHED,
+    MQTT_EVENT_DATA,
+    MQTT_EVENT_BEFORE_CONNECT,
+    MQTT_EVENT_DELETED,
+} esp_mqtt_event_id_t;
+
+typedef struct {
+    esp_mqtt_event_id_t      event_id;
+    esp_mqtt_client_handle_t client;
+    char *data;
+    int   data_len;
+    int   msg_id;
+    int   session_present;
+} esp_mqtt_event_t;
+typedef esp_mqtt_event_t *esp_mqtt_event_handle_t;
+
+typedef struct {
+    struct {
+        struct { const char *uri; } address;
+        struct { esp_err_t (*crt_bundle_attach)(void *); const char *common_name; } verification;
+    } broker;
+    struct {
+        const char *username;
+        const char *client_id;
+        struct { const char *password; } authentication;
+    } credentials;
+    struct { int keepalive; bool disable_clean_session; } session;
+    struct { int reconnect_timeout_ms; int timeout_ms; } network;
+} esp_mqtt_client_config_t;
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *cfg);
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t c);
+esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t c);
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t c, esp_mqtt_event_id_t id,
+                                         esp_event_handler_t h, void *arg);
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t c, const char *topic, const char *data,
+                            int len, int qos, int retain);
@@ -0,0 +1,3 @@
+// sdkconfig.h stand-in for the host tests: the CONFIG_ values the modules read
+#pragma once
+#define CONFIG_SAMPLE_QUEUE_CAP 1024
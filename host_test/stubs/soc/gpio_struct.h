@@ -0,0 +1,4 @@
+// soc/gpio_struct.h stand-in for the host tests: the register block is opaque
+#pragma once
+typedef struct { int unused; } gpio_dev_t;
+extern gpio_dev_t GPIO;
@@ -0,0 +1,143 @@
+//test_breaker.c
+// breaker.c state machine on a fake clock: trip, half-open trial, backoff, jitter
+#include "breaker.h"
+#include "test_util.h"
+
+#define S 1000000LL
+
+static void trip(breaker_t *b, int64_t now, uint32_t rnd)
+{
+    for (int i = 0; i < BRK_TRIP_FAILS; ++i) {
+        CHECK(brk_allow(b, now));
+        brk_failure(b, now, rnd);
+    }
+}
+
+// Closed until BRK_TRIP_FAILS failures in a row; a success resets the count
+static void test_trip(void)
+{
+    breaker_t b;
+    brk_init(&b);
+    for (int i = 0; i < BRK_TRIP_FAILS - 1; ++i) brk_failure(&b, 0, 0);
+    brk_success(&b);
+    for (int i = 0; i < BRK_TRIP_FAILS - 1; ++i) brk_failure(&b, 0, 0);
+    CHECK_EQ(b.state, BRK_CLOSED);
+    brk_failure(&b, 0, 0);
+    CHECK_EQ(b.state, BRK_OPEN);
+    CHECK_EQ(b.trips, 1);
+    CHECK(!brk_allow(&b, 1));
+    CHECK(!brk_ready(&b, 1));
+    CHECK_EQ(b.denied, 1);
+}
+
+// Exactly one trial once the backoff expires; its success closes the breaker
+static void test_half_open(void)
+{
+    breaker_t b;
+    brk_init(&b);
+    trip(&b, 0, 0);
+    int64_t t = brk_retry_in(&b, 0);
+    CHECK(!brk_allow(&b, t - 1));
+    CHECK(brk_ready(&b, t));
+    CHECK(brk_allow(&b, t));
+    CHECK_EQ(b.state, BRK_HALF_OPEN);
+    CHECK(!brk_allow(&b, t));          // trial out: everyone else waits
+    CHECK(!brk_ready(&b, t));
+    brk_success(&b);
+    CHECK_EQ(b.state, BRK_CLOSED);
+    CHECK(brk_allow(&b, t));
+
+    // a failed trial re-opens straight away (no BRK_TRIP_FAILS)
+    trip(&b, t, 0);
+    t += brk_retry_in(&b, t);
+    CHECK(brk_allow(&b, t));
+    brk_failure(&b, t, 0);
+    CHECK_EQ(b.state, BRK_OPEN);
+    CHECK(brk_retry_in(&b, t) > 0);
+}
+
+// A trial handed back (nothing sent) goes to the next caller; a trial that
+// never reports is given up after BRK_TRIAL_TIMEOUT_US
+static void test_trial_release_and_timeout(void)
+{
+    breaker_t b;
+    brk_init(&b);
+    trip(&b, 0, 0);
+    int64_t t = brk_retry_in(&b, 0);
+    CHECK(brk_allow(&b, t));
+    brk_release(&b);
+    CHECK_EQ(b.state, BRK_OPEN);
+    CHECK(brk_ready(&b, t));
+    CHECK(brk_allow(&b, t));
+    CHECK_EQ(b.state, BRK_HALF_OPEN);
+
+    // lost: no report, no release
+    CHECK(!brk_allow(&b, t + BRK_TRIAL_TIMEOUT_US - 1));
+    CHECK(brk_ready(&b, t + BRK_TRIAL_TIMEOUT_US));
+    CHECK(brk_allow(&b, t + BRK_TRIAL_TIMEOUT_US));
+    CHECK_EQ(b.lost, 1);
+    CHECK(!brk_allow(&b, t + BRK_TRIAL_TIMEOUT_US));  // the new trial is out
+    brk_success(&b);
+    CHECK_EQ(b.state, BRK_CLOSED);
+
+    // release is a no-op unless half-open
+    brk_release(&b);
+    CHECK_EQ(b.state, BRK_CLOSED);
+}
+
+// Each failed trial doubles the cap up to BRK_BACKOFF_MAX_US; the wait is
+// always within [cap/2, cap)
+static void test_backoff_and_jitter(void)
+{
+    const uint32_t rnds[] = { 0, 1, 0x7fffffffu, 0xfffffffeu, 0xffffffffu, 12345 };
+    for (unsigned r = 0; r < sizeof(rnds) / sizeof(rnds[0]); ++r) {
+        breaker_t b;
+        brk_init(&b);
+        int64_t t = 0;
+        trip(&b, t, rnds[r]);
+        int64_t cap = BRK_BACKOFF_MIN_US;
+        for (int k = 0; k < 12; ++k) {
+            int64_t w = brk_retry_in(&b, t);
+            CHECK(w >= cap / 2);
+            CHECK(w < cap);
+            t += w;
+            CHECK(brk_allow(&b, t));
+            brk_failure(&b, t, rnds[r]);
+            cap = cap * 2 > BRK_BACKOFF_MAX_US ? BRK_BACKOFF_MAX_US : cap * 2;
+        }
+        CHECK_EQ(cap, BRK_BACKOFF_MAX_US);   // 12 doublings reach the cap
+        CHECK_EQ(b.trips, 13);
+        // a success starts over at BRK_BACKOFF_MIN_US
+        t += brk_retry_in(&b, t);
+        CHECK(brk_allow(&b, t));
+        brk_success(&b);
+        trip(&b, t, rnds[r]);
+        CHECK(brk_retry_in(&b, t) < BRK_BACKOFF_MIN_US);
+    }
+}
+
+// Jitter spreads devices over the upper half of the window
+static void test_jitter_spread(void)
+{
+    int64_t lo = BRK_BACKOFF_MIN_US, hi = 0;
+    for (uint32_t r = 0; r < 100000; r += 7) {
+        breaker_t b;
+        brk_init(&b);
+        trip(&b, 0, r * 2654435761u);
+        int64_t w = brk_retry_in(&b, 0);
+        if (w < lo) lo = w;
+        if (w > hi) hi = w;
+    }
+    CHECK(lo < BRK_BACKOFF_MIN_US / 2 + 1 * S);
+    CHECK(hi > BRK_BACKOFF_MIN_US - 1 * S);
+}
+
+int main(void)
+{
+    test_trip();
+    test_half_open();
+    test_trial_release_and_timeout();
+    test_backoff_and_jitter();
+    test_jitter_spread();
+    TEST_DONE();
+}
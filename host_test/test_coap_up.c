@@ -0,0 +1,211 @@
+//test_coap_up.c
+// coap_up.c + ack_win.c against a scripted CoAP server on a loopback UDP
+// socket, in real time: piggybacked ACKs, a lost request, separate responses
+// slower than the retransmission timer, a response that never comes, and 4.xx
+#include <string.h>
+#include <pthread.h>
+#include "coap_up.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "esp_timer.h"
+#include "sample_q.h"
+#include "dns_cache.h"
+#include "test_util.h"
+
+// sample queue: readings 0..s_n-1 (t_c = index), one cursor; only the flush touches it
+static int s_n, s_cur, s_peeked, s_delivered[4096], s_ndeliv;
+int sq_peek_n(int sink, reading_t *o, int max)
+{
+    int n = 0;
+    for (; n < max && s_cur + n < s_n; ++n) o[n].t_c = (float)(s_cur + n);
+    s_peeked = n;
+    return n;
+}
+sq_mark_t sq_peek_mark(int sink, int k)
+{
+    return (sq_mark_t){ .ram = (uint32_t)(s_cur + (k < s_peeked ? k : s_peeked)) };
+}
+void sq_commit_mark(int sink, sq_mark_t m)
+{
+    CHECK((int)m.ram >= s_cur && (int)m.ram <= s_n);
+    while (s_cur < (int)m.ram) s_delivered[s_ndeliv++] = s_cur++;
+}
+void sq_abort(int sink) { s_peeked = 0; }
+
+bool dns_cache_lookup(const char *host, char *ip, size_t n) { snprintf(ip, n, "127.0.0.1"); return true; }
+void dns_cache_expire(const char *host) { }
+
+// payload: "[first,count]"
+static int enc(uint8_t *d, size_t cap, const reading_t *rs, int n)
+{
+    return snprintf((char *)d, cap, "[%d,%d]", (int)rs[0].t_c, n);
+}
+
+static void check_order(void)
+{
+    for (int i = 0; i < s_ndeliv; ++i) CHECK_EQ(s_delivered[i], i);
+}
+
+/* The server. Answers pings with RST and POSTs with a piggybacked 2.04, or
+   (s_sep_ms >= 0) an empty ACK and, s_sep_ms later, a CON 2.04 carrying
+   the token; s_sep_ms > 10 min never answers. Counts what it sees. */
+static pthread_mutex_t s_mu = PTHREAD_MUTEX_INITIALIZER;
+static int s_port, s_code = 0x44, s_sep_ms = -1, s_drop_nth;
+static volatile int s_posts, s_dup_posts, s_empty_acks, s_bad;
+static uint8_t s_seen[0x8000];
+
+typedef struct { int64_t due_us; uint8_t tok[2]; } later_t;
+static later_t s_later[16];
+static int s_nlater;
+
+// Uri-Path "ingest", "batch", Content-Format 50 (JSON), payload marker
+static bool request_ok(const uint8_t *m, int n)
+{
+    static const uint8_t opts[] = { 0xB6, 'i', 'n', 'g', 'e', 's', 't', 0x05, 'b', 'a', 't', 'c', 'h', 0x11, 50, 0xFF };
+    return n > 6 + (int)sizeof(opts) && (m[0] & 0x0F) == 2 && m[1] == 0x02 && memcmp(m + 6, opts, sizeof(opts)) == 0;
+}
+
+static void *server_main(void *arg)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) }, from;
+    socklen_t al = sizeof(a), fl;
+    bind(fd, (struct sockaddr *)&a, sizeof(a));
+    getsockname(fd, (struct sockaddr *)&a, &al);
+    struct timeval tv = { .tv_sec = 0, .tv_usec = 5000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    s_port = ntohs(a.sin_port);
+    uint16_t sep_mid = 0x100;
+    struct sockaddr_in peer = { 0 };
+
+    for (;;) {
+        uint8_t m[1500];
+        fl = sizeof(from);
+        int n = recvfrom(fd, m, sizeof(m), 0, (struct sockaddr *)&from, &fl);
+        pthread_mutex_lock(&s_mu);
+        // separate responses that are due
+        for (int i = 0; i < s_nlater; ) {
+            if (s_later[i].due_us > esp_timer_get_time()) { ++i; continue; }
+            sep_mid++;
+            uint8_t r[6] = { 0x42, (uint8_t)s_code, sep_mid >> 8, sep_mid & 0xFF, s_later[i].tok[0], s_later[i].tok[1] };
+            sendto(fd, r, sizeof(r), 0, (struct sockaddr *)&peer, sizeof(peer));
+            s_later[i] = s_later[--s_nlater];
+        }
+        if (n >= 4) {
+            int type = (m[0] >> 4) & 3, code = m[1];
+            uint16_t mid = (uint16_t)(m[2] << 8 | m[3]);
+            peer = from;
+            if (type == 0 && code == 0) {                 // ping → RST
+                uint8_t r[4] = { 0x70, 0, m[2], m[3] };
+                sendto(fd, r, sizeof(r), 0, (struct sockaddr *)&from, fl);
+            } else if (type == 2 && code == 0) {          // the client's ACK of a separate response
+                s_empty_acks++;
+            } else if (!request_ok(m, n)) {
+                s_bad++;
+            } else if (++s_posts == s_drop_nth) {
+                // lost on the way in
+            } else {
+                if (s_seen[mid & 0x7FFF]++) s_dup_posts++;
+                if (s_sep_ms < 0) {
+                    uint8_t r[6] = { 0x62, (uint8_t)s_code, m[2], m[3], m[4], m[5] };
+                    sendto(fd, r, sizeof(r), 0, (struct sockaddr *)&from, fl);
+                } else {
+                    uint8_t e[4] = { 0x60, 0, m[2], m[3] };
+                    sendto(fd, e, sizeof(e), 0, (struct sockaddr *)&from, fl);
+                    if (s_nlater < 16 && s_sep_ms < 600000) {
+                        s_later[s_nlater++] = (later_t){ esp_timer_get_time() + s_sep_ms * 1000LL, { m[4], m[5] } };
+                    }
+                }
+            }
+        }
+        pthread_mutex_unlock(&s_mu);
+    }
+    return NULL;
+}
+
+static void server_set(int code, int sep_ms, int drop_nth)
+{
+    pthread_mutex_lock(&s_mu);
+    s_code = code;
+    s_sep_ms = sep_ms;
+    s_drop_nth = drop_nth ? s_posts + drop_nth : 0;
+    s_nlater = 0;
+    memset(s_seen, 0, sizeof(s_seen));
+    s_dup_posts = 0;
+    pthread_mutex_unlock(&s_mu);
+}
+
+int main(void)
+{
+    pthread_t th;
+    pthread_create(&th, NULL, server_main, NULL);
+    while (!s_port) vTaskDelay(5);
+    char base[48];
+    snprintf(base, sizeof(base), "coap://localhost:%d", s_port);
+
+    CHECK(coap_up_probe(base, 1000) > 0);
+    coap_up_cfg_t cfg = { .base = base, .path = "ingest/batch", .json = true, .enc = enc };
+    CHECK(coap_up_open(0, &cfg));
+    CHECK(coap_up_ping(0, 1000));
+    int msgs, posts;
+
+    // piggybacked responses: 50 readings in batches of COAP_BATCH_MAX, then one at a time
+    s_n = 50;
+    CHECK_EQ(coap_up_flush(0, &msgs), 50);
+    CHECK_EQ(msgs, (50 + COAP_BATCH_MAX - 1) / COAP_BATCH_MAX);
+    for (int i = 0; i < 5; ++i) {
+        s_n++;
+        CHECK_EQ(coap_up_flush(0, &msgs), 1);
+    }
+    check_order();
+
+    // the second POST is lost: retransmitted after COAP_ACK_TIMEOUT_MS, same message id
+    server_set(0x44, -1, 2);
+    posts = s_posts;
+    s_n = 80;
+    int64_t t0 = esp_timer_get_time();
+    CHECK_EQ(coap_up_flush(0, &msgs), 25);
+    CHECK(esp_timer_get_time() - t0 >= COAP_ACK_TIMEOUT_MS * 1000LL);
+    CHECK_EQ(s_posts - posts, msgs + 1);
+    CHECK_EQ(s_dup_posts, 0);
+    check_order();
+
+    // empty ACK, then the response after longer than the retransmission timer:
+    // no POST is sent twice, each response is acked, everything commits
+    server_set(0x44, COAP_ACK_TIMEOUT_MS + 500, 0);
+    posts = s_posts;
+    int acks = s_empty_acks;
+    s_n = 112;
+    CHECK_EQ(coap_up_flush(0, &msgs), 32);
+    CHECK_EQ(msgs, 4);
+    CHECK_EQ(s_posts - posts, msgs);
+    CHECK_EQ(s_dup_posts, 0);
+    for (int t = 0; s_empty_acks - acks < msgs && t < 500; t += 10) vTaskDelay(10);   // the last ACKs may still be on the way
+    CHECK_EQ(s_empty_acks - acks, msgs);
+    check_order();
+
+    // empty ACK and no response ever: nothing retransmitted, the flush gives up
+    // COAP_RESP_TIMEOUT_MS after the ACK and the readings go out again next time
+    server_set(0x44, 3600 * 1000, 0);
+    posts = s_posts;
+    s_n = 120;
+    t0 = esp_timer_get_time();
+    CHECK_EQ(coap_up_flush(0, &msgs), -1);
+    CHECK(esp_timer_get_time() - t0 >= COAP_RESP_TIMEOUT_MS * 1000LL);
+    CHECK_EQ(s_posts - posts, 1);
+    CHECK_EQ(s_cur, 112);
+    server_set(0x44, -1, 0);
+    CHECK_EQ(coap_up_flush(0, &msgs), 8);
+    check_order();
+
+    // 4.00: the server will never take it, dropped like an HTTP 4xx
+    server_set(0x80, -1, 0);
+    s_n = 130;
+    coap_up_flush(0, &msgs);
+    CHECK_EQ(s_cur, 130);
+    CHECK_EQ(s_bad, 0);
+
+    coap_up_log_stats(0);
+    coap_up_close(0);
+    TEST_DONE();
+}
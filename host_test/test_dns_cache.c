@@ -0,0 +1,134 @@
+//test_dns_cache.c
+// dns_cache.c hits, TTL expiry, last-known-good fallback and the stats line,
+// with getaddrinfo replaced by a scripted resolver and a fake clock
+#include <string.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include "dns_cache.h"
+#include "lwip/dns.h"
+#include "host_stubs.h"
+#include "test_util.h"
+
+#define S 1000000LL
+
+// no DHCP DNS server: every miss goes to getaddrinfo (TTL = DNS_TTL_FALLBACK_S, 60 s)
+const ip_addr_t *dns_getserver(uint8_t numdns) { return NULL; }
+
+// the scripted resolver: answers s_addr unless s_fail, counts calls
+static const char *s_addr = "10.0.0.1";
+static bool s_fail = false;
+static int  s_calls = 0;
+static struct sockaddr_in s_sa;
+static struct addrinfo s_ai;
+
+int getaddrinfo(const char *node, const char *service, const struct addrinfo *hints, struct addrinfo **res)
+{
+    s_calls++;
+    host_now_us += 20000;   // a 20 ms lookup
+    if (s_fail) return EAI_FAIL;
+    memset(&s_sa, 0, sizeof(s_sa));
+    s_sa.sin_family = AF_INET;
+    inet_aton(s_addr, &s_sa.sin_addr);
+    memset(&s_ai, 0, sizeof(s_ai));
+    s_ai.ai_family = AF_INET;
+    s_ai.ai_addr = (struct sockaddr *)&s_sa;
+    s_ai.ai_addrlen = sizeof(s_sa);
+    *res = &s_ai;
+    return 0;
+}
+
+void freeaddrinfo(struct addrinfo *res) {}
+
+static bool lookup(const char *host, const char *want)
+{
+    char ip[16] = "";
+    bool ok = dns_cache_lookup(host, ip, sizeof(ip));
+    if (want) CHECK(strcmp(ip, want) == 0);
+    return ok;
+}
+
+static void test_literal_hit_expiry(void)
+{
+    host_now_us = 1000 * S;
+    CHECK(lookup("172.16.0.123", "172.16.0.123"));
+    CHECK_EQ(s_calls, 0);
+
+    CHECK(lookup("ingest.example", "10.0.0.1"));
+    CHECK_EQ(s_calls, 1);
+    CHECK(lookup("ingest.example", "10.0.0.1"));
+    CHECK_EQ(s_calls, 1);                       // fresh: no lookup
+
+    host_now_us += 61 * S;                      // past the 60 s fallback TTL
+    s_addr = "10.0.0.2";
+    CHECK(lookup("ingest.example", "10.0.0.2"));
+    CHECK_EQ(s_calls, 2);
+
+    dns_cache_expire("ingest.example");         // e.g. a connect failed
+    CHECK(lookup("ingest.example", "10.0.0.2"));
+    CHECK_EQ(s_calls, 3);
+}
+
+static void test_last_known_good(void)
+{
+    dns_cache_stats_t a, b;
+    dns_cache_get_stats(&a);
+    host_now_us += 61 * S;
+    s_fail = true;
+    CHECK(lookup("ingest.example", "10.0.0.2"));    // expired, resolver down: old address
+    host_now_us += 23 * 3600 * S;
+    CHECK(lookup("ingest.example", "10.0.0.2"));    // still inside DNS_LKG_MAX_S
+    host_now_us += 2 * 3600 * S;
+    CHECK(!lookup("ingest.example", NULL));         // too old to trust
+    CHECK(!lookup("unknown.example", NULL));        // nothing cached
+    s_fail = false;
+    dns_cache_get_stats(&b);
+    CHECK_EQ(b.stale - a.stale, 2);
+    CHECK_EQ(b.failures - a.failures, 2);
+    CHECK_EQ(b.misses - a.misses, 4);
+}
+
+// DNS_CACHE_SIZE hosts fit; one more evicts the least recently used
+static void test_lru(void)
+{
+    char host[32];
+    host_now_us += 3600 * S;
+    for (int i = 0; i < DNS_CACHE_SIZE; ++i) {
+        snprintf(host, sizeof(host), "h%d.example", i);
+        lookup(host, NULL);
+        host_now_us += S;
+    }
+    lookup("h0.example", NULL);                     // h1 is now the oldest
+    int calls = s_calls;
+    lookup("extra.example", NULL);
+    lookup("h0.example", NULL);
+    CHECK_EQ(s_calls, calls + 1);                   // h0 kept
+    lookup("h1.example", NULL);
+    CHECK_EQ(s_calls, calls + 2);                   // h1 evicted
+}
+
+static void test_format(void)
+{
+    dns_cache_stats_t st;
+    dns_cache_get_stats(&st);
+    char line[96], want[96];
+    int n = dns_cache_format_stats(line, sizeof(line));
+    snprintf(want, sizeof(want), "hits=%u misses=%u avg_ms=20 lkg=%u fail=%u",
+             (unsigned)st.hits, (unsigned)st.misses, (unsigned)st.stale, (unsigned)st.failures);
+    CHECK(strcmp(line, want) == 0);
+    CHECK_EQ(n, strlen(want));
+    CHECK(strpbrk(line, "\r\n:") == NULL);          // safe as a header value
+    printf("  X-DNS-Stats: %s\n", line);
+
+    char small[10];
+    CHECK_EQ(dns_cache_format_stats(small, sizeof(small)), 9);
+    CHECK_EQ(strlen(small), 9);
+}
+
+int main(void)
+{
+    test_literal_hit_expiry();
+    test_last_known_good();
+    test_lru();
+    test_format();
+    TEST_DONE();
+}
@@ -0,0 +1,185 @@
+//test_dns_query.c
+// dns_cache.c's own A query against a scripted UDP server on 127.0.0.1:
+// which replies it believes (the server's, echoing the question) and which not
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "dns_cache.h"
+#include "lwip/dns.h"
+#include "host_stubs.h"
+#include "test_util.h"
+
+// DNS_SERVER_PORT comes from the Makefile; dns_cache.c sends there
+static ip_addr_t s_srv;
+const ip_addr_t *dns_getserver(uint8_t numdns) { return &s_srv; }
+
+// the fallback resolver stays out of it: a query that failed is a failed lookup
+static int s_gai_calls;
+int getaddrinfo(const char *node, const char *service, const struct addrinfo *hints, struct addrinfo **res)
+{
+    s_gai_calls++;
+    return EAI_FAIL;
+}
+void freeaddrinfo(struct addrinfo *res) {}
+
+// What the server sends back for the next query, in this order
+typedef enum {
+    R_GOOD,         // the answer (s_addr, TTL 300)
+    R_SPOOF,        // the same answer, 10.6.6.6, from another port
+    R_WRONG_ID,
+    R_WRONG_NAME,
+    R_WRONG_TYPE,   // QTYPE AAAA
+    R_NO_QUESTION,  // QDCOUNT 0
+    R_UPPER,        // the answer with the QNAME upper-cased (0x20 randomisation)
+} reply_t;
+
+static reply_t s_script[8];
+static int s_nscript;
+static const char *s_addr = "10.0.0.5";
+static int s_sock;
+
+static void reply(const uint8_t *q, int qlen, const struct sockaddr_in *to, reply_t r)
+{
+    uint8_t m[512];
+    memcpy(m, q, qlen);
+    m[2] = 0x81; m[3] = 0x80;   // QR RD RA, RCODE 0
+    m[7] = 1;                   // ANCOUNT
+    int n = qlen;
+    static const uint8_t rr[] = { 0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0x01, 0x2C, 0, 4 };   // A IN 300 s
+    memcpy(m + n, rr, sizeof(rr));
+    n += sizeof(rr);
+    struct in_addr a;
+    inet_aton(r == R_SPOOF ? "10.6.6.6" : s_addr, &a);
+    memcpy(m + n, &a, 4);
+    n += 4;
+
+    int s = s_sock;
+    switch (r) {
+    case R_SPOOF:       s = socket(AF_INET, SOCK_DGRAM, 0); break;
+    case R_WRONG_ID:    m[1] ^= 0x5A; break;
+    case R_WRONG_NAME:  m[13] ^= 0x01; break;
+    case R_WRONG_TYPE:  m[qlen - 3] = 28; break;
+    case R_NO_QUESTION: m[5] = 0; break;
+    case R_UPPER:
+        for (int i = 12; i < qlen - 4; ++i) if (m[i] >= 'a' && m[i] <= 'z') m[i] -= 'a' - 'A';
+        break;
+    default: break;
+    }
+    sendto(s, m, n, 0, (const struct sockaddr *)to, sizeof(*to));
+    if (s != s_sock) close(s);
+}
+
+static void *server(void *arg)
+{
+    for (;;) {
+        uint8_t q[512];
+        struct sockaddr_in from;
+        socklen_t fl = sizeof(from);
+        int qlen = recvfrom(s_sock, q, sizeof(q), 0, (struct sockaddr *)&from, &fl);
+        if (qlen < 12) continue;
+        for (int i = 0; i < s_nscript; ++i) reply(q, qlen, &from, s_script[i]);
+    }
+    return NULL;
+}
+
+static void script(int n, const reply_t *r)
+{
+    memcpy(s_script, r, n * sizeof(*r));
+    s_nscript = n;
+}
+
+static bool lookup(const char *host, char *ip)
+{
+    ip[0] = 0;
+    return dns_cache_lookup(host, ip, 16);
+}
+
+static uint32_t rejected(void)
+{
+    dns_cache_stats_t st;
+    dns_cache_get_stats(&st);
+    return st.rejected;
+}
+
+static void test_good(void)
+{
+    char ip[16];
+    script(1, (reply_t[]){ R_GOOD });
+    CHECK(lookup("a.example", ip));
+    CHECK(strcmp(ip, "10.0.0.5") == 0);
+    CHECK_EQ(rejected(), 0);
+
+    // cached for the record's TTL, 300 s
+    s_addr = "10.0.0.7";
+    host_now_us += 299 * 1000000LL;
+    CHECK(lookup("a.example", ip));
+    CHECK(strcmp(ip, "10.0.0.5") == 0);
+    host_now_us += 2 * 1000000LL;
+    CHECK(lookup("a.example", ip));
+    CHECK(strcmp(ip, "10.0.0.7") == 0);
+}
+
+// the connected socket never sees it: not even counted
+static void test_spoofed_source(void)
+{
+    char ip[16];
+    s_addr = "10.0.0.8";
+    script(2, (reply_t[]){ R_SPOOF, R_GOOD });
+    CHECK(lookup("b.example", ip));
+    CHECK(strcmp(ip, "10.0.0.8") == 0);
+    CHECK_EQ(rejected(), 0);
+}
+
+static void test_not_our_question(void)
+{
+    char ip[16];
+    uint32_t r0 = rejected();
+    s_addr = "10.0.0.9";
+    script(4, (reply_t[]){ R_WRONG_NAME, R_WRONG_TYPE, R_NO_QUESTION, R_GOOD });
+    CHECK(lookup("c.example", ip));
+    CHECK(strcmp(ip, "10.0.0.9") == 0);
+    CHECK_EQ(rejected() - r0, 3);
+
+    r0 = rejected();
+    script(2, (reply_t[]){ R_WRONG_ID, R_UPPER });
+    CHECK(lookup("d.example", ip));
+    CHECK(strcmp(ip, "10.0.0.9") == 0);
+    CHECK_EQ(rejected() - r0, 1);
+}
+
+// nothing but junk: the query gives up after DNS_QUERY_TRIES datagrams
+// (not the 2 s timeout) and the lookup fails rather than believing one
+static void test_only_junk(void)
+{
+    char ip[16];
+    uint32_t r0 = rejected();
+    int gai = s_gai_calls;
+    script(4, (reply_t[]){ R_WRONG_ID, R_WRONG_NAME, R_WRONG_TYPE, R_NO_QUESTION });
+    CHECK(!lookup("e.example", ip));
+    CHECK_EQ(rejected() - r0, 4);
+    CHECK_EQ(s_gai_calls - gai, 1);
+}
+
+int main(void)
+{
+    s_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_port = htons(DNS_SERVER_PORT) };
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(s_sock, (struct sockaddr *)&a, sizeof(a)) != 0) {
+        perror("bind");
+        return 1;
+    }
+    s_srv.u_addr_ip4.addr = a.sin_addr.s_addr;
+    pthread_t t;
+    pthread_create(&t, NULL, server, NULL);
+
+    host_now_us = 1000 * 1000000LL;
+    test_good();
+    test_spoofed_source();
+    test_not_our_question();
+    test_only_junk();
+    TEST_DONE();
+}
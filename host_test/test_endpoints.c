@@ -0,0 +1,115 @@
+//test_endpoints.c
+// endpoints.c re-probe timing from decayed scores, on a fake clock
+#include <math.h>
+#include "endpoints.h"
+#include "breaker.h"
+#include "host_stubs.h"
+#include "test_util.h"
+
+#define S  1000000LL
+#define MS 1000LL
+
+// one sink, LAN preferred over the cloud
+static void load_two(void)
+{
+    host_kv_endpoints = "0=http://lan:3000;1=https://cloud";
+    CHECK_EQ(ep_load(NULL, 0), 2);
+}
+
+static void report_n(int ep, bool ok, int64_t rtt_us, int n)
+{
+    for (int i = 0; i < n; ++i) ep_report(ep, ok, rtt_us);
+}
+
+// A fast LAN server that failed is re-probed once its decayed errors would
+// let it beat the cloud, well before the confidence floor, and one good
+// probe then moves the sink back
+static void test_decay_reprobe(void)
+{
+    host_now_us = 1000 * S;
+    load_two();
+    report_n(0, true, 20 * MS, 30);    // LAN rtt -> ~20 ms
+    report_n(1, true, 300 * MS, 30);   // cloud rtt -> ~300 ms
+    report_n(0, false, 0, 2);          // LAN errs, breaker still closed
+    CHECK_EQ(ep_best(0, 0), 1);
+    int cur = 1;
+
+    CHECK_EQ(ep_next_probe(0, cur, host_now_us), -1);   // just failed: not yet
+    int64_t in = ep_probe_in_us(0, cur, host_now_us);
+    CHECK(in > 10 * S);
+    CHECK(in < 9 * 60 * S);                             // before the confidence floor
+    printf("  LAN due for a re-probe after %lld s\n", (long long)(in / S));
+
+    host_now_us += in - S;
+    CHECK_EQ(ep_next_probe(0, cur, host_now_us), -1);
+    host_now_us += S;
+    CHECK_EQ(ep_next_probe(0, cur, host_now_us), 0);
+    CHECK_EQ(ep_probe_in_us(0, cur, host_now_us), 0);
+
+    ep_report(0, true, 20 * MS);                       // the probe answers
+    CHECK_EQ(ep_best(0, cur), 0);
+}
+
+// A server that can't win on rtt + prio is still re-probed once its stats
+// are too old to trust (conf < EP_CONF_MIN, ~9 min), not on every cycle
+static void test_confidence_floor(void)
+{
+    host_now_us = 1000 * S;
+    load_two();
+    report_n(0, true, 20 * MS, 30);
+    report_n(1, true, 900 * MS, 30);
+    int cur = 0;
+    CHECK_EQ(ep_best(0, -1), 0);
+
+    int64_t in = ep_probe_in_us(0, cur, host_now_us);
+    CHECK(in > 8 * 60 * S && in < 10 * 60 * S);
+    host_now_us += in - S;
+    CHECK_EQ(ep_next_probe(0, cur, host_now_us), -1);
+    host_now_us += S;
+    CHECK_EQ(ep_next_probe(0, cur, host_now_us), 1);
+
+    ep_report(1, true, 900 * MS);                      // fresh again: next one a floor later
+    in = ep_probe_in_us(0, cur, host_now_us);
+    CHECK(in > 8 * 60 * S);
+}
+
+// A never-probed endpoint is due at once; an open breaker postpones it to
+// the backoff, and a half-open one (trial out) is no candidate
+static void test_breaker_gates(void)
+{
+    host_now_us = 1000 * S;
+    load_two();
+    report_n(1, true, 300 * MS, 5);
+    CHECK_EQ(ep_next_probe(0, 1, host_now_us), 0);
+
+    report_n(0, false, 0, BRK_TRIP_FAILS);             // opens LAN's breaker
+    int64_t retry = ep_retry_in_us(0, host_now_us);
+    CHECK(retry > 0);
+    CHECK(ep_probe_in_us(0, 1, host_now_us) >= retry);
+    CHECK_EQ(ep_next_probe(0, 1, host_now_us), -1);
+
+    host_now_us += retry;
+    CHECK(ep_allow(0, host_now_us));                   // takes the trial
+    CHECK_EQ(ep_next_probe(0, 1, host_now_us), -1);
+    CHECK_EQ(ep_probe_in_us(0, 1, host_now_us), -1);
+}
+
+// Only endpoints of the same sink are candidates
+static void test_single_endpoint(void)
+{
+    host_now_us = 1000 * S;
+    host_kv_endpoints = "0=http://lan:3000;0@1=https://cloud";
+    CHECK_EQ(ep_load(NULL, 0), 2);
+    CHECK_EQ(ep_sinks(), 2);
+    CHECK_EQ(ep_next_probe(0, 0, host_now_us), -1);
+    CHECK_EQ(ep_probe_in_us(1, 1, host_now_us), -1);
+}
+
+int main(void)
+{
+    test_decay_reprobe();
+    test_confidence_floor();
+    test_breaker_gates();
+    test_single_endpoint();
+    TEST_DONE();
+}
@@ -0,0 +1,319 @@
+//test_ingest_enc.c
+// Round-trips for the batch encoders (ingest_enc.c): JSON, fmt 1..4, size bounds
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "ingest_enc.h"
+#include "test_util.h"
+
+#define DEV "FM-0123456789AB"
+
+// ---------- reference decoders (what the server does) ----------
+typedef struct {
+    const uint8_t *p, *end;
+    bool bad;
+} rd_t;
+
+static uint64_t rd_le(rd_t *r, int n)
+{
+    uint64_t v = 0;
+    if (r->p + n > r->end) { r->bad = true; return 0; }
+    for (int i = 0; i < n; ++i) v |= (uint64_t)r->p[i] << (8 * i);
+    r->p += n;
+    return v;
+}
+
+static uint64_t rd_varint(rd_t *r)
+{
+    uint64_t v = 0;
+    for (int sh = 0; sh < 64; sh += 7) {
+        uint8_t b = (uint8_t)rd_le(r, 1);
+        v |= (uint64_t)(b & 0x7F) << sh;
+        if (!(b & 0x80)) return v;
+    }
+    r->bad = true;
+    return 0;
+}
+
+static int64_t rd_zz(rd_t *r)
+{
+    uint64_t v = rd_varint(r);
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// header; returns fmt, or -1
+static int rd_header(rd_t *r, char *id)
+{
+    if (rd_le(r, 1) != 'F' || rd_le(r, 1) != 'M') return -1;
+    int fmt = (int)rd_le(r, 1);
+    size_t id_len = (size_t)rd_le(r, 1);
+    if (r->p + id_len > r->end) return -1;
+    memcpy(id, r->p, id_len);
+    id[id_len] = 0;
+    r->p += id_len;
+    return fmt;
+}
+
+// runs of a byte column: { val:u8 | run:varint } covering n readings
+static bool rd_runs(rd_t *r, uint8_t *col, int n)
+{
+    for (int i = 0; i < n; ) {
+        uint8_t v = (uint8_t)rd_le(r, 1);
+        uint64_t run = rd_varint(r);
+        if (r->bad || run == 0 || i + run > (uint64_t)n) return false;
+        while (run--) col[i++] = v;
+    }
+    return true;
+}
+
+static int decode(const uint8_t *buf, int len, char *id, int *fmt_out, reading_t *rs, int max)
+{
+    rd_t r = { buf, buf + len, false };
+    int fmt = rd_header(&r, id);
+    *fmt_out = fmt;
+    if (fmt == INGEST_BIN_FMT_RECORDS || fmt == INGEST_BIN_FMT_CH_RECORDS) {
+        int n = (int)rd_le(&r, 2);
+        if (n > max) return -1;
+        for (int i = 0; i < n; ++i) {
+            rs[i].ts_ms_utc = (int64_t)rd_le(&r, 8);
+            rs[i].t_c = (int16_t)rd_le(&r, 2) / 100.0f;
+            rs[i].sr = (uint8_t)rd_le(&r, 1);
+            rs[i].ch = fmt == INGEST_BIN_FMT_CH_RECORDS ? (uint8_t)rd_le(&r, 1) : 0;
+        }
+        return r.bad || r.p != r.end ? -1 : n;
+    }
+    if (fmt == INGEST_BIN_FMT_DELTA || fmt == INGEST_BIN_FMT_CH_DELTA) {
+        int n = (int)rd_varint(&r);
+        if (n < 1 || n > max) return -1;
+        int64_t ts0 = (int64_t)rd_le(&r, 8);
+        int64_t q0 = rd_zz(&r);
+        int64_t period = (int64_t)rd_varint(&r);
+        uint8_t ch[256] = {0}, sr[256];
+        if (n > 256) return -1;
+        if (fmt == INGEST_BIN_FMT_CH_DELTA && !rd_runs(&r, ch, n)) return -1;
+        int64_t ts[256], q[256];
+        ts[0] = ts0; q[0] = q0;
+        // previous reading of the same channel (fmt 4) or the previous one (fmt 2)
+        for (int i = 1; i < n; ++i) {
+            int j = i - 1;
+            if (fmt == INGEST_BIN_FMT_CH_DELTA) { while (j >= 0 && ch[j] != ch[i]) j--; }
+            int64_t d = rd_zz(&r);
+            ts[i] = j < 0 ? ts0 + d : ts[j] + period + d;
+        }
+        for (int i = 1; i < n; ++i) {
+            int j = i - 1;
+            if (fmt == INGEST_BIN_FMT_CH_DELTA) { while (j >= 0 && ch[j] != ch[i]) j--; }
+            q[i] = (j < 0 ? q0 : q[j]) + rd_zz(&r);
+        }
+        if (!rd_runs(&r, sr, n)) return -1;
+        for (int i = 0; i < n; ++i) {
+            rs[i].ts_ms_utc = ts[i];
+            rs[i].t_c = (float)q[i] / 128.0f;
+            rs[i].sr = sr[i];
+            rs[i].ch = ch[i];
+        }
+        return r.bad || r.p != r.end ? -1 : n;
+    }
+    return -1;
+}
+
+static int decode_json(const char *s, char *id, reading_t *rs, int max)
+{
+    if (sscanf(s, "{\"device_id\":\"%63[^\"]\",\"readings\":[", id) != 1) return -1;
+    const char *p = strchr(s, '[') + 1;
+    int n = 0;
+    while (*p == '{' && n < max) {
+        unsigned sr, ch; long long ts; int used = 0;
+        if (sscanf(p, "{\"temp_c\":%f,\"sr\":%u,\"ch\":%u,\"ts_ms\":%lld}%n",
+                   &rs[n].t_c, &sr, &ch, &ts, &used) != 4 || !used) return -1;
+        rs[n].sr = (uint8_t)sr; rs[n].ch = (uint8_t)ch; rs[n].ts_ms_utc = ts;
+        n++;
+        p += used;
+        if (*p == ',') p++;
+    }
+    return strcmp(p, "]}") == 0 ? n : -1;
+}
+
+// ---------- fixtures ----------
+// a steady backlog: one reading per period, a few ms of jitter, slow drift, one fault
+static void steady(reading_t *rs, int n, int chans, uint32_t period_ms)
+{
+    for (int i = 0; i < n; ++i) {
+        int sweep = i / chans;
+        rs[i].ch = (uint8_t)(i % chans);
+        rs[i].ts_ms_utc = 1760000000000LL + (int64_t)sweep * period_ms + (i * 7) % 5 + rs[i].ch;
+        // on the 1/128 °C grid, so the delta formats are exact
+        rs[i].t_c = (-8000 + sweep * 3 - (sweep % 4) + rs[i].ch * 640) / 128.0f;
+        rs[i].sr = (i == n / 2) ? 0x01 : 0;
+    }
+}
+
+static bool same(const reading_t *a, const reading_t *b, int n, float tol)
+{
+    for (int i = 0; i < n; ++i) {
+        if (a[i].ts_ms_utc != b[i].ts_ms_utc || a[i].sr != b[i].sr || a[i].ch != b[i].ch ||
+            fabsf(a[i].t_c - b[i].t_c) > tol) {
+            fprintf(stderr, "reading %d differs: %lld %.4f %u %u vs %lld %.4f %u %u\n", i,
+                    (long long)a[i].ts_ms_utc, a[i].t_c, a[i].sr, a[i].ch,
+                    (long long)b[i].ts_ms_utc, b[i].t_c, b[i].sr, b[i].ch);
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---------- tests ----------
+static void test_json(void)
+{
+    reading_t rs[8], back[8];
+    char buf[INGEST_JSON_MAX(8)], id[64];
+    steady(rs, 8, 1, 15000);
+    int len = ingest_enc_json(buf, sizeof(buf), DEV, rs, 8);
+    CHECK(len > 0 && len == (int)strlen(buf));
+    CHECK_EQ(decode_json(buf, id, back, 8), 8);
+    CHECK(strcmp(id, DEV) == 0);
+    CHECK(same(rs, back, 8, 0.0051f));
+
+    // channels come through as "ch"
+    steady(rs, 8, 4, 15000);
+    CHECK(ingest_enc_json(buf, sizeof(buf), DEV, rs, 8) > 0);
+    CHECK_EQ(decode_json(buf, id, back, 8), 8);
+    CHECK(same(rs, back, 8, 0.0051f));
+
+    // one byte short of what it needs (the terminating NUL)
+    steady(rs, 8, 1, 15000);
+    CHECK_EQ(ingest_enc_json(buf, (size_t)len, DEV, rs, 8), -1);
+    CHECK_EQ(ingest_enc_json(buf, (size_t)len + 1, DEV, rs, 8), len);
+
+    // widest fields still fit INGEST_JSON_MAX
+    for (int i = 0; i < 8; ++i) {
+        rs[i] = (reading_t){ .t_c = -999.99f, .sr = 255, .ch = 255, .ts_ms_utc = INT64_MAX };
+    }
+    char big[INGEST_JSON_MAX(8)];
+    CHECK(ingest_enc_json(big, sizeof(big), "0123456789012345678901234567890", rs, 8) > 0);
+}
+
+static void test_bin(void)
+{
+    enum { N = 40 };
+    reading_t rs[N], back[N];
+    uint8_t buf[INGEST_BIN_MAX(N)];
+    char id[64];
+    int fmt;
+
+    steady(rs, N, 1, 15000);
+    int len = ingest_enc_bin(buf, sizeof(buf), DEV, rs, N);
+    CHECK_EQ(len, 4 + (int)strlen(DEV) + 2 + N * INGEST_BIN_REC_SIZE);
+    CHECK_EQ(decode(buf, len, id, &fmt, back, N), N);
+    CHECK_EQ(fmt, INGEST_BIN_FMT_RECORDS);
+    CHECK(strcmp(id, DEV) == 0);
+    CHECK(same(rs, back, N, 0.0051f));
+    CHECK_EQ(ingest_enc_bin(buf, (size_t)len - 1, DEV, rs, N), -1);
+
+    // fmt 3 as soon as any reading is off channel 0
+    steady(rs, N, 4, 15000);
+    len = ingest_enc_bin(buf, sizeof(buf), DEV, rs, N);
+    CHECK_EQ(len, 4 + (int)strlen(DEV) + 2 + N * INGEST_BIN_CH_REC_SIZE);
+    CHECK_EQ(decode(buf, len, id, &fmt, back, N), N);
+    CHECK_EQ(fmt, INGEST_BIN_FMT_CH_RECORDS);
+    CHECK(same(rs, back, N, 0.0051f));
+    CHECK_EQ(ingest_enc_bin(buf, (size_t)len - 1, DEV, rs, N), -1);
+
+    // clamped to int16 centi-degrees
+    rs[0].t_c = 1000.0f; rs[1].t_c = -1000.0f;
+    len = ingest_enc_bin(buf, sizeof(buf), DEV, rs, N);
+    CHECK_EQ(decode(buf, len, id, &fmt, back, N), N);
+    CHECK(back[0].t_c > 327.6f && back[1].t_c < -327.6f);
+
+    // empty batch and an id that does not fit the u8 length
+    CHECK_EQ(ingest_enc_bin(buf, sizeof(buf), DEV, rs, 0), 4 + (int)strlen(DEV) + 2);
+    char longid[300];
+    memset(longid, 'x', sizeof(longid) - 1); longid[sizeof(longid) - 1] = 0;
+    CHECK_EQ(ingest_enc_bin(buf, sizeof(buf), longid, rs, 1), -1);
+}
+
+static void test_delta(void)
+{
+    enum { N = 64 };
+    reading_t rs[N], back[N];
+    uint8_t buf[INGEST_DELTA_MAX(N)];
+    char id[64];
+    int fmt;
+
+    steady(rs, N, 1, 15000);
+    int len = ingest_enc_delta(buf, sizeof(buf), DEV, rs, N, 15000);
+    CHECK(len > 0);
+    CHECK_EQ(decode(buf, len, id, &fmt, back, N), N);
+    CHECK_EQ(fmt, INGEST_BIN_FMT_DELTA);
+    CHECK(same(rs, back, N, 0.0f));
+    // a steady backlog is ~3 bytes per reading
+    CHECK(len < 4 + (int)strlen(DEV) + 24 + N * 3);
+    printf("delta fmt 2: %d readings in %d B (bin %d B)\n", N, len,
+           4 + (int)strlen(DEV) + 2 + N * INGEST_BIN_REC_SIZE);
+    // any cap below the worst case is refused up front, even if this batch would fit
+    CHECK_EQ(ingest_enc_delta(buf, (size_t)len, DEV, rs, N, 15000) < 0 || len == (int)sizeof(buf), 1);
+
+    // interleaved channels: fmt 4, deltas per channel
+    steady(rs, N, 4, 15000);
+    len = ingest_enc_delta(buf, sizeof(buf), DEV, rs, N, 15000);
+    CHECK(len > 0);
+    CHECK_EQ(decode(buf, len, id, &fmt, back, N), N);
+    CHECK_EQ(fmt, INGEST_BIN_FMT_CH_DELTA);
+    CHECK(same(rs, back, N, 0.0f));
+    printf("delta fmt 4: %d readings / 4 channels in %d B (bin %d B)\n", N, len,
+           4 + (int)strlen(DEV) + 2 + N * INGEST_BIN_CH_REC_SIZE);
+
+    // a single reading, and n < 1
+    CHECK(ingest_enc_delta(buf, sizeof(buf), DEV, rs, 1, 15000) > 0);
+    CHECK_EQ(ingest_enc_delta(buf, sizeof(buf), DEV, rs, 0, 15000), -1);
+
+    // off-grid temperatures round to the nearest 1/128 °C
+    steady(rs, 4, 1, 15000);
+    rs[2].t_c += 0.003f;
+    len = ingest_enc_delta(buf, sizeof(buf), DEV, rs, 4, 15000);
+    CHECK_EQ(decode(buf, len, id, &fmt, back, 4), 4);
+    CHECK(same(rs, back, 4, 1.0f / 256));
+}
+
+// every column at its widest: INGEST_DELTA_MAX must hold, and cap == bound must do
+static void test_delta_worst_case(void)
+{
+    enum { N = 200 };
+    static reading_t rs[N], back[N];
+    static uint8_t buf[INGEST_DELTA_MAX(N)];
+    char id[300];
+    memset(id, 'd', 255); id[255] = 0;   // longest id
+
+    for (int fmtch = 0; fmtch < 2; ++fmtch) {
+        for (int i = 0; i < N; ++i) {
+            // ts and temp swing between extremes against whatever reading the
+            // delta is taken from (the previous one, or the previous one of the
+            // same channel: ch alternates, so that is two back), and sr / ch
+            // change on every reading so every run is 1 long
+            int hi = fmtch ? (i >> 1) & 1 : i & 1;
+            rs[i].ts_ms_utc = hi ? INT64_MAX / 4 : -(INT64_MAX / 4);
+            rs[i].t_c = hi ? 1.0e6f : -1.0e6f;
+            rs[i].sr = (uint8_t)(i & 1 ? 0xFF : 0x00);
+            rs[i].ch = fmtch ? (uint8_t)(i & 1 ? 200 : 3) : 0;
+        }
+        int len = ingest_enc_delta(buf, sizeof(buf), id, rs, N, UINT32_MAX);
+        CHECK(len > 0 && len <= (int)INGEST_DELTA_MAX(N));
+        int fmt;
+        char id2[300];
+        CHECK_EQ(decode(buf, len, id2, &fmt, back, N), N);
+        CHECK_EQ(fmt, fmtch ? INGEST_BIN_FMT_CH_DELTA : INGEST_BIN_FMT_DELTA);
+        CHECK(same(rs, back, N, 0.0f));
+        printf("delta worst case fmt %d: %d B of a %d B bound\n", fmt, len, (int)INGEST_DELTA_MAX(N));
+        CHECK_EQ(ingest_enc_delta(buf, INGEST_DELTA_MAX(N) - 1, id, rs, N, UINT32_MAX), -1);
+    }
+}
+
+int main(void)
+{
+    test_json();
+    test_bin();
+    test_delta();
+    test_delta_worst_case();
+    TEST_DONE();
+}
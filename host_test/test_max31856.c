@@ -0,0 +1,327 @@
+//test_max31856.c
+// max31856.c against fake_max31856.c: DRDY as a masked level interrupt, the
+// configuration shadow, the one-burst temperature read, and several chips
+// on one SPI device with CS driven from the (IRAM) transaction callbacks,
+// read one at a time or queued in a sweep, and one-shot conversions
+#include "max31856.h"
+#include "fake_max31856.h"
+#include "host_stubs.h"
+#include "test_util.h"
+
+#define DRDY_BIT 0x4u
+
+static bool near(float a, float b) { return a > b - 0.01f && a < b + 0.01f; }
+
+// every chip added so far, by channel (the driver keeps them for the process)
+static max31856_handle_t s_h[MAX31856_MAX_CH];
+static fake_chip_t *s_c[MAX31856_MAX_CH];
+
+// DRDY: one interrupt per conversion, stamped when DRDY fell, whatever the
+// task's latency; a failed read leaves DRDY low and the interrupt comes back
+static void test_drdy(void)
+{
+    fake_chip_t *c = fake_chip_add(10, 9);
+    max31856_cfg_t cfg = { .cs_pin = 10, .drdy_pin = 9, .tc_type = MAX31856_TC_K };
+    max31856_handle_t h;
+    CHECK_EQ(max31856_add(SPI2_HOST, &cfg, &h), ESP_OK);
+    s_h[0] = h;
+    s_c[0] = c;
+    max31856_init(h);
+
+    // a conversion nobody read: enabling reads it, so no stale interrupt
+    fake_conversion(c, 20.0f, 0);
+    CHECK_EQ(max31856_drdy_enable(h, (TaskHandle_t)1, DRDY_BIT), ESP_OK);
+    CHECK_EQ(fake_pin_level(9), 1);
+    CHECK_EQ(fake_isr_calls, 0);
+    CHECK_EQ(fake_pin_intr_type(9), GPIO_INTR_LOW_LEVEL);
+    CHECK_EQ(fake_pin_wakeup_type(9), GPIO_INTR_LOW_LEVEL);   // wakes the chip from light sleep
+    CHECK(fake_sleep_wakeup);
+    CHECK(fake_pin_intr_enabled(9));
+
+    // the task gets to it 500 us later: still one interrupt, stamped at the fall
+    host_now_us = 1000;
+    fake_conversion(c, 25.0f, 0);
+    CHECK_EQ(fake_isr_calls, 1);
+    CHECK_EQ(fake_notify_bits, DRDY_BIT);
+    CHECK(!fake_pin_intr_enabled(9));
+    CHECK_EQ(fake_pin_wakeup_type(9), GPIO_INTR_DISABLE);   // an unread DRDY must not keep waking the chip
+    host_now_us += 500;
+    float t = 0;
+    uint8_t sr = 0xFF;
+    int64_t ts = 0;
+    CHECK(max31856_read_conversion(h, &t, &sr, &ts));
+    CHECK(near(t, 25.0f));
+    CHECK_EQ(sr, 0);
+    CHECK_EQ(ts, 1000);
+    CHECK(fake_pin_intr_enabled(9));
+    CHECK_EQ(fake_pin_wakeup_type(9), GPIO_INTR_LOW_LEVEL);
+    CHECK_EQ(fake_isr_calls, 1);
+    uint32_t edges, reads;
+    max31856_drdy_counts(h, &edges, &reads);
+    CHECK_EQ(edges, 1);
+    CHECK_EQ(reads, 1);
+
+    // the next conversion lands before the read: DRDY stays low, no second interrupt
+    host_now_us = 2000;
+    fake_conversion(c, 25.5f, 0);
+    host_now_us = 3000;
+    fake_conversion(c, 26.0f, 0);
+    CHECK_EQ(fake_isr_calls, 2);
+    CHECK(max31856_read_conversion(h, &t, NULL, &ts));
+    CHECK(near(t, 26.0f));
+    CHECK_EQ(ts, 2000);
+
+    // the read fails: unmasked with DRDY still low, the interrupt asks again
+    host_now_us = 4000;
+    fake_conversion(c, 27.0f, 0);
+    fake_spi_fail = 1;
+    CHECK(!max31856_read_conversion(h, &t, NULL, &ts));
+    CHECK_EQ(fake_isr_calls, 4);
+    CHECK(max31856_read_conversion(h, &t, NULL, &ts));
+    CHECK(near(t, 27.0f));
+
+    // a sweep reads and unmasks the same way
+    host_now_us = 5000;
+    fake_conversion(c, 28.0f, 0x01);
+    max31856_conv_t cv;
+    CHECK_EQ(max31856_sweep(&h, 1, &cv), 1);
+    CHECK(cv.ok && near(cv.t_c, 28.0f));
+    CHECK_EQ(cv.sr, 0x01);
+    CHECK_EQ(cv.ts_us, 5000);
+    CHECK(fake_pin_intr_enabled(9));
+    CHECK_EQ(fake_pin_level(9), 1);
+
+    max31856_drdy_counts(h, &edges, &reads);
+    CHECK_EQ(edges, 5);
+    CHECK_EQ(reads, 4);
+    CHECK_EQ(fake_isr_calls, 5);
+    CHECK_EQ(fake_isr_storms, 0);
+    CHECK_EQ(fake_cs_errors, 0);
+}
+
+// init writes only what differs from the chip (seeded in one burst read);
+// a temperature read is one transaction carrying the SR of the same conversion
+static void test_shadow_burst(void)
+{
+    fake_chip_t *c = fake_chip_add(14, -1);
+    max31856_cfg_t cfg = { .cs_pin = 14, .drdy_pin = -1, .tc_type = MAX31856_TC_T, .avg_sel = 1, .offset_c = 0.5f };
+    max31856_handle_t h;
+    CHECK_EQ(max31856_add(SPI2_HOST, &cfg, &h), ESP_OK);
+    s_h[1] = h;
+    s_c[1] = c;
+
+    // power-on chip: the thresholds and CJTO already match, only CR0 / CR1 go out
+    max31856_init(h);
+    CHECK_EQ(c->regs[0x00], 0x80);   // continuous, 60 Hz
+    CHECK_EQ(c->regs[0x01], 0x17);   // 2 samples, type T
+    CHECK_EQ(c->reads, 2);           // seed + readback
+    CHECK_EQ(c->writes, 2);
+    max31856_spi_stats_t st;
+    max31856_get_spi_stats(h, &st);
+    CHECK_EQ(st.writes, 2);
+    CHECK_EQ(st.writes_skipped, 7);
+    CHECK_EQ(st.xfers, 4);
+
+    // warm reboot: the chip already holds everything, nothing is written
+    max31856_init(h);
+    CHECK_EQ(c->writes, 2);
+    max31856_get_spi_stats(h, &st);
+    CHECK_EQ(st.writes_skipped, 7 + 9);
+
+    // a register the chip lost (brown-out) is seen by the seed read and rewritten, alone
+    c->regs[0x01] = 0x03;
+    max31856_init(h);
+    CHECK_EQ(c->regs[0x01], 0x17);
+    CHECK_EQ(c->writes, 3);
+
+    // one burst over LTCBH..SR, offset applied, negative values sign-extended
+    uint32_t r0 = c->reads;
+    fake_conversion(c, -18.5f, 0);
+    float t = 0;
+    uint8_t sr = 0xFF;
+    CHECK(max31856_get_temp_c(h, &t, &sr));
+    CHECK(near(t, -18.0f));
+    CHECK_EQ(sr, 0);
+    CHECK_EQ(c->reads - r0, 1);
+    fake_conversion(c, 99.5f, 0x41);   // TCRANGE | OPEN
+    CHECK(max31856_get_temp_c(h, &t, &sr));
+    CHECK(near(t, 100.0f));
+    CHECK_EQ(sr, 0x41);
+    CHECK_EQ(c->reads - r0, 2);
+    max31856_get_spi_stats(h, &st);
+    CHECK_EQ(st.temp_reads, 2);
+    CHECK_EQ(st.temp_xfers, 2);      // one transaction per read (two before the burst read)
+
+    // a failed transaction is a failed read, nothing stale comes back
+    fake_spi_fail = 1;
+    CHECK(!max31856_get_temp_c(h, &t, &sr));
+    CHECK(!max31856_get_temp_c(h, NULL, &sr));
+    CHECK_EQ(fake_cs_errors, 0);
+}
+
+// every chip is reached through the one device, each read selects only its chip,
+// and nothing ISR-side calls a GPIO driver function (not in IRAM)
+static void test_channels(void)
+{
+    fake_chip_t *c = fake_chip_add(15, -1);
+    max31856_cfg_t cfg = { .cs_pin = 15, .drdy_pin = -1, .tc_type = MAX31856_TC_K, .filt_50hz = true };
+    max31856_handle_t h;
+    CHECK_EQ(max31856_add(SPI2_HOST, &cfg, &h), ESP_OK);
+    s_h[2] = h;
+    s_c[2] = c;
+    CHECK_EQ(max31856_channel(h), 2);
+    CHECK_EQ(max31856_channel(NULL), -1);
+    CHECK_EQ(fake_pin_level(15), 1);   // deselected until its first transaction
+    max31856_init(h);
+    CHECK_EQ(c->regs[0x00], 0x81);
+
+    CHECK_EQ(fake_devices, 1);
+    CHECK_EQ(fake_hw_cs, -1);
+
+    // each chip answers with its own conversion (ch1 adds its 0.5 offset),
+    // and only its own counters move
+    for (int ch = 0; ch < 3; ++ch) fake_conversion(s_c[ch], -20.0f - ch, 0);
+    for (int k = 0; k < 6; ++k) {
+        int ch = (k * 2) % 3;
+        uint32_t rd[3] = { s_c[0]->reads, s_c[1]->reads, s_c[2]->reads };
+        float t;
+        CHECK(max31856_get_temp_c(s_h[ch], &t, NULL));
+        CHECK(near(t, -20.0f - ch + (ch == 1 ? 0.5f : 0.0f)));
+        for (int o = 0; o < 3; ++o) CHECK_EQ(s_c[o]->reads - rd[o], o == ch);
+    }
+    CHECK_EQ(max31856_channel(s_h[0]), 0);
+    CHECK_EQ(max31856_channel(s_h[1]), 1);
+    CHECK_EQ(fake_pin_level(10), 1);
+    CHECK_EQ(fake_pin_level(14), 1);
+    CHECK_EQ(fake_pin_level(15), 1);
+    CHECK_EQ(fake_cs_errors, 0);
+    CHECK_EQ(fake_isr_unsafe, 0);
+}
+
+// a sweep queues one burst per chip and hands back hs[i]'s result in out[i];
+// a transaction that can't be queued fails that chip and the ones after it,
+// and what was queued before it is still collected (and read)
+static void test_sweep(void)
+{
+    max31856_handle_t hs[3] = { s_h[2], s_h[0], s_h[1] };
+    host_now_us = 10000;
+    for (int ch = 0; ch < 3; ++ch) fake_conversion(s_c[ch], 5.0f + ch, 0);
+    host_now_us = 10400;
+    uint32_t rd[3] = { s_c[0]->reads, s_c[1]->reads, s_c[2]->reads };
+    max31856_conv_t cv[3];
+    CHECK_EQ(max31856_sweep(hs, 3, cv), 3);
+    CHECK(cv[0].ok && near(cv[0].t_c, 7.0f));
+    CHECK(cv[1].ok && near(cv[1].t_c, 5.0f));
+    CHECK(cv[2].ok && near(cv[2].t_c, 6.5f));
+    CHECK_EQ(cv[1].ts_us, 10000);   // DRDY chip: when DRDY fell
+    CHECK_EQ(cv[0].ts_us, 10400);   // polled: when it was read
+    for (int ch = 0; ch < 3; ++ch) CHECK_EQ(s_c[ch]->reads - rd[ch], 1);
+    CHECK(fake_pin_intr_enabled(9));
+
+    fake_conversion(s_c[0], 8.0f, 0);
+    int isr0 = fake_isr_calls;
+    fake_spi_fail = 1;
+    CHECK_EQ(max31856_sweep(hs, 3, cv), 0);
+    CHECK(!cv[0].ok && !cv[1].ok && !cv[2].ok);
+    CHECK_EQ(fake_isr_calls - isr0, 1);   // re-armed though unread: DRDY is still low, it asks again
+    CHECK_EQ(max31856_sweep(hs, 3, cv), 3);
+    CHECK(near(cv[1].t_c, 8.0f));
+
+    // the second enqueue fails: the first is collected and read, nothing is left queued
+    fake_conversion(s_c[2], 9.0f, 0);
+    fake_spi_pass = 1;
+    fake_spi_fail = 1;
+    CHECK_EQ(max31856_sweep(hs, 3, cv), 1);
+    CHECK(cv[0].ok && near(cv[0].t_c, 9.0f));
+    CHECK(!cv[1].ok && !cv[2].ok);
+    CHECK_EQ(fake_spi_pending(), 0);
+    CHECK_EQ(max31856_sweep(hs, 3, cv), 3);   // and the next sweep's results are its own
+    CHECK(near(cv[0].t_c, 9.0f) && near(cv[2].t_c, 6.5f));
+
+    // nothing to read (a tick-only wakeup) is not a sweep
+    max31856_sweep_stats_t st;
+    max31856_get_sweep_stats(&st);
+    CHECK_EQ(max31856_sweep(hs, 0, cv), 0);
+    max31856_sweep_stats_t st0 = st;
+    max31856_get_sweep_stats(&st);
+    CHECK_EQ(st.sweeps, st0.sweeps);
+    CHECK_EQ(st.sweeps, 1 + 5);             // test_drdy's sweep of one, then these
+    CHECK_EQ(st.chips, 1 + 3 + 0 + 3 + 1 + 3);
+    CHECK_EQ(fake_spi_pending(), 0);
+    CHECK_EQ(fake_cs_errors, 0);
+    CHECK_EQ(fake_isr_unsafe, 0);
+}
+
+// one-shot: the chip idles (CR0 without CMODE) until max31856_start, whose
+// 1SHOT write always goes out; DRDY announces the one conversion
+static void test_one_shot(void)
+{
+    fake_chip_t *c = fake_chip_add(16, 17);
+    max31856_cfg_t cfg = { .cs_pin = 16, .drdy_pin = 17, .tc_type = MAX31856_TC_T, .avg_sel = 1, .one_shot = true };
+    max31856_handle_t h;
+    CHECK_EQ(max31856_add(SPI2_HOST, &cfg, &h), ESP_OK);
+    fake_chip_t *c50 = fake_chip_add(18, -1);
+    max31856_cfg_t cfg50 = { .cs_pin = 18, .drdy_pin = -1, .avg_sel = 4, .filt_50hz = true, .one_shot = true };
+    max31856_handle_t h50;
+    CHECK_EQ(max31856_add(SPI2_HOST, &cfg50, &h50), ESP_OK);
+    max31856_init(h);
+    max31856_init(h50);
+    CHECK_EQ(c->regs[0x00], 0x00);     // normally off: the power-on value, not even written
+    CHECK_EQ(c->writes, 1);            // CR1 only
+    CHECK_EQ(c50->regs[0x00], 0x01);   // normally off, 50 Hz
+
+    // datasheet maxima: 155 / 185 ms, +37 / +44 ms per further averaged sample
+    CHECK_EQ(max31856_conv_time_ms(h), 155 + 37);
+    CHECK_EQ(max31856_conv_time_ms(h50), 185 + 15 * 44);
+    CHECK_EQ(max31856_conv_time_ms(NULL), 0);
+
+    CHECK_EQ(max31856_start(s_h[1]), ESP_ERR_INVALID_STATE);   // continuous
+    CHECK_EQ(max31856_start(NULL), ESP_ERR_INVALID_STATE);
+
+    CHECK_EQ(max31856_drdy_enable(h, (TaskHandle_t)1, DRDY_BIT << 1), ESP_OK);
+    CHECK_EQ(fake_pin_wakeup_type(17), GPIO_INTR_LOW_LEVEL);   // the conversion wakes a light-sleeping chip
+    int isr0 = fake_isr_calls;
+    for (int k = 0; k < 3; ++k) {
+        // the same CR0 | 1SHOT every time: the shadow never holds 1SHOT
+        uint32_t w0 = c->writes;
+        CHECK_EQ(max31856_start(h), ESP_OK);
+        CHECK_EQ(c->writes - w0, 1);
+        CHECK_EQ(c->regs[0x00], 0x40);
+        CHECK_EQ(c->one_shots, k + 1);
+
+        host_now_us = 20000 + k * 200000;
+        fake_conversion(c, -19.0f + k, 0);
+        CHECK_EQ(c->regs[0x00], 0x00);   // idle again
+        CHECK_EQ(fake_isr_calls - isr0, k + 1);
+        float t;
+        int64_t ts;
+        CHECK(max31856_read_conversion(h, &t, NULL, &ts));
+        CHECK(near(t, -19.0f + k));
+        CHECK_EQ(ts, 20000 + k * 200000);
+        CHECK_EQ(fake_isr_calls - isr0, k + 1);   // nothing more until the next start
+    }
+    uint32_t edges, reads;
+    max31856_drdy_counts(h, &edges, &reads);
+    CHECK_EQ(edges, 3);
+    CHECK_EQ(reads, 3);
+
+    // no DRDY: start, wait conv_time_ms, poll
+    CHECK_EQ(max31856_start(h50), ESP_OK);
+    CHECK_EQ(c50->regs[0x00], 0x41);
+    fake_conversion(c50, 3.25f, 0);
+    float t;
+    CHECK(max31856_get_temp_c(h50, &t, NULL));
+    CHECK(near(t, 3.25f));
+    CHECK_EQ(fake_isr_storms, 0);
+    CHECK_EQ(fake_isr_unsafe, 0);
+}
+
+int main(void)
+{
+    test_drdy();
+    test_shadow_burst();
+    test_channels();
+    test_sweep();
+    test_one_shot();
+    TEST_DONE();
+}
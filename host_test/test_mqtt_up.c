@@ -0,0 +1,196 @@
+//test_mqtt_up.c
+// mqtt_up.c + ack_win.c against a scripted esp-mqtt: windowing, out-of-order
+// PUBACKs, a drop with the outbox resending, and an ack timeout
+#include <string.h>
+#include "mqtt_up.h"
+#include "mqtt_client.h"
+#include "esp_crt_bundle.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "sample_q.h"
+#include "dns_cache.h"
+#include "test_util.h"
+
+// sample queue: readings 0..s_n-1 (t_c = index), one cursor
+static int s_n, s_cur, s_peeked, s_delivered[4096], s_ndeliv;
+static int s_lose_front;   // readings the queue loses at the next ack (the spool recycling a sector)
+int sq_peek_n(int sink, reading_t *o, int max)
+{
+    int n = 0;
+    for (; n < max && s_cur + n < s_n; ++n) o[n].t_c = (float)(s_cur + n);
+    s_peeked = n;
+    return n;
+}
+sq_mark_t sq_peek_mark(int sink, int k)
+{
+    return (sq_mark_t){ .ram = (uint32_t)(s_cur + (k < s_peeked ? k : s_peeked)) };
+}
+void sq_commit_mark(int sink, sq_mark_t m)
+{
+    CHECK((int)m.ram <= s_n);
+    while (s_cur < (int)m.ram) s_delivered[s_ndeliv++] = s_cur++;
+}
+void sq_abort(int sink) { s_peeked = 0; }
+
+// clock: only waiting moves it
+static int64_t s_now;
+int64_t esp_timer_get_time(void) { return s_now; }
+void vTaskDelay(TickType_t t) { s_now += (int64_t)t * 1000; }
+
+// broker: publishes wait in s_pend until the flush waits for an event
+typedef struct { int id, first, n; } pub_t;
+static esp_event_handler_t s_h;
+static void *s_harg;
+static pub_t s_pend[64];
+static int s_npend, s_next_id = 1, s_conn = 1;
+static bool s_reorder, s_blackhole;
+static int s_lose_after = -1, s_acks;
+static bool s_published[4096];
+
+esp_err_t esp_crt_bundle_attach(void *conf) { return ESP_OK; }
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *c) { return (esp_mqtt_client_handle_t)1; }
+esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t c) { return ESP_OK; }
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t c, esp_mqtt_event_id_t i,
+                                         esp_event_handler_t h, void *a)
+{
+    s_h = h;
+    s_harg = a;
+    return ESP_OK;
+}
+static void emit(esp_mqtt_event_id_t id, int msg_id, int session_present)
+{
+    esp_mqtt_event_t e = { .event_id = id, .msg_id = msg_id, .session_present = session_present };
+    s_h(s_harg, "MQTT_EVENTS", id, &e);
+}
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t c)
+{
+    emit(MQTT_EVENT_BEFORE_CONNECT, 0, 0);
+    s_now += 5000;
+    emit(MQTT_EVENT_CONNECTED, 0, 0);
+    return ESP_OK;
+}
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t c, const char *t, const char *d, int len, int qos, int r)
+{
+    if (!s_conn || s_npend >= 64) return -1;
+    pub_t p = { .id = s_next_id };
+    memcpy(&p.first, d, 4);
+    memcpy(&p.n, d + 4, 4);
+    for (int i = 0; i < p.n; ++i) s_published[p.first + i] = true;
+    s_pend[s_npend++] = p;
+    return s_next_id++;
+}
+
+// the flush's event queue; an empty receive lets the broker ack one publish
+static int s_q[64], s_qn;
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t sz) { return (QueueHandle_t)1; }
+BaseType_t xQueueReset(QueueHandle_t q) { s_qn = 0; return pdTRUE; }
+BaseType_t xQueueSend(QueueHandle_t q, const void *v, TickType_t t)
+{
+    if (s_qn < 64) s_q[s_qn++] = *(const int *)v;
+    return pdTRUE;
+}
+BaseType_t xQueueReceive(QueueHandle_t q, void *v, TickType_t t)
+{
+    if (s_blackhole) s_npend = 0;
+    if (!s_qn && s_conn && s_npend) {
+        int k = (s_reorder && s_npend > 1 && (s_acks & 1)) ? 1 : 0;
+        int id = s_pend[k].id;
+        memmove(&s_pend[k], &s_pend[k + 1], (size_t)(s_npend - k - 1) * sizeof(pub_t));
+        s_npend--;
+        s_now += 3000;
+        s_cur += s_lose_front;
+        s_lose_front = 0;
+        emit(MQTT_EVENT_PUBLISHED, id, 0);
+        if (++s_acks == s_lose_after) {
+            s_conn = 0;
+            emit(MQTT_EVENT_DISCONNECTED, 0, 0);
+        }
+    }
+    if (!s_qn) {
+        s_now += (int64_t)t * 1000;
+        return pdFALSE;
+    }
+    *(int *)v = s_q[0];
+    memmove(s_q, s_q + 1, (size_t)--s_qn * sizeof(int));
+    return pdTRUE;
+}
+
+bool dns_cache_lookup(const char *host, char *ip, size_t n) { return false; }
+void dns_cache_expire(const char *host) { }
+
+// payload: first reading, count; checks the batch is contiguous
+static int enc(uint8_t *d, size_t cap, const reading_t *rs, int n)
+{
+    int first = (int)rs[0].t_c;
+    for (int i = 0; i < n; ++i) CHECK_EQ((int)rs[i].t_c, first + i);
+    memcpy(d, &first, 4);
+    memcpy(d + 4, &n, 4);
+    return 8;
+}
+
+static void check_order(void)
+{
+    for (int i = 0; i < s_ndeliv; ++i) CHECK_EQ(s_delivered[i], i);
+}
+
+int main(void)
+{
+    mqtt_up_cfg_t cfg = { .base = "mqtt://x", .client_id = "c", .topic = "t", .enc = enc };
+    CHECK(mqtt_up_open(0, &cfg));
+    int pubs, r;
+
+    // 100 readings in batches of MQTT_BATCH_MAX
+    s_n = 100;
+    r = mqtt_up_flush(0, &pubs);
+    CHECK_EQ(r, 100);
+    CHECK_EQ(pubs, (100 + MQTT_BATCH_MAX - 1) / MQTT_BATCH_MAX);
+    check_order();
+
+    // PUBACKs out of order: commits still in order
+    s_reorder = true;
+    s_n = 300;
+    CHECK_EQ(mqtt_up_flush(0, &pubs), 200);
+    check_order();
+    s_reorder = false;
+
+    // the link drops after 3 acks: -1, the window is kept (the outbox resends),
+    // and the late PUBACKs after the reconnect commit it
+    s_n = 400;
+    s_acks = 0;
+    s_lose_after = 3;
+    CHECK_EQ(mqtt_up_flush(0, &pubs), -1);
+    CHECK(s_cur < 400);
+    s_conn = 1;
+    s_lose_after = -1;
+    emit(MQTT_EVENT_CONNECTED, 0, 1);
+    mqtt_up_flush(0, &pubs);
+    CHECK_EQ(s_cur, 400);
+    check_order();
+
+    // acks never come: the flush gives up after MQTT_ACK_TIMEOUT_MS and republishes next time
+    s_n = 420;
+    s_blackhole = true;
+    int64_t t0 = s_now;
+    CHECK_EQ(mqtt_up_flush(0, &pubs), -1);
+    CHECK_EQ(s_cur, 400);
+    CHECK(s_now - t0 >= MQTT_ACK_TIMEOUT_MS * 1000LL);
+    s_blackhole = false;
+    CHECK_EQ(mqtt_up_flush(0, &pubs), 20);
+    CHECK_EQ(s_cur, 420);
+    check_order();
+
+    // the queue loses the whole window while it is in flight (spool ring
+    // full): the acks commit nothing in its place, the window is forgotten
+    // and only readings that were actually published get committed
+    s_n = 500;
+    s_lose_front = 40;
+    int d0 = s_ndeliv;
+    mqtt_up_flush(0, &pubs);
+    CHECK_EQ(s_cur, 500);
+    CHECK_EQ(s_ndeliv - d0, 40);
+    for (int i = d0; i < s_ndeliv; ++i) {
+        CHECK_EQ(s_delivered[i], 460 + i - d0);
+        CHECK(s_published[s_delivered[i]]);
+    }
+    TEST_DONE();
+}
@@ -0,0 +1,205 @@
+//test_sample_q.c
+// sample_q.c ordering across the RAM ring and the spool, per-sink cursors, drops
+#include <string.h>
+#include "sample_q.h"
+#include "fake_spool.h"
+#include "test_util.h"
+
+static int64_t s_ts = 1760000000000LL;
+
+static reading_t next(void)
+{
+    reading_t r = { .t_c = 20.0f, .sr = 0, .ch = 0, .ts_ms_utc = s_ts };
+    s_ts += 15000;
+    return r;
+}
+
+// drains sink and checks the timestamps come out strictly in push order
+static int drain_in_order(int sink, int64_t *last)
+{
+    reading_t buf[16];
+    int total = 0, n;
+    while ((n = sq_peek_n(sink, buf, 16)) > 0) {
+        for (int i = 0; i < n; ++i) {
+            CHECK(buf[i].ts_ms_utc > *last);
+            *last = buf[i].ts_ms_utc;
+        }
+        sq_commit_n(sink, n);
+        total += n;
+    }
+    return total;
+}
+
+static void reset(int sinks, bool spool)
+{
+    // drain whatever an earlier test left, for every sink
+    reading_t r;
+    for (int k = 0; k < SQ_SINKS; ++k) while (sq_pop(k, &r)) { }
+    fake_spool_present = spool;
+    fake_spool_fail = false;
+    spool_init(sinks);
+    sq_init(sinks);
+}
+
+static void test_ram_only(void)
+{
+    reset(1, false);
+    for (int i = 0; i < 10; ++i) { reading_t r = next(); CHECK(sq_push(&r)); }
+    CHECK_EQ(sq_count(), 10);
+    // abort keeps them, partial commit keeps the rest
+    reading_t buf[4];
+    CHECK_EQ(sq_peek_n(0, buf, 4), 4);
+    sq_abort(0);
+    CHECK_EQ(sq_count(), 10);
+    CHECK_EQ(sq_peek_n(0, buf, 4), 4);
+    sq_commit_n(0, 3);
+    CHECK_EQ(sq_count(), 7);
+    int64_t last = 0;
+    CHECK_EQ(drain_in_order(0, &last), 7);
+
+    // without a spool a full ring drops the newest and counts it
+    uint32_t dropped = sq_dropped();
+    for (int i = 0; i < SQ_CAP; ++i) { reading_t r = next(); CHECK(sq_push(&r)); }
+    reading_t r = next();
+    CHECK(!sq_push(&r));
+    CHECK_EQ(sq_dropped(), dropped + 1);
+    last = 0;
+    CHECK_EQ(drain_in_order(0, &last), SQ_CAP);
+}
+
+static void test_spill_keeps_order(void)
+{
+    reset(1, true);
+    // fill RAM, then the overflow and everything after it goes to the spool
+    for (int i = 0; i < SQ_CAP + 50; ++i) { reading_t r = next(); CHECK(sq_push(&r)); }
+    CHECK_EQ(sq_count(), SQ_CAP);
+    CHECK_EQ(spool_count(), 50);
+    // RAM drains first; once space frees up new readings still queue behind the spool
+    reading_t buf[8];
+    CHECK_EQ(sq_peek_n(0, buf, 8), 8);
+    sq_commit_n(0, 8);
+    for (int i = 0; i < 5; ++i) { reading_t r = next(); CHECK(sq_push(&r)); }
+    CHECK_EQ(spool_count(), 55);
+    int64_t last = buf[7].ts_ms_utc;
+    CHECK_EQ(drain_in_order(0, &last), SQ_CAP - 8 + 55);
+}
+
+// spool holds a backlog and an append fails: the reading must not jump ahead of it
+static void test_failed_append_behind_backlog(void)
+{
+    reset(1, true);
+    for (int i = 0; i < SQ_CAP + 3; ++i) { reading_t r = next(); CHECK(sq_push(&r)); }
+    reading_t buf[16];
+    CHECK_EQ(sq_peek_n(0, buf, 16), 16);
+    sq_commit_n(0, 16);                 // RAM has room again, spool still has 3
+
+    uint32_t dropped = sq_dropped();
+    fake_spool_fail = true;
+    reading_t r = next();
+    CHECK(!sq_push(&r));
+    CHECK_EQ(sq_dropped(), dropped + 1);
+    CHECK_EQ(sq_count(), SQ_CAP - 16);  // not in RAM
+    fake_spool_fail = false;
+
+    int64_t last = buf[15].ts_ms_utc;
+    CHECK_EQ(drain_in_order(0, &last), SQ_CAP - 16 + 3);
+
+    // once the spool is empty RAM takes readings again
+    r = next();
+    CHECK(sq_push(&r));
+    CHECK_EQ(sq_count(), 1);
+}
+
+// two sinks: each sees every reading; a slot is freed by the slower one
+static void test_two_sinks(void)
+{
+    reset(2, false);
+    for (int i = 0; i < 20; ++i) { reading_t r = next(); CHECK(sq_push(&r)); }
+    int64_t last0 = 0, last1 = 0;
+    CHECK_EQ(drain_in_order(0, &last0), 20);
+    CHECK_EQ(sq_count(), 20);           // sink 1 has not committed
+    CHECK_EQ(sq_count_sink(0), 0);
+    CHECK_EQ(sq_count_sink(1), 20);
+    CHECK_EQ(drain_in_order(1, &last1), 20);
+    CHECK_EQ(sq_count(), 0);
+    CHECK_EQ(last0, last1);
+}
+
+// marks: taken from different peeks, committed later (ack_win's window);
+// spooled readings are acked by sequence number, so ones the spool dropped
+// since the peek are not replaced by newer readings that were never sent
+static void test_marks(void)
+{
+    reset(1, true);
+    for (int i = 0; i < SQ_CAP + 40; ++i) { reading_t r = next(); CHECK(sq_push(&r)); }
+    reading_t buf[16];
+    while (sq_count() > 0) sq_commit_n(0, sq_peek_n(0, buf, 16));
+    CHECK_EQ(spool_count_sink(0), 40);
+
+    CHECK_EQ(sq_peek_n(0, buf, 8), 8);
+    sq_mark_t m1 = sq_peek_mark(0, 8);
+    sq_abort(0);
+    CHECK_EQ(sq_peek_n(0, buf, 16), 16);
+    sq_mark_t m2 = sq_peek_mark(0, 16);
+    sq_abort(0);
+    CHECK_EQ(m1.spool_seq + 8, m2.spool_seq);
+
+    sq_commit_mark(0, m1);
+    CHECK_EQ(spool_count_sink(0), 32);
+    sq_commit_mark(0, m1);              // again: nothing more
+    CHECK_EQ(spool_count_sink(0), 32);
+
+    fake_spool_drop(24);                // 16 unacked records recycled, m2's among them
+    CHECK_EQ(spool_count_sink(0), 16);
+    sq_commit_mark(0, m2);
+    CHECK_EQ(spool_count_sink(0), 16);  // the 16 after them were never peeked
+
+    // RAM: a mark past the cursor moves it, one behind it does not
+    reset(1, false);
+    for (int i = 0; i < 10; ++i) { reading_t r = next(); CHECK(sq_push(&r)); }
+    CHECK_EQ(sq_peek_n(0, buf, 6), 6);
+    m1 = sq_peek_mark(0, 3);
+    m2 = sq_peek_mark(0, 6);
+    CHECK_EQ(m2.spool_seq, 0);
+    sq_abort(0);
+    sq_commit_mark(0, m2);
+    CHECK_EQ(sq_count_sink(0), 4);
+    sq_commit_mark(0, m1);
+    CHECK_EQ(sq_count_sink(0), 4);
+    int64_t last = 0;
+    CHECK_EQ(drain_in_order(0, &last), 4);
+}
+
+// packing: 1/128 °C, clamp, channel and fault byte survive
+static void test_packing(void)
+{
+    reset(1, false);
+    reading_t in[3] = {
+        { .t_c = -79.9921875f, .sr = 0x00, .ch = 0, .ts_ms_utc = s_ts },
+        { .t_c = 500.0f,       .sr = 0x41, .ch = 7, .ts_ms_utc = s_ts + 1 },
+        { .t_c = -500.0f,      .sr = 0x01, .ch = 3, .ts_ms_utc = s_ts + 2 },
+    };
+    s_ts += 3;
+    for (int i = 0; i < 3; ++i) CHECK(sq_push(&in[i]));
+    reading_t out[3];
+    CHECK_EQ(sq_peek_n(0, out, 3), 3);
+    sq_commit_n(0, 3);
+    CHECK(out[0].t_c == in[0].t_c);
+    CHECK(out[1].t_c > 255.9f && out[2].t_c < -255.9f);
+    for (int i = 0; i < 3; ++i) {
+        CHECK_EQ(out[i].ts_ms_utc, in[i].ts_ms_utc);
+        CHECK_EQ(out[i].sr, in[i].sr);
+        CHECK_EQ(out[i].ch, in[i].ch);
+    }
+}
+
+int main(void)
+{
+    test_ram_only();
+    test_spill_keeps_order();
+    test_failed_append_behind_backlog();
+    test_two_sinks();
+    test_marks();
+    test_packing();
+    TEST_DONE();
+}
@@ -0,0 +1,319 @@
+//test_spool.c
+// spool.c over fake_flash.c's RAM partition: the ring wrapping and dropping,
+// recovery after a power cut, and two sinks acking on their own
+#include <string.h>
+#include "spool.h"
+#include "fake_flash.h"
+#include "test_util.h"
+
+#define SLOTS 128   // per 4 KB sector
+
+// reading i: its number in ts, and a channel to check it comes back
+static reading_t rd(int i)
+{
+    return (reading_t){ .t_c = i * 0.25f, .sr = 0, .ch = (uint8_t)(i % 4), .ts_ms_utc = 1000 + i };
+}
+
+static int ts_of(const reading_t *r) { return (int)(r->ts_ms_utc - 1000); }
+
+static void append(int from, int n)
+{
+    for (int i = from; i < from + n; ++i) {
+        reading_t r = rd(i);
+        CHECK(spool_append(&r));
+    }
+}
+
+// a fresh partition, or (keep) the same one after a power cycle
+static void mount(int sectors, int sinks, bool keep)
+{
+    fake_flash_init(sectors, keep);
+    CHECK_EQ(spool_init(sinks), ESP_OK);
+}
+
+// oldest reading sink has not acked, -1 if none
+static int oldest(int sink)
+{
+    reading_t r;
+    return spool_peek_n(sink, &r, 1) == 1 ? ts_of(&r) : -1;
+}
+
+// peek and ack everything sink has, checking it comes in order from `first`;
+// returns how many
+static int drain(int sink, int first)
+{
+    reading_t out[SPOOL_PEEK_MAX];
+    int total = 0, n;
+    while ((n = spool_peek_n(sink, out, SPOOL_PEEK_MAX)) > 0) {
+        for (int i = 0; i < n; ++i) CHECK_EQ(ts_of(&out[i]), first + total + i);
+        spool_commit_n(sink, n);
+        total += n;
+    }
+    return total;
+}
+
+static spool_stats_t stats(void)
+{
+    spool_stats_t st;
+    spool_get_stats(&st);
+    return st;
+}
+
+static void test_no_partition(void)
+{
+    fake_flash_present = false;
+    fake_flash_init(4, false);
+    CHECK_EQ(spool_init(1), ESP_ERR_NOT_FOUND);
+    reading_t r = rd(0);
+    CHECK(!spool_append(&r));
+    CHECK_EQ(spool_count(), 0);
+    CHECK_EQ(spool_peek_n(0, &r, 1), 0);
+    fake_flash_present = true;
+
+    // one sector: the head would erase the sector it is leaving
+    fake_flash_init(1, false);
+    CHECK_EQ(spool_init(1), ESP_ERR_INVALID_SIZE);
+    CHECK(!spool_append(&r));
+}
+
+static void test_basic(void)
+{
+    mount(4, 1, false);
+    CHECK_EQ(stats().capacity, 4 * SLOTS);
+    CHECK_EQ(spool_count(), 0);
+    CHECK_EQ(oldest(0), -1);
+
+    append(0, 10);
+    CHECK_EQ(spool_count(), 10);
+    reading_t out[SPOOL_PEEK_MAX + 8];
+    CHECK_EQ(spool_peek_n(0, out, 4), 4);
+    for (int i = 0; i < 4; ++i) {
+        CHECK_EQ(ts_of(&out[i]), i);
+        CHECK_EQ(out[i].ch, i % 4);
+        CHECK(out[i].t_c == i * 0.25f);
+        CHECK_EQ(spool_peek_seq(0, i), i + 1);
+    }
+    CHECK_EQ(spool_peek_seq(0, 4), 0);
+
+    // a peek leaves the readings in place; a commit acks them on flash
+    CHECK_EQ(spool_count(), 10);
+    spool_commit_n(0, 2);
+    CHECK_EQ(spool_count(), 8);
+    CHECK_EQ(oldest(0), 2);
+    CHECK_EQ(fake_flash_data()[0 * 32 + 24], 0xFE);   // ack byte of slot 0
+    CHECK_EQ(fake_flash_data()[2 * 32 + 24], 0xFF);
+
+    // max is capped at SPOOL_PEEK_MAX, a commit at what was peeked
+    append(10, 100);
+    CHECK_EQ(spool_peek_n(0, out, SPOOL_PEEK_MAX + 8), SPOOL_PEEK_MAX);
+    CHECK_EQ(spool_peek_n(0, out, 3), 3);
+    spool_commit_n(0, 50);
+    CHECK_EQ(spool_count(), 105);
+    CHECK_EQ(drain(0, 5), 105);
+    CHECK_EQ(spool_count(), 0);
+}
+
+// 4 sectors (512 slots) and 600 readings: entering sector 0 again drops
+// its 128 oldest, nothing else
+static void test_wrap_drops(void)
+{
+    mount(4, 1, false);
+    spool_stats_t s0 = stats();
+    append(0, 600);
+    spool_stats_t s1 = stats();
+    CHECK_EQ(s1.appended - s0.appended, 600);
+    CHECK_EQ(s1.dropped - s0.dropped, SLOTS);
+    CHECK_EQ(s1.erases - s0.erases, 5);
+    CHECK_EQ(spool_count(), 600 - SLOTS);
+    CHECK_EQ(oldest(0), SLOTS);
+    CHECK_EQ(drain(0, SLOTS), 600 - SLOTS);
+    CHECK_EQ(stats().drained - s1.drained, 600 - SLOTS);
+
+    // a sink part-way through the sector loses only what it has left there
+    mount(2, 1, false);
+    s0 = stats();
+    append(0, 2 * SLOTS);
+    reading_t out[SPOOL_PEEK_MAX];
+    for (int done = 0; done < 100; done += 50) {
+        CHECK_EQ(spool_peek_n(0, out, 50), 50);
+        spool_commit_n(0, 50);
+    }
+    CHECK_EQ(spool_count(), 2 * SLOTS - 100);
+    append(2 * SLOTS, 1);
+    CHECK_EQ(stats().dropped - s0.dropped, SLOTS - 100);
+    CHECK_EQ(spool_count(), SLOTS + 1);
+    CHECK_EQ(drain(0, SLOTS), SLOTS + 1);
+}
+
+// a peek whose sector was recycled before its ack: the ack must not touch
+// the records that replaced it
+static void test_commit_after_recycle(void)
+{
+    mount(2, 1, false);
+    reading_t out[SPOOL_PEEK_MAX];
+    append(0, 10);
+    CHECK_EQ(spool_peek_n(0, out, 10), 10);
+    uint32_t last = spool_peek_seq(0, 9);
+    append(10, 2 * SLOTS - 10 + 1);   // into sector 0 again: 0..127 dropped
+    uint32_t drained = stats().drained;
+    CHECK_EQ(spool_count(), SLOTS + 1);
+
+    spool_commit_n(0, 10);
+    CHECK_EQ(spool_count(), SLOTS + 1);
+    CHECK_EQ(stats().drained, drained);
+    CHECK_EQ(oldest(0), SLOTS);
+
+    spool_commit_seq(0, last);
+    CHECK_EQ(spool_count(), SLOTS + 1);
+    CHECK_EQ(drain(0, SLOTS), SLOTS + 1);
+}
+
+static void test_power_cut(void)
+{
+    // the 6th append loses power 12 bytes in: timestamp and seq, no CRC
+    mount(4, 1, false);
+    append(0, 5);
+    fake_flash_tear = 12;
+    reading_t r = rd(5);
+    CHECK(!spool_append(&r));
+
+    mount(4, 1, true);
+    CHECK_EQ(spool_count(), 6);   // the torn slot is skipped, not reused
+    CHECK_EQ(oldest(0), 0);
+    append(6, 1);
+    reading_t out[SPOOL_PEEK_MAX];
+    CHECK_EQ(spool_peek_n(0, out, SPOOL_PEEK_MAX), 6);
+    CHECK_EQ(ts_of(&out[5]), 6);
+    CHECK_EQ(spool_peek_seq(0, 5), 6);   // the torn record's seq never counted
+    CHECK_EQ(spool_count(), 7);
+    spool_commit_n(0, 6);
+    CHECK_EQ(spool_count(), 0);
+
+    // a bit flipped in a record (its CRC no longer matches): skipped, the rest kept
+    mount(4, 1, false);
+    append(0, 5);
+    fake_flash_data()[2 * 32 + 12] ^= 0x01;   // t_c of slot 2
+    mount(4, 1, true);
+    CHECK_EQ(spool_count(), 5);
+    CHECK_EQ(spool_peek_n(0, out, SPOOL_PEEK_MAX), 4);
+    CHECK_EQ(ts_of(&out[1]), 1);
+    CHECK_EQ(ts_of(&out[2]), 3);
+    spool_commit_n(0, 4);
+    CHECK_EQ(spool_count(), 0);
+
+    // power lost in an ack write: the reading is sent again, not lost
+    mount(4, 1, false);
+    append(0, 3);
+    CHECK_EQ(spool_peek_n(0, out, 3), 3);
+    fake_flash_tear = 0;
+    spool_commit_n(0, 3);
+    mount(4, 1, true);
+    CHECK_EQ(spool_count(), 3);
+    CHECK_EQ(drain(0, 0), 3);
+
+    // the last slot of a sector torn: the head starts the next sector
+    mount(2, 1, false);
+    append(0, SLOTS - 1);
+    fake_flash_tear = 20;
+    r = rd(SLOTS - 1);
+    CHECK(!spool_append(&r));
+    mount(2, 1, true);
+    CHECK_EQ(spool_count(), SLOTS);
+    append(SLOTS, 1);
+    CHECK_EQ(fake_flash_ops.erases, 1);
+    CHECK_EQ(spool_count(), SLOTS + 1);
+    CHECK_EQ(spool_peek_n(0, out, SPOOL_PEEK_MAX), SPOOL_PEEK_MAX);
+    spool_commit_n(0, SPOOL_PEEK_MAX);
+    CHECK_EQ(spool_peek_n(0, out, SPOOL_PEEK_MAX), SPOOL_PEEK_MAX);
+    CHECK_EQ(ts_of(&out[62]), SLOTS - 2);
+    CHECK_EQ(ts_of(&out[63]), SLOTS);
+    spool_commit_n(0, SPOOL_PEEK_MAX);
+    CHECK_EQ(spool_count(), 0);
+}
+
+// head and tail found again by seq once the ring has wrapped (and dropped)
+static void test_reboot_after_wrap(void)
+{
+    mount(4, 1, false);
+    append(0, 700);   // 0..255 dropped by two sector recycles
+    CHECK_EQ(spool_count(), 700 - 2 * SLOTS);
+    reading_t out[SPOOL_PEEK_MAX];
+    CHECK_EQ(spool_peek_n(0, out, 50), 50);
+    spool_commit_n(0, 50);
+    uint32_t n = spool_count();
+
+    mount(4, 1, true);
+    CHECK_EQ(spool_count(), n);
+    CHECK_EQ(oldest(0), 2 * SLOTS + 50);
+    append(700, 1);
+    CHECK_EQ(fake_flash_ops.erases, 0);   // still inside sector 1
+    CHECK_EQ(drain(0, 2 * SLOTS + 50), n + 1);
+    CHECK_EQ(spool_peek_seq(0, 0), 0);
+    append(701, 1);
+    CHECK_EQ(spool_peek_n(0, out, 1), 1);
+    CHECK_EQ(spool_peek_seq(0, 0), 702);
+}
+
+static void test_two_sinks(void)
+{
+    mount(4, 2, false);
+    spool_stats_t s0 = stats();
+    append(0, 20);
+    CHECK_EQ(drain(0, 0), 20);
+    CHECK_EQ(spool_count_sink(0), 0);
+    CHECK_EQ(spool_count_sink(1), 20);
+    CHECK_EQ(spool_count(), 20);   // held until the slower sink is done
+    CHECK_EQ(stats().drained - s0.drained, 0);
+
+    reading_t out[SPOOL_PEEK_MAX];
+    CHECK_EQ(spool_peek_n(1, out, 5), 5);
+    spool_commit_n(1, 5);
+    CHECK_EQ(spool_count(), 15);
+    CHECK_EQ(stats().drained - s0.drained, 5);
+    CHECK_EQ(fake_flash_data()[0 * 32 + 24], 0xFC);
+    CHECK_EQ(fake_flash_data()[5 * 32 + 24], 0xFE);   // sink 1's bit still set
+    CHECK_EQ(stats().sink_pending[1], 15);
+
+    // each sink's place comes back from its own ack bit
+    mount(4, 2, true);
+    CHECK_EQ(spool_count_sink(0), 0);
+    CHECK_EQ(spool_count_sink(1), 15);
+    CHECK_EQ(spool_count(), 15);
+    CHECK_EQ(oldest(0), -1);
+    CHECK_EQ(oldest(1), 5);
+
+    // a commit by seq from a peek of the other sink's acks only this one
+    append(20, 10);
+    CHECK_EQ(spool_peek_n(0, out, 10), 10);
+    spool_commit_seq(0, spool_peek_seq(0, 9));
+    CHECK_EQ(spool_count_sink(0), 0);
+    CHECK_EQ(spool_count_sink(1), 25);
+
+    // the ring fills behind sink 1 only: its records go, sink 0 keeps its own
+    s0 = stats();
+    append(30, 390);   // slots 30..419
+    CHECK_EQ(drain(0, 30), 390);
+    append(420, 100);  // slots 420..519: sector 0 again, where sink 1's tail is
+    CHECK_EQ(stats().dropped - s0.dropped, SLOTS - 5);
+    CHECK_EQ(spool_count_sink(0), 100);
+    CHECK_EQ(spool_count_sink(1), 15 + 10 + 390 + 100 - (SLOTS - 5));
+    CHECK_EQ(spool_count(), spool_count_sink(1));
+    CHECK_EQ(oldest(1), SLOTS);
+    CHECK_EQ(drain(0, 420), 100);
+    s0 = stats();
+    CHECK_EQ(drain(1, SLOTS), 520 - SLOTS);
+    CHECK_EQ(stats().drained - s0.drained, 520 - SLOTS);
+    CHECK_EQ(spool_count(), 0);
+}
+
+int main(void)
+{
+    test_no_partition();
+    test_basic();
+    test_wrap_drops();
+    test_commit_after_recycle();
+    test_power_cut();
+    test_reboot_after_wrap();
+    test_two_sinks();
+    TEST_DONE();
+}
@@ -0,0 +1,74 @@
+//test_srv_hints.c
+// srv_hints.c: hint headers and body fields, clamping, and what is ignored
+#include "srv_hints.h"
+#include "test_util.h"
+
+static void test_headers(void)
+{
+    srv_hints_t h;
+    srv_hints_clear(&h);
+    CHECK(!srv_hints_any(&h));
+    CHECK_EQ(h.retry_after_s, -1);
+
+    CHECK(srv_hints_header(&h, "x-sample-period-ms", "60000"));   // names are case-insensitive
+    CHECK_EQ(h.period_ms, 60000);
+    CHECK(srv_hints_header(&h, "X-Batch-Max", " 4"));
+    CHECK_EQ(h.batch, 4);
+    CHECK(srv_hints_header(&h, "Retry-After", "120"));
+    CHECK_EQ(h.retry_after_s, 120);
+    CHECK(srv_hints_any(&h));
+
+    // the HTTP-date form needs a synced clock: ignored, the delta stays
+    CHECK(!srv_hints_header(&h, "Retry-After", "Wed, 21 Oct 2015 07:28:00 GMT"));
+    CHECK_EQ(h.retry_after_s, 120);
+    CHECK(!srv_hints_header(&h, "Retry-After", "-5"));
+    CHECK(!srv_hints_header(&h, "Content-Length", "12"));
+}
+
+static void test_body(void)
+{
+    srv_hints_t h;
+    // headers take precedence over the body
+    srv_hints_clear(&h);
+    CHECK(srv_hints_header(&h, "X-Sample-Period-Ms", "60000"));
+    srv_hints_body(&h, "{\"ok\":true,\"period_ms\":1000,\"batch_max\":4}");
+    CHECK_EQ(h.period_ms, 60000);
+    CHECK_EQ(h.batch, 4);
+
+    // clamped to the SRV_* ranges
+    srv_hints_clear(&h);
+    srv_hints_body(&h, "{\"period_ms\":1000,\"retry_after\":99999}");
+    CHECK_EQ(h.period_ms, SRV_PERIOD_MIN_MS);
+    CHECK_EQ(h.retry_after_s, SRV_RETRY_MAX_S);
+    srv_hints_clear(&h);
+    srv_hints_body(&h, "{\"period_ms\":999999999}");
+    CHECK_EQ(h.period_ms, SRV_PERIOD_MAX_MS);
+
+    // a 503 body with retry_after alone: the uploader scores that answer as
+    // load shedding, not a failure, so it has to be found without headers
+    srv_hints_clear(&h);
+    srv_hints_body(&h, "{\"error\":\"overloaded\",\"retry_after\":30}");
+    CHECK_EQ(h.retry_after_s, 30);
+    CHECK(srv_hints_any(&h));
+
+    // no hints, wrong types, nothing at all
+    srv_hints_clear(&h);
+    srv_hints_body(&h, "{\"accepted\":3}");
+    CHECK(!srv_hints_any(&h));
+    srv_hints_body(&h, "{\"period_ms\":\"x\"}");
+    CHECK(!srv_hints_any(&h));
+    srv_hints_body(&h, "");
+    srv_hints_body(&h, NULL);
+    CHECK(!srv_hints_any(&h));
+
+    // truncated body: what is complete still counts
+    srv_hints_body(&h, "{\"batch_max\":2,\"period_ms\":60");
+    CHECK_EQ(h.batch, 2);
+}
+
+int main(void)
+{
+    test_headers();
+    test_body();
+    TEST_DONE();
+}
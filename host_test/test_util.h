@@ -0,0 +1,26 @@
+//test_util.h
+// Minimal check macros for the host tests (no framework, exit code = result)
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+
+static int s_checks = 0;
+static int s_failed = 0;
+
+#define CHECK(cond) do { \
+    s_checks++; \
+    if (!(cond)) { s_failed++; fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    long long a_ = (long long)(a), b_ = (long long)(b); \
+    s_checks++; \
+    if (a_ != b_) { s_failed++; fprintf(stderr, "%s:%d: CHECK_EQ failed: %s = %lld, %s = %lld\n", \
+                                        __FILE__, __LINE__, #a, a_, #b, b_); } \
+} while (0)
+
+// last line of main()
+#define TEST_DONE() do { \
+    printf("%s: %d check(s), %d failed\n", __FILE__, s_checks, s_failed); \
+    return s_failed ? 1 : 0; \
+} while (0)
@@ -0,0 +1,190 @@
+//test_ws_up.c
+// ws_up.c + ack_win.c against a scripted echo server: binary and text frames,
+// streaming one reading at a time, a full socket, and a drop then resend
+#include <string.h>
+#include "ws_up.h"
+#include "esp_websocket_client.h"
+#include "esp_crt_bundle.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "sample_q.h"
+#include "test_util.h"
+
+// sample queue: readings 0..s_n-1 (t_c = index), one cursor
+static int s_n, s_cur, s_peeked, s_delivered[4096], s_ndeliv;
+int sq_peek_n(int sink, reading_t *o, int max)
+{
+    int n = 0;
+    for (; n < max && s_cur + n < s_n; ++n) o[n].t_c = (float)(s_cur + n);
+    s_peeked = n;
+    return n;
+}
+sq_mark_t sq_peek_mark(int sink, int k)
+{
+    return (sq_mark_t){ .ram = (uint32_t)(s_cur + (k < s_peeked ? k : s_peeked)) };
+}
+void sq_commit_mark(int sink, sq_mark_t m)
+{
+    CHECK((int)m.ram >= s_cur && (int)m.ram <= s_n);
+    while (s_cur < (int)m.ram) s_delivered[s_ndeliv++] = s_cur++;
+}
+void sq_abort(int sink) { s_peeked = 0; }
+
+// clock: only waiting moves it
+static int64_t s_now;
+int64_t esp_timer_get_time(void) { return s_now; }
+void vTaskDelay(TickType_t t) { s_now += (int64_t)t * 1000; }
+
+// echo server: frames wait in s_pend until the flush waits for an event
+typedef struct { char d[700]; int len; uint8_t op; } frame_t;
+static esp_event_handler_t s_h;
+static void *s_harg;
+static frame_t s_pend[16];
+static int s_npend, s_conn = 1, s_full_after = 1000, s_frames;
+static bool s_drop_next;
+
+esp_err_t esp_crt_bundle_attach(void *conf) { return ESP_OK; }
+esp_websocket_client_handle_t esp_websocket_client_init(const esp_websocket_client_config_t *c)
+{
+    return (esp_websocket_client_handle_t)1;
+}
+esp_err_t esp_websocket_client_destroy(esp_websocket_client_handle_t c) { return ESP_OK; }
+esp_err_t esp_websocket_register_events(esp_websocket_client_handle_t c, esp_websocket_event_id_t i,
+                                        esp_event_handler_t h, void *a)
+{
+    s_h = h;
+    s_harg = a;
+    return ESP_OK;
+}
+static void emit(esp_websocket_event_id_t id, esp_websocket_event_data_t *d)
+{
+    s_h(s_harg, "WEBSOCKET_EVENTS", id, d);
+}
+esp_err_t esp_websocket_client_start(esp_websocket_client_handle_t c)
+{
+    emit(WEBSOCKET_EVENT_BEFORE_CONNECT, NULL);
+    s_now += 4000;
+    emit(WEBSOCKET_EVENT_CONNECTED, NULL);
+    return ESP_OK;
+}
+static int take(const char *d, int len, uint8_t op)
+{
+    if (!s_conn || s_npend >= s_full_after || s_npend >= 16) return -1;   // socket full
+    CHECK(len <= (int)sizeof(s_pend[0].d));
+    memcpy(s_pend[s_npend].d, d, (size_t)len);
+    s_pend[s_npend].len = len;
+    s_pend[s_npend].op = op;
+    s_npend++;
+    s_frames++;
+    return len;
+}
+int esp_websocket_client_send_bin(esp_websocket_client_handle_t c, const char *d, int len, TickType_t t)
+{
+    return take(d, len, 0x2);
+}
+int esp_websocket_client_send_text(esp_websocket_client_handle_t c, const char *d, int len, TickType_t t)
+{
+    CHECK(strncmp(d, "{\"seq\":", 7) == 0 && d[len - 1] == '}');   // the JSON envelope
+    return take(d, len, 0x1);
+}
+
+// the flush's event queue; an empty receive lets the server echo one frame
+static int s_q[64], s_qn;
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t sz) { return (QueueHandle_t)1; }
+BaseType_t xQueueReset(QueueHandle_t q) { s_qn = 0; return pdTRUE; }
+BaseType_t xQueueSend(QueueHandle_t q, const void *v, TickType_t t)
+{
+    if (s_qn < 64) s_q[s_qn++] = *(const int *)v;
+    return pdTRUE;
+}
+BaseType_t xQueueReceive(QueueHandle_t q, void *v, TickType_t t)
+{
+    if (s_drop_next && s_npend) {
+        s_drop_next = false;
+        s_npend = 0;
+        s_conn = 0;
+        emit(WEBSOCKET_EVENT_DISCONNECTED, NULL);
+    }
+    if (!s_qn && s_conn && s_npend) {
+        esp_websocket_event_data_t e = {
+            .data_ptr = s_pend[0].d, .data_len = s_pend[0].len, .fin = true, .op_code = s_pend[0].op,
+            .payload_len = s_pend[0].len,
+        };
+        s_now += 2000;
+        emit(WEBSOCKET_EVENT_DATA, &e);
+        memmove(s_pend, s_pend + 1, (size_t)--s_npend * sizeof(frame_t));
+    }
+    if (!s_qn) {
+        s_now += (int64_t)t * 1000;
+        return pdFALSE;
+    }
+    *(int *)v = s_q[0];
+    memmove(s_q, s_q + 1, (size_t)--s_qn * sizeof(int));
+    return pdTRUE;
+}
+
+// body: "[first,count]"; checks the batch is contiguous
+static int enc(uint8_t *d, size_t cap, const reading_t *rs, int n)
+{
+    int first = (int)rs[0].t_c;
+    for (int i = 0; i < n; ++i) CHECK_EQ((int)rs[i].t_c, first + i);
+    return snprintf((char *)d, cap, "[%d,%d]", first, n);
+}
+
+static void check_order(void)
+{
+    for (int i = 0; i < s_ndeliv; ++i) CHECK_EQ(s_delivered[i], i);
+}
+
+int main(void)
+{
+    ws_up_cfg_t cfg = { .uri = "ws://x/ingest/ws", .enc = enc };
+    CHECK(ws_up_open(0, &cfg));
+    CHECK(ws_up_connected(0, 0));
+    CHECK_EQ(ws_up_rtt_us(0), 4000);   // connect time until the first ack
+    int frames, r;
+
+    // 50 readings in binary frames of WS_BATCH_MAX
+    s_n = 50;
+    CHECK_EQ(ws_up_flush(0, &frames), 50);
+    CHECK_EQ(frames, (50 + WS_BATCH_MAX - 1) / WS_BATCH_MAX);
+    check_order();
+
+    // streaming: one new reading, one frame
+    for (int i = 0; i < 5; ++i) {
+        s_n++;
+        CHECK_EQ(ws_up_flush(0, &frames), 1);
+        CHECK_EQ(frames, 1);
+    }
+    check_order();
+
+    // another uri reopens the connection; text frames acked by "seq":N
+    cfg.uri = "ws://y/ingest/ws";
+    cfg.text = true;
+    CHECK(ws_up_open(0, &cfg));
+    s_n = 100;
+    CHECK_EQ(ws_up_flush(0, &frames), 45);
+    check_order();
+
+    // the socket takes only 2 frames: the window waits for acks instead of piling up
+    s_full_after = 2;
+    s_n = 200;
+    r = ws_up_flush(0, &frames);
+    CHECK_EQ(r, 100);
+    CHECK_EQ(frames, (100 + WS_BATCH_MAX - 1) / WS_BATCH_MAX);
+    check_order();
+    s_full_after = 1000;
+
+    // the link drops with frames in flight: -1, nothing committed past the
+    // acks, and the frames go out again on the new connection
+    s_n = 260;
+    s_drop_next = true;
+    CHECK_EQ(ws_up_flush(0, &frames), -1);
+    CHECK_EQ(s_cur, 200);
+    s_conn = 1;
+    emit(WEBSOCKET_EVENT_CONNECTED, NULL);
+    CHECK_EQ(ws_up_flush(0, &frames), 60);
+    CHECK_EQ(s_cur, 260);
+    check_order();
+    TEST_DONE();
+}
@@ -3,11 +3,26 @@
 // - HTTPS ingest to Render (with X-API-Key)
 // - SNTP time sync (TLS needs correct clock)
 // - Cert bundle trust (Let's Encrypt, etc.)
-// - MAX31856 read + per-interval POST with queue
+// - MAX31856 read + per-interval POST with queue (batched on backlog)
+// - MAX31856 conversions read on its DRDY interrupt, averaged to the sample period
+// - Several thermocouple channels (one MAX31856 each) on one SPI bus, readings tagged with the channel
+// - Optional one-shot conversions: chips idle and the CPU light-sleeps between samples
+// - Mirrored delivery: every reading goes to each sink (LAN + cloud),
+//   one uploader, keep-alive HTTP session and queue cursor per sink
+// - Queue overflow spooled to a flash partition (survives outages and reboots)
+// - Ingest server picked from an NVS endpoint list by live RTT / error score
+// - Ingest hostnames resolved through a TTL-respecting DNS cache
+// - Liveness from ingest results; /health probed only when idle or unhealthy
+// - Per-endpoint circuit breaker with jittered exponential backoff
+// - MQTT uplink (QoS1, persistent session, windowed publishes) for mqtt:// endpoints
+// - WebSocket uplink for ws:// endpoints, readings streamed as they are sampled
+// - CoAP (UDP) uplink for coap:// endpoints on the LAN, one datagram each way per batch
+// - Server-directed cadence, batch size and Retry-After from ingest responses
 // - Health checks + alert LED (GPIO1) if no successful ingest
 // - SoftAP portal fallback if Wi-Fi not provisioned
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -37,101 +52,174 @@
 #include "portal.h"       // your SoftAP provisioning portal
 #include "nvs_kv.h"       // your NVS helpers (optional here)
 #include "max31856.h"     // your MAX31856 driver
+#include "reading.h"
+#include "ingest_enc.h"
+#include "spool.h"        // flash overflow for the sample queue
+#include "sample_q.h"     // lock-free sample queue (task_sensor → one task_upl per sink)
+#include "endpoints.h"      // ingest server table + RTT/error scoring
+#include "ep_pick.h"        // parallel /health probes at boot
+#include "dns_cache.h"      // cached A records for the ingest hosts
+#include "mqtt_up.h"        // MQTT transport for mqtt:// / mqtts:// endpoints
+#include "ws_up.h"          // WebSocket transport for ws:// / wss:// endpoints
+#include "coap_up.h"        // CoAP transport for coap:// endpoints
+#include "srv_hints.h"      // cadence / batch / Retry-After hints in responses
 
 // Settings
 static const char *TAG = "APP";
 #define WIFI_CONNECT_TIMEOUT_MS   40000   // Enterprise can take a while
 
-#define POST_PERIOD_MS 15000   // Default post cadence
+#define POST_PERIOD_MS 15000   // Default post cadence (servers can move it, srv_hints.h)
 
-const char* PRIMARY_BASE = "https://freezer-monitor-server.onrender.com";
-const char* FALLBACK_BASE = "http://192.168.0.42:3000";  // your laptop / local server IP on the LAN
+// Readings packed into one POST /ingest/batch body while flushing the queue.
+// 1 keeps the legacy one-POST-per-sample /ingest path.
+#define INGEST_BATCH_MAX 8
+
+// Batch body encoding: INGEST_FMT_JSON, INGEST_FMT_BIN for the compact
+// little-endian records, or INGEST_FMT_DELTA for delta/varint columns
+// (both binary formats are described in ingest_enc.h, posted to /ingest/bin)
+#define INGEST_FORMAT INGEST_FMT_JSON
+
+// MQTT sinks publish the same bodies (QoS1) to this topic (%s = device id),
+// the broker's bridge to the ingest server plays the role of /ingest/batch
+#if INGEST_FORMAT == INGEST_FMT_JSON
+#define MQTT_TOPIC_FMT "freezer/%s/ingest"
+#else
+#define MQTT_TOPIC_FMT "freezer/%s/ingest/bin"
+#endif
+
+// WebSocket sinks open BASE<WS_PATH> and send the same bodies as frames
+// (text for JSON, binary otherwise; framing in ws_up.h)
+#define WS_PATH "/ingest/ws"
+
+// CoAP sinks POST the same bodies to coap://host[:port]/<COAP_PATH>
+#if INGEST_FORMAT == INGEST_FMT_JSON
+#define COAP_PATH "ingest/batch"
+#else
+#define COAP_PATH "ingest/bin"
+#endif
 
 #define USE_SMOOTHING     1
 #define SMOOTH_ALPHA      0.25f
 
-static char s_base_url[128] = {0};
-static bool s_use_tls = false;
+//Local and cloud server website location: built-in endpoint table, used
+//when NVS has no "endpoints" key (see endpoints.h), in priority order.
+//Each is its own sink, so readings are mirrored to both.
+static const char *const EP_DEFAULTS[] = {
+    "http://172.16.0.123:3000",
+    "https://freezer-monitor-server.onrender.com",
+};
 
-//Local and cloud server website location
-static const char *URL_LOCAL = "http://172.16.0.123:3000";
-static const char *URL_CLOUD = "https://freezer-monitor-server.onrender.com";
+// Response body captured by http_evt (esp_http_client_perform consumes the
+// body itself, so esp_http_client_read_response afterwards returns nothing)
+typedef struct {
+    char buf[160];
+    int  len;
+} http_resp_t;
+
+// Long-lived client owned by a sink's uploader, shared by /ingest and /health
+// on the sink's current base. keep-alive lets consecutive requests reuse one
+// TCP/TLS connection. A transport error only closes the connection; the
+// client (and with it the cached TLS session ticket) is destroyed on a base switch.
+typedef struct {
+    esp_http_client_handle_t h;
+    char        base[128];   // base the client was opened for
+    bool        tls;
+    char        host[96];    // base's hostname when connecting by cached address (TLS name), else ""
+    http_resp_t resp;        // body of the last response
+    srv_hints_t hints;       // hints in the last response (headers, then body)
+    uint32_t    requests;    // requests performed
+    uint32_t    connects;    // new TCP/TLS connections (HTTP_EVENT_ON_CONNECTED)
+    uint32_t    resets;      // connection closed after an error, or base switch
+    bool        stats_due;        // next request carries X-DNS-Stats (set once per health cycle)
+    int64_t     req_start_us;     // esp_timer time the current request started
+    int64_t     connect_us_total; // sum / max of request start → connected
+    int64_t     connect_us_max;
+} http_session_t;
+
+// One delivery destination (endpoints.h "sink"). Each has its own uploader
+// task, session and cursor in the sample queue, so a slow or dead cloud
+// link never holds back the LAN server, and vice versa.
+typedef struct {
+    int          id;          // sink index (sample queue / spool cursor)
+    int          ep;          // endpoints.c index in use, -1 = none
+    char         base[128];   // ep_base(ep)
+    bool         tls;
+    volatile bool ok;         // health verdict, written by the sink's uploader
+    TaskHandle_t task;        // the sink's uploader (task_upl)
+    int64_t      last_ok_us;  // last ingest this sink stored (uploader only)
+    http_session_t http;
+
+    // uploader pipeline telemetry
+    volatile int inflight;    // readings in the request on the wire
+    uint32_t requests;
+    int64_t  last_us, total_us, max_us;
+    uint32_t health_probes;   // /health GETs actually sent
+    uint32_t health_skipped;  // health cycles answered by a recent ingest instead
+    uint32_t health_deferred; // health cycles skipped by an open circuit breaker
+
+    // what the current endpoint's server asked for (srv_hints.h), 0 = default
+    int32_t  period_ms;       // upload cadence (and sample period, see sample_retune)
+    int      batch_max;       // readings per POST
+    int64_t  hold_until_us;   // Retry-After: no uploads before this
+    int64_t  next_flush_us;   // next upload at the sink's cadence
+} sink_t;
+
+static sink_t s_sink[SQ_SINKS];
+static int    s_sink_n = 1;   // sinks in use (ep_sinks())
 
 #define ENABLE_HTTP_POST 1
 #if ENABLE_HTTP_POST
-  static int http_post_reading(const char *device_id, float temp_c, uint8_t sr, int64_t ts_ms);
+  static int http_post_reading(sink_t *sk, const char *device_id, float temp_c, uint8_t sr, uint8_t ch, int64_t ts_ms);
+  static int http_post_batch(sink_t *sk, const char *device_id, const reading_t *rs, int n, int *accepted);
 
   // MUST match Render → Environment → API_KEY
   #define API_KEY        "super_secret_key_here"
   #else
-  static inline int http_post_reading(const char *device_id, float temp_c, uint8_t sr, int64_t ts_ms)
-  { (void)device_id; (void)temp_c; (void)sr; (void)ts_ms; return -1; }
+  static inline int http_post_reading(sink_t *sk, const char *device_id, float temp_c, uint8_t sr, uint8_t ch, int64_t ts_ms)
+  { (void)sk; (void)device_id; (void)temp_c; (void)sr; (void)ch; (void)ts_ms; return -1; }
+  static inline int http_post_batch(sink_t *sk, const char *device_id, const reading_t *rs, int n, int *accepted)
+  { (void)sk; (void)device_id; (void)rs; (void)n; *accepted = 0; return -1; }
 #endif
 
-// Health control
-static bool s_server_ok = false;
+// Health control: each sink's uploader writes its own verdict (sink_t.ok)
 static const int64_t HEALTH_PERIOD_US = 60LL * 1000000LL; // every 60s
 
-// Sample queue (lock-protected ring buffer)
-// Fixed-size First in first out (FIFO) buffer (no malloc)
-typedef struct {
-    float    t_c;
-    uint8_t  sr;
-    int64_t  ts_ms_utc;
-} reading_t;
-
-//16 samples
-#define RB_CAP 16
 #define ALERT_LED_GPIO 1   // Alert LED on GPIO1
 
 // Forward declarations used by tasks:
-static bool https_health_check(void);
+static void upl_stream_now(void);
+static bool https_health_check(sink_t *sk);
+static void http_session_log_stats(sink_t *sk);
+static void spool_log_stats(void);
 
 // Forward declarations for helpers used before their definitions
-static bool try_health_once(const char *base, bool tls);
-static void pick_base_url(void);
-static void maybe_prefer_local_again(void);
-
-
-// Sample Queue
-static reading_t   s_rb[RB_CAP];
-static volatile int s_rb_head = 0, s_rb_tail = 0;
-static portMUX_TYPE s_rb_lock = portMUX_INITIALIZER_UNLOCKED;
-
-// push or producer method
-static inline bool rb_push(reading_t r){
-    //enter critical section
-    taskENTER_CRITICAL(&s_rb_lock);
-    //move head to next
-    int nhead = (s_rb_head + 1) % RB_CAP;
-    //if full, drop the oldest by moving tail
-    if (nhead == s_rb_tail) { s_rb_tail = (s_rb_tail + 1) % RB_CAP; } // drop oldest
-    //store the new reading
-    s_rb[s_rb_head] = r;
-    s_rb_head = nhead;
-    taskEXIT_CRITICAL(&s_rb_lock);
-    return true;
-}
-
-//pop or consumer metho
-static inline bool rb_pop(reading_t *out){
-    //enter critical section
-    taskENTER_CRITICAL(&s_rb_lock);
-    bool ok = (s_rb_tail != s_rb_head);
-    //returns false if empty and copies oldest item and advances tail
-    if (ok) { *out = s_rb[s_rb_tail]; s_rb_tail = (s_rb_tail + 1) % RB_CAP; }
-    taskEXIT_CRITICAL(&s_rb_lock);
-    return ok;
-}
+static bool try_health_once(int ep, int timeout_ms);
+static bool pick_endpoints(void);
+static void ep_refresh(sink_t *sk);
+static void ep_reselect(sink_t *sk);
+
 
 // Tasks & timers & software interrupts
 static TaskHandle_t s_task_sensor = NULL;
 static TaskHandle_t s_task_net    = NULL;
 
+// Work requested from a sink's task_upl (task notification bits)
+#define UPL_HEALTH (1u << 0)   // refresh liveness (probe /health if ingests don't vouch for it), report to task_net
+#define UPL_FLUSH  (1u << 1)   // upload whatever is queued
+#define UPL_WAKE   (1u << 2)   // internal: the uploader's own timer (breaker trial or re-probe due)
+
+// task_sensor's notification bits
+#define SNS_TICK (1u << 0)   // sample timer: queue a reading
+#define SNS_DRDY(ch) (1u << (8 + (ch)))   // channel ch's MAX31856 has a conversion ready (ACQ_DRDY)
+
 static esp_timer_handle_t s_timer_sample = NULL;
+static uint32_t s_period_ms = POST_PERIOD_MS;   // s_timer_sample's period
+static portMUX_TYPE s_period_lock = portMUX_INITIALIZER_UNLOCKED;
 static esp_timer_handle_t s_timer_health = NULL;
 
+// Set by the uploaders (any sink), read by task_net's alert logic; 64-bit, so guarded
 static int64_t s_last_ingest_ok_us = 0;
+static portMUX_TYPE s_ingest_lock = portMUX_INITIALIZER_UNLOCKED;
 
 #define ALERT_WINDOW_MIN 2
 #define ALERT_WINDOW_US  ((int64_t)ALERT_WINDOW_MIN * 60LL * 1000000LL)
@@ -140,20 +228,54 @@ static bool s_alert_active = false;
 
 // Make device_id visible to tasks
 static char s_device_id[32] = {0};
+static char s_mqtt_topic[64] = {0};
 
 // SPI pins (ESP32-S3)
 #define PIN_NUM_MISO 13 // SDO
 #define PIN_NUM_MOSI 11 // SDI
 #define PIN_NUM_CLK  12 // SCK
 #define PIN_NUM_CS   10 // CS
+#define PIN_NUM_DRDY 9  // MAX31856 DRDY (active low)
+
+// Acquisition: 1 = read every conversion on the DRDY interrupt (~10/s in
+// continuous mode) and average them down to the sample period; 0 = poll the
+// chip once per sample timer tick and discard the conversions in between
+#define ACQ_DRDY 1
+
+// 1 = one-shot: the chips stay idle and one conversion is started per
+// sample timer tick, read on DRDY (ACQ_DRDY) or after its worst-case time.
+// Nothing wakes the CPU between ticks, so auto light sleep (CONFIG_PM_ENABLE)
+// can run; each reading lands a conversion time (~155-850 ms) after the tick.
+#define ACQ_ONESHOT 0
+
+// Thermocouple channels, one MAX31856 each on SPI2 with its own CS (and DRDY,
+// or -1 to poll it); a reading's ch is the index here. Add a line per probe.
+static const max31856_cfg_t TC_CHANNELS[] = {
+    { .cs_pin = PIN_NUM_CS, .drdy_pin = PIN_NUM_DRDY, .tc_type = MAX31856_TC_T, .avg_sel = 1,
+      .one_shot = ACQ_ONESHOT },
+    // { .cs_pin = 14, .drdy_pin = 15, .tc_type = MAX31856_TC_K, .avg_sel = 1, .one_shot = ACQ_ONESHOT },
+};
+#define TC_N ((int)(sizeof(TC_CHANNELS) / sizeof(TC_CHANNELS[0])))
+_Static_assert(TC_N <= MAX31856_MAX_CH, "too many thermocouple channels");
+
+static max31856_handle_t s_tc[TC_N];
+#if ACQ_DRDY || ACQ_ONESHOT
+static bool s_tc_drdy[TC_N];   // DRDY interrupt running for the channel, else polled
+#endif
+
+// true while at least one sink can take uploads
+static bool any_sink_ok(void){
+    for (int k = 0; k < s_sink_n; ++k) if (s_sink[k].ok) return true;
+    return false;
+}
 
 // Timer callbacks (post a notify to tasks)
 static void cb_sample(void *arg){
     (void)arg;
     //every 15 sec wakeup sensor task
-    if (s_task_sensor) xTaskNotifyGive(s_task_sensor);
-    //if server healthy, wake net task
-    if (s_server_ok && s_task_net) xTaskNotifyGive(s_task_net); // only when healthy
+    if (s_task_sensor) xTaskNotify(s_task_sensor, SNS_TICK, eSetBits);
+    //if a server is healthy, wake net task
+    if (any_sink_ok() && s_task_net) xTaskNotifyGive(s_task_net); // only when healthy
 }
 
 // healthy timer callback
@@ -163,47 +285,211 @@ static void cb_health(void *arg){
     if (s_task_net) xTaskNotifyGive(s_task_net);
 }
 
+// Filters, stamps and queues one reading of channel ch; t_us = esp_timer time of the conversion
+static void sensor_emit(int ch, float t, uint8_t sr, int64_t t_us, int convs){
+
+    // one filter per channel
+    static bool  s_have_filt[TC_N];
+    static float s_filt_c[TC_N];
+
+    // Fault-aware smoothing: if sr!=0, treat as raw (don’t smooth faults)
+    float use_c = t;
+    //temperature reading smoothing
+#if USE_SMOOTHING
+    if (sr == 0) {
+        if (!s_have_filt[ch]) { s_filt_c[ch] = t; s_have_filt[ch] = true; }
+        else                  { s_filt_c[ch] = SMOOTH_ALPHA * t + (1.0f - SMOOTH_ALPHA) * s_filt_c[ch]; }
+        use_c = s_filt_c[ch];
+    } else {
+        // pass through raw on fault; keep EMA state so it catches up next sample
+        use_c = t;
+    }
+#endif
+    // timestamp (UTC) of the conversion, not of this wakeup
+    struct timeval tv; gettimeofday(&tv, NULL);
+    int64_t ts_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000
+                  - (esp_timer_get_time() - t_us) / 1000;
+
+    //push into ring buffer
+    reading_t r = { .t_c = use_c, .sr = sr, .ch = (uint8_t)ch, .ts_ms_utc = ts_ms };
+    if (!sq_push(&r)) ESP_LOGW(TAG, "Sample queue full — sample dropped (%u total)", (unsigned)sq_dropped());
+    else upl_stream_now();
+
+    ESP_LOGI(TAG, "Sample queued: ch%d raw=%.2f°C filt=%.2f°C -> send=%.2f°C (sr=0x%02X, %d conv) @ %lld",
+    ch, t, s_have_filt[ch] ? s_filt_c[ch] : t, r.t_c, sr, convs, (long long)ts_ms);
+}
+
+#if !ACQ_ONESHOT
+// One read of each of the n channels in chs on the sample timer's tick
+// (polling mode, or DRDY gone quiet), as a single SPI sweep
+static void sensor_poll(const int *chs, int n){
+    max31856_handle_t hs[TC_N];
+    max31856_conv_t   cv[TC_N];
+    for (int i = 0; i < n; ++i) hs[i] = s_tc[chs[i]];
+    //read sensors
+    max31856_sweep(hs, n, cv);
+    for (int i = 0; i < n; ++i) {
+        if (cv[i].ok) sensor_emit(chs[i], cv[i].t_c, cv[i].sr, esp_timer_get_time(), 1);
+        else ESP_LOGW(TAG, "MAX31856 ch%d read failed", chs[i]);
+    }
+}
+#endif
+
+#if ACQ_ONESHOT
+// Extra wait past the worst-case conversion time for a DRDY that is late
+#define ONESHOT_MARGIN_MS 20
+
+// One reading per channel on a tick in one-shot mode: start every chip's
+// conversion, block until each DRDY channel has signalled (polled ones get
+// the worst-case time), then read them all in one sweep. Readings are
+// stamped when their conversion finished, not when the tick fired.
+static void sensor_oneshot(void){
+    max31856_handle_t hs[TC_N];
+    max31856_conv_t   cv[TC_N];
+    int      chs[TC_N];
+    int      n = 0;
+    uint32_t all = 0;        // DRDY bits of the started channels
+    uint32_t conv_ms = 0;    // longest conversion among them
+    bool     polled = false;
+
+    // a DRDY left over from a late conversion must not end this wait early
+    for (int ch = 0; ch < TC_N; ++ch) all |= SNS_DRDY(ch);
+    ulTaskNotifyValueClear(NULL, all);
+    all = 0;
+
+    int64_t t0 = esp_timer_get_time();
+    for (int ch = 0; ch < TC_N; ++ch) {
+        if (max31856_start(s_tc[ch]) != ESP_OK) {
+            ESP_LOGW(TAG, "ch%d one-shot start failed", ch);
+            continue;
+        }
+        uint32_t ms = max31856_conv_time_ms(s_tc[ch]);
+        if (ms > conv_ms) conv_ms = ms;
+        if (s_tc_drdy[ch]) all |= SNS_DRDY(ch);
+        else polled = true;
+        hs[n] = s_tc[ch]; chs[n++] = ch;
+    }
+    if (!n) return;
+
+    int64_t drdy_until   = t0 + ((int64_t)conv_ms + ONESHOT_MARGIN_MS) * 1000;
+    int64_t polled_until = polled ? t0 + (int64_t)conv_ms * 1000 : 0;
+    uint32_t want = all;
+    for (;;) {
+        int64_t now = esp_timer_get_time();
+        int64_t end = want ? drdy_until : polled_until;
+        if (now >= end) break;
+        // only DRDY bits are taken: a tick arriving meanwhile stays pending
+        uint32_t ev = 0;
+        xTaskNotifyWait(0, all, &ev, pdMS_TO_TICKS((end - now + 999) / 1000) + 1);
+        want &= ~ev;
+    }
+    for (int i = 0; i < n; ++i) {
+        if (want & SNS_DRDY(chs[i])) {
+            ESP_LOGW(TAG, "ch%d: no DRDY within %u ms of one-shot start — reading anyway",
+                     chs[i], (unsigned)(conv_ms + ONESHOT_MARGIN_MS));
+        }
+    }
+
+    max31856_sweep(hs, n, cv);
+    int64_t now = esp_timer_get_time();
+    ESP_LOGD(TAG, "One-shot: %d channel(s) read %lld ms after start (worst case %u ms)",
+             n, (long long)((now - t0) / 1000), (unsigned)conv_ms);
+    for (int i = 0; i < n; ++i) {
+        // a DRDY stamp from before the start is a previous conversion's (timed out)
+        int64_t t_us = cv[i].ts_us > t0 ? cv[i].ts_us : now;
+        if (cv[i].ok) sensor_emit(chs[i], cv[i].t_c, cv[i].sr, t_us, 1);
+        else ESP_LOGW(TAG, "MAX31856 ch%d read failed", chs[i]);
+    }
+}
+#endif
+
 // Tasks
 static void task_sensor(void *arg){
 
-    static bool  s_have_filt = false;
-    static float s_filt_c    = 0.0f;
+#if ACQ_DRDY
+    // DRDY is armed here, not from app_main: drdy_enable reads the chip, and
+    // all SPI on the shared device must come from this task (an armed
+    // channel's interrupt already has this task sweeping). A channel without
+    // it (no drdy_pin, or setup failed) is polled on every tick, as with ACQ_DRDY 0
+    for (int ch = 0; ch < TC_N; ++ch) {
+        if (TC_CHANNELS[ch].drdy_pin < 0) continue;
+        s_tc_drdy[ch] = max31856_drdy_enable(s_tc[ch], xTaskGetCurrentTaskHandle(), SNS_DRDY(ch)) == ESP_OK;
+        if (!s_tc_drdy[ch]) ESP_LOGW(TAG, "ch%d DRDY interrupt setup failed; polling on the sample timer", ch);
+    }
+#endif
+
+#if ACQ_DRDY && !ACQ_ONESHOT
+    // per channel, conversions since the last reading: averaged (boxcar
+    // decimation to the sample period) and stamped with their mean conversion
+    // time; a faulted conversion is passed through raw instead
+    struct {
+        float    sum_c;
+        int64_t  sum_us;
+        int      n;
+        float    fault_c;
+        uint8_t  fault_sr;
+        int64_t  fault_us;
+        uint32_t stalls;
+    } acc[TC_N];
+    memset(acc, 0, sizeof(acc));
+    max31856_handle_t hs[TC_N];
+    max31856_conv_t   cv[TC_N];
+#endif
 
     //loop
     for(;;){
-        // wait for software interrupt to wake
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-
-        float t=0; uint8_t sr=0;
-        //read sensor
-        if (max31856_get_temp_c(&t, &sr)) {
-
-            // Fault-aware smoothing: if sr!=0, treat as raw (don’t smooth faults)
-            float use_c = t;
-            //temperature reading smoothing
-#if USE_SMOOTHING
-            if (sr == 0) {
-                if (!s_have_filt) { s_filt_c = t; s_have_filt = true; }
-                else              { s_filt_c = SMOOTH_ALPHA * t + (1.0f - SMOOTH_ALPHA) * s_filt_c; }
-                use_c = s_filt_c;
+        // wait for the sample timer (SNS_TICK) or a conversion (SNS_DRDY(ch))
+        uint32_t ev = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &ev, portMAX_DELAY);
+
+#if ACQ_ONESHOT
+        if (ev & SNS_TICK) sensor_oneshot();
+#else
+        int chs[TC_N];
+        int nch = 0;
+#if ACQ_DRDY
+        // every channel that signalled since the last wakeup, read in one sweep
+        for (int ch = 0; ch < TC_N; ++ch) {
+            if (ev & SNS_DRDY(ch)) { hs[nch] = s_tc[ch]; chs[nch++] = ch; }
+        }
+        if (nch) max31856_sweep(hs, nch, cv);
+        for (int i = 0; i < nch; ++i) {
+            int ch = chs[i];
+            if (!cv[i].ok) continue;
+            if (cv[i].sr) { acc[ch].fault_c = cv[i].t_c; acc[ch].fault_sr = cv[i].sr; acc[ch].fault_us = cv[i].ts_us; }
+            else          { acc[ch].sum_c += cv[i].t_c; acc[ch].sum_us += cv[i].ts_us; acc[ch].n++; }
+        }
+        if (!(ev & SNS_TICK)) continue;
+
+        // one reading per channel per tick; the ones with nothing to show are polled together
+        nch = 0;
+        for (int ch = 0; ch < TC_N; ++ch) {
+            int n = acc[ch].n;
+            if (!s_tc_drdy[ch]) {
+                chs[nch++] = ch;
+            } else if (acc[ch].fault_sr) {
+                sensor_emit(ch, acc[ch].fault_c, acc[ch].fault_sr, acc[ch].fault_us, n + 1);
+            } else if (n) {
+                sensor_emit(ch, acc[ch].sum_c / n, 0, acc[ch].sum_us / n, n);
             } else {
-                // pass through raw on fault; keep EMA state so it catches up next sample
-                use_c = t;
+                // no conversion since the last tick: DRDY never fell, or fell and
+                // went unread; reading now releases it and keeps the cadence
+                uint32_t edges, reads;
+                max31856_drdy_counts(s_tc[ch], &edges, &reads);
+                ESP_LOGW(TAG, "ch%d: no DRDY since last sample (%u stall(s), %u edge(s), %u read(s)) — polling",
+                         ch, (unsigned)++acc[ch].stalls, (unsigned)edges, (unsigned)reads);
+                chs[nch++] = ch;
             }
-#endif
-            // get timestamp (UTC)
-            struct timeval tv; gettimeofday(&tv, NULL);
-            int64_t ts_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
-        
-            //push into ring buffer
-            reading_t r = { .t_c = use_c, .sr = sr, .ts_ms_utc = ts_ms };
-            rb_push(r);
-            
-            ESP_LOGI(TAG, "Sample queued: raw=%.2f°C filt=%.2f°C -> send=%.2f°C (sr=0x%02X) @ %lld",
-            t, s_have_filt ? s_filt_c : t, r.t_c, sr, (long long)ts_ms);
-        }else {
-            ESP_LOGW(TAG, "MAX31856 read failed");
+            acc[ch].sum_c = 0.0f; acc[ch].sum_us = 0; acc[ch].n = 0; acc[ch].fault_sr = 0;
         }
+        if (nch) sensor_poll(chs, nch);
+#else
+        if (ev & SNS_TICK) {
+            for (int ch = 0; ch < TC_N; ++ch) chs[nch++] = ch;
+            sensor_poll(chs, nch);
+        }
+#endif
+#endif
     }
 }
 
@@ -221,73 +507,466 @@ static void update_alert_led(bool on){
     gpio_set_level(ALERT_LED_GPIO, on ? 1 : 0);
 }
 
-// health check, upload queue, alert LED
+static void note_ingest_ok(sink_t *sk){
+    int64_t now = esp_timer_get_time();
+    sk->last_ok_us = now;
+    taskENTER_CRITICAL(&s_ingest_lock);
+    s_last_ingest_ok_us = now;
+    taskEXIT_CRITICAL(&s_ingest_lock);
+}
+
+// returns the last successful ingest time; `now` seeds it at boot
+static int64_t last_ingest_ok(int64_t now){
+    taskENTER_CRITICAL(&s_ingest_lock);
+    if (s_last_ingest_ok_us == 0) s_last_ingest_ok_us = now; // baseline at boot
+    int64_t t = s_last_ingest_ok_us;
+    taskEXIT_CRITICAL(&s_ingest_lock);
+    return t;
+}
+
+// Health requests go to every sink, flushes only to the healthy ones
+static void upl_request(uint32_t bits){
+    for (int k = 0; k < s_sink_n; ++k) {
+        sink_t *sk = &s_sink[k];
+        uint32_t b = sk->ok ? bits : (bits & ~UPL_FLUSH);
+        if (b && sk->task) xTaskNotify(sk->task, b, eSetBits);
+    }
+}
+
+// Streaming sinks (MQTT, WebSocket) send each reading as soon as it is queued
+// instead of on task_net's next flush
+static void upl_stream_now(void){
+    for (int k = 0; k < s_sink_n; ++k) {
+        sink_t *sk = &s_sink[k];
+        if (sk->ok && sk->task && ep_proto(sk->ep) != EP_HTTP) xTaskNotify(sk->task, UPL_FLUSH, eSetBits);
+    }
+}
+
+// one request's wall time, from handing the readings over to the verdict
+static void upl_note_request(sink_t *sk, int64_t t0){
+    int64_t dt = esp_timer_get_time() - t0;
+    sk->requests++;
+    sk->last_us = dt;
+    sk->total_us += dt;
+    if (dt > sk->max_us) sk->max_us = dt;
+}
+
+// The sink's upload cadence: the server's, else POST_PERIOD_MS for HTTP;
+// streaming sinks send every reading as it comes (0)
+static int64_t upl_period_us(const sink_t *sk){
+    if (sk->period_ms) return (int64_t)sk->period_ms * 1000LL;
+    return ep_proto(sk->ep) == EP_HTTP ? (int64_t)POST_PERIOD_MS * 1000LL : 0;
+}
+
+static void upl_log_stats(sink_t *sk){
+    ESP_LOGI(TAG, "uploader %d: %u queued (+%u spooled), %d in flight, %u request(s), last %lld ms avg %lld ms max %lld ms",
+             sk->id, (unsigned)sq_count_sink(sk->id), (unsigned)spool_count_sink(sk->id), sk->inflight,
+             (unsigned)sk->requests, (long long)(sk->last_us / 1000),
+             (long long)(sk->requests ? sk->total_us / sk->requests / 1000 : 0),
+             (long long)(sk->max_us / 1000));
+    // every skipped probe is one request (and, with modem sleep, one radio wakeup) saved
+    int64_t up_s = esp_timer_get_time() / 1000000LL;
+    ESP_LOGI(TAG, "health %d: %u probe(s), %u piggybacked on ingests (saving ~%u req/h), %u deferred by breaker",
+             sk->id, (unsigned)sk->health_probes, (unsigned)sk->health_skipped,
+             (unsigned)(up_s > 0 ? (int64_t)sk->health_skipped * 3600 / up_s : 0),
+             (unsigned)sk->health_deferred);
+    int64_t hold_s = (sk->hold_until_us - esp_timer_get_time()) / 1000000LL;
+    if (sk->period_ms || sk->batch_max || hold_s > 0)
+        ESP_LOGI(TAG, "hints %d: cadence %d s, batch %d, hold %lld s (sampling every %u s)",
+                 sk->id, (int)(upl_period_us(sk) / 1000000LL), sk->batch_max ? sk->batch_max : INGEST_BATCH_MAX,
+                 (long long)(hold_s > 0 ? hold_s : 0), (unsigned)(s_period_ms / 1000));
+}
+
+// An ingest that never got an answer (or got a 5xx) means the server can't be
+// vouched for anymore: go unhealthy so task_net stops flushing and /health takes over
+static void upl_note_failure(sink_t *sk, int sc){
+    if (!sk->ok) return;
+    ESP_LOGW(TAG, "Ingest failed (%d); marking sink %d (%s) unhealthy", sc, sk->id, sk->base);
+    sk->ok = false;
+    if (s_task_net) xTaskNotifyGive(s_task_net);
+}
+
+// No Retry-After running and the sink's cadence is due
+static bool upl_due(const sink_t *sk, int64_t now){
+    return now >= sk->hold_until_us && now >= sk->next_flush_us;
+}
+
+// A recent ingest vouches for the server for one health period, or two of
+// the sink's upload periods if the server slowed it down further
+static int64_t upl_health_window_us(const sink_t *sk){
+    int64_t w = 2 * upl_period_us(sk);
+    return w > HEALTH_PERIOD_US ? w : HEALTH_PERIOD_US;
+}
+
+// No-ingest alert window: stretched only if every sink was slowed down
+static int64_t alert_window_us(void){
+    int64_t fastest = INT64_MAX;
+    for (int k = 0; k < s_sink_n; ++k) {
+        int64_t p = upl_period_us(&s_sink[k]);
+        if (p && p < fastest) fastest = p;
+    }
+    return fastest != INT64_MAX && 2 * fastest > ALERT_WINDOW_US ? 2 * fastest : ALERT_WINDOW_US;
+}
+
+// Sample at the fastest cadence any sink's server asked for (POST_PERIOD_MS
+// for sinks without a hint); a sink that wants fewer uploads gets the extra
+// readings batched instead
+static void sample_retune(void){
+    uint32_t p = UINT32_MAX;
+    for (int k = 0; k < s_sink_n; ++k) {
+        uint32_t q = s_sink[k].period_ms ? (uint32_t)s_sink[k].period_ms : POST_PERIOD_MS;
+        if (q < p) p = q;
+    }
+    taskENTER_CRITICAL(&s_period_lock);   // any uploader may call this
+    bool changed = p != s_period_ms;
+    s_period_ms = p;
+    taskEXIT_CRITICAL(&s_period_lock);
+    if (!changed) return;
+    ESP_LOGI(TAG, "Sample period now %u s", (unsigned)(p / 1000));
+    if (s_timer_sample) esp_timer_restart(s_timer_sample, (uint64_t)p * 1000ULL);
+}
+
+static void upl_hold(sink_t *sk, int32_t s){
+    sk->hold_until_us = esp_timer_get_time() + (int64_t)s * 1000000LL;
+    if (s) ESP_LOGW(TAG, "Sink %d: server asks to hold uploads for %d s", sk->id, (int)s);
+}
+
+// Hints from the sink's last HTTP response (srv_hints.h). Cadence and batch
+// size stay until the server sends new ones or the sink changes endpoint.
+static void upl_apply_hints(sink_t *sk, const srv_hints_t *h){
+    if (h->retry_after_s >= 0) upl_hold(sk, h->retry_after_s);
+    if (h->batch) {
+        int b = h->batch > INGEST_BATCH_MAX ? INGEST_BATCH_MAX : h->batch;
+        if (b != sk->batch_max) ESP_LOGI(TAG, "Sink %d: server asks for batches of %d", sk->id, b);
+        sk->batch_max = b;
+    }
+    if (h->period_ms && h->period_ms != sk->period_ms) {
+        ESP_LOGI(TAG, "Sink %d: server asks for a %d s cadence", sk->id, (int)(h->period_ms / 1000));
+        sk->period_ms = h->period_ms;
+        sample_retune();
+    }
+}
+
+static void upl_clear_hints(sink_t *sk){
+    bool retune = sk->period_ms != 0;
+    sk->period_ms = 0;
+    sk->batch_max = 0;
+    sk->hold_until_us = sk->next_flush_us = 0;
+    if (retune) sample_retune();
+}
+
+// MQTT / WebSocket payload: the body the HTTP batch path would post
+static int upl_encode(uint8_t *dst, size_t cap, const reading_t *rs, int n){
+#if INGEST_FORMAT == INGEST_FMT_BIN
+    return ingest_enc_bin(dst, cap, s_device_id, rs, n);
+#elif INGEST_FORMAT == INGEST_FMT_DELTA
+    return ingest_enc_delta(dst, cap, s_device_id, rs, n, s_period_ms);
+#else
+    return ingest_enc_json((char *)dst, cap, s_device_id, rs, n);
+#endif
+}
+
+// Opens the sink's MQTT / WebSocket / CoAP session while its endpoint uses one,
+// closes the ones it no longer uses
+static void upl_stream_sync(sink_t *sk){
+    ep_proto_t proto = ep_proto(sk->ep);
+    if (proto != EP_MQTT) mqtt_up_close(sk->id);
+    if (proto != EP_WS)   ws_up_close(sk->id);
+    if (proto != EP_COAP) coap_up_close(sk->id);
+
+    if (proto == EP_COAP) {
+        coap_up_cfg_t cfg = {
+            .base = sk->base,
+            .path = COAP_PATH,
+            .json = INGEST_FORMAT == INGEST_FMT_JSON,
+            .enc = upl_encode,
+        };
+        coap_up_open(sk->id, &cfg);
+        return;
+    }
+
+    if (proto == EP_WS) {
+        static char uris[SQ_SINKS][160];
+        snprintf(uris[sk->id], sizeof(uris[0]), "%s%s", sk->base, WS_PATH);
+        ws_up_cfg_t cfg = {
+            .uri = uris[sk->id],
+#if ENABLE_HTTP_POST
+            .headers = "X-API-Key: " API_KEY "\r\n",
+#endif
+            .text = INGEST_FORMAT == INGEST_FMT_JSON,
+            .enc = upl_encode,
+        };
+        ws_up_open(sk->id, &cfg);
+        return;
+    }
+    if (proto != EP_MQTT) return;
+
+    // one client id per sink, stable across reboots: it names the broker-side session
+    static char ids[SQ_SINKS][40];
+    snprintf(ids[sk->id], sizeof(ids[0]), "%s-%d", s_device_id, sk->id);
+    mqtt_up_cfg_t cfg = {
+        .base = sk->base,
+        .client_id = ids[sk->id],
+        .username = s_device_id,
+#if ENABLE_HTTP_POST
+        .password = API_KEY,
+#endif
+        .topic = s_mqtt_topic,
+        .enc = upl_encode,
+    };
+    mqtt_up_open(sk->id, &cfg);
+}
+
+// MQTT / WebSocket / CoAP sinks: the session keeps a window of messages in
+// flight and commits readings as the server acks them (ack_win.h)
+static void upl_flush_stream(sink_t *sk){
+    ep_proto_t proto = ep_proto(sk->ep);
+    int64_t t0 = esp_timer_get_time();
+    if (!ep_allow(sk->ep, t0)) return;
+    int msgs = 0, sent;
+    int64_t rtt;
+    const char *unit;
+    if (proto == EP_WS) {
+        sent = ws_up_flush(sk->id, &msgs);
+        rtt = ws_up_rtt_us(sk->id);
+        unit = "frame(s)";
+    } else if (proto == EP_COAP) {
+        sent = coap_up_flush(sk->id, &msgs);
+        rtt = coap_up_rtt_us(sk->id);
+        unit = "message(s)";
+    } else {
+        sent = mqtt_up_flush(sk->id, &msgs);
+        rtt = mqtt_up_rtt_us(sk->id);
+        unit = "publish(es)";
+    }
+    // nothing went out (empty queue, outbox full, send timeout): hand back a trial
+    if (msgs || sent < 0) ep_report(sk->ep, sent >= 0, rtt);
+    else ep_release(sk->ep);
+    if (sent < 0) {
+        upl_note_failure(sk, -1);
+        return;
+    }
+    if (sent) {
+        note_ingest_ok(sk);
+        // same shape as the HTTP line below, for comparing transports against one server
+        ESP_LOGI(TAG, "Flushed %d queued reading(s) to sink %d in %d %s, %lld ms",
+                 sent, sk->id, msgs, unit,
+                 (long long)((esp_timer_get_time() - t0) / 1000));
+    }
+}
+
+// Flush the sink's backlog over its HTTP, MQTT, WebSocket or CoAP session (the sink's uploader only)
+static void upl_flush(sink_t *sk){
+    if (ep_proto(sk->ep) != EP_HTTP) {
+        upl_flush_stream(sk);
+        return;
+    }
+    int sent = 0, posts = 0;
+    int64_t t0 = esp_timer_get_time();
+
+#if INGEST_BATCH_MAX > 1
+    // peek → send → commit exactly what the server acknowledged;
+    // everything else stays at the head of the queue, in order
+    // one buffer per sink (static to keep it off t_upl's stack)
+    static reading_t batches[SQ_SINKS][INGEST_BATCH_MAX];
+    reading_t *batch = batches[sk->id];
+
+    for (;;) {
+        int n = sq_peek_n(sk->id, batch, sk->batch_max ? sk->batch_max : INGEST_BATCH_MAX);
+        if (n == 0) break;
+
+        int accepted = 0;
+        int64_t tr = esp_timer_get_time();
+        sk->inflight = n;
+        int sc = http_post_batch(sk, s_device_id, batch, n, &accepted);
+        sk->inflight = 0;
+        upl_note_request(sk, tr);
+        posts++;
+        if (sc == 200 || sc == 207) {
+            // 200 = whole batch stored, 207 = only the first `accepted` readings stored
+            sq_commit_n(sk->id, accepted);
+            if (accepted > 0) {
+                note_ingest_ok(sk);
+                sent += accepted;
+            }
+            // partial ack → retry the rest on the next wakeup
+            if (accepted < n) break;
+        } else if (sc == 429 || (sc == 503 && sk->http.hints.retry_after_s >= 0)) {
+            // server shedding load, not down: keep the batch queued and wait out Retry-After
+            sq_abort(sk->id);
+            if (sk->http.hints.retry_after_s < 0) upl_hold(sk, (int32_t)(HEALTH_PERIOD_US / 1000000LL));
+            break;
+        } else if (sc >= 500 || sc < 0) {
+            // server problem or transport error → keep the batch queued and stop for now
+            sq_abort(sk->id);
+            upl_note_failure(sk, sc);
+            break;
+        } else if (sc == 401 || sc == 403) {
+            ESP_LOGE(TAG, "Forbidden (API key?) — dropping %d sample(s) and keeping alert active", n);
+            sq_commit_n(sk->id, n);
+        } else if (sc >= 400) {
+            ESP_LOGW(TAG, "Client error %d — dropping batch of %d", sc, n);
+            sq_commit_n(sk->id, n);
+        } else {
+            // unexpected → be conservative
+            sq_abort(sk->id);
+            break;
+        }
+    }
+#else
+    reading_t r;
+
+    //while loop for if healthy, flush queued samples to server
+    // peek/commit: a failed send leaves the sample at the head of the queue
+    while (sq_peek(sk->id, &r)) {
+        int64_t tr = esp_timer_get_time();
+        sk->inflight = 1;
+        int sc = http_post_reading(sk, s_device_id, r.t_c, r.sr, r.ch, r.ts_ms_utc);
+        sk->inflight = 0;
+        upl_note_request(sk, tr);
+        posts++;
+        if (sc == 200) {
+            note_ingest_ok(sk);
+            sent++;
+            sq_commit(sk->id);
+        } else if (sc == 429 || (sc == 503 && sk->http.hints.retry_after_s >= 0)) {
+            // server shedding load, not down: keep it queued and wait out Retry-After
+            sq_abort(sk->id);
+            if (sk->http.hints.retry_after_s < 0) upl_hold(sk, (int32_t)(HEALTH_PERIOD_US / 1000000LL));
+            break;
+        } else if (sc >= 500 || sc < 0) {
+            // server problem or transport error → keep it queued and stop for now
+            sq_abort(sk->id);
+            upl_note_failure(sk, sc);
+            break;
+        } else if (sc == 401 || sc == 403) {
+            ESP_LOGE(TAG, "Forbidden (API key?) — dropping sample and keeping alert active");
+            // drop this sample; optionally set a sticky flag to blink LED faster
+            sq_commit(sk->id);
+        } else if (sc >= 400) {
+            ESP_LOGW(TAG, "Client error %d — dropping bad sample", sc);
+            // drop this sample (don’t requeue)
+            sq_commit(sk->id);
+        } else {
+            // unexpected → be conservative
+            sq_abort(sk->id);
+            break;
+        }
+    }
+#endif
+    // flush timing, for comparing INGEST_BATCH_MAX settings against the same server
+    if (sent) ESP_LOGI(TAG, "Flushed %d queued reading(s) to sink %d in %d POST(s), %lld ms",
+                       sent, sk->id, posts, (long long)((esp_timer_get_time() - t0) / 1000));
+}
+
+// Uploader, one per sink (arg = its sink_t): owns the sink's HTTP session,
+// so every blocking request (up to 10 s per POST, 8 s per health GET) runs
+// here and never stalls task_net or the other sinks
+static void task_upl(void *arg){
+    sink_t *sk = (sink_t *)arg;
+    for(;;){
+        uint32_t req = 0;
+        // also wake on our own: while the current endpoint's breaker is open,
+        // when its (jittered) backoff expires, so the half-open trial isn't
+        // quantized to the 60 s health timer that every device shares; and
+        // when another endpoint's decayed score makes it due a re-probe
+        TickType_t wait = portMAX_DELAY;
+        int64_t now0 = esp_timer_get_time();
+        int64_t wake_us = ep_probe_in_us(sk->id, sk->ep, now0);
+        int64_t retry_us = ep_retry_in_us(sk->ep, now0);
+        if (!sk->ok && retry_us > 0 && (wake_us < 0 || retry_us < wake_us)) wake_us = retry_us;
+        if (wake_us >= 0) wait = pdMS_TO_TICKS(wake_us / 1000 + 1000);  // +1 s: never spin
+        if (xTaskNotifyWait(0, UINT32_MAX, &req, wait) != pdTRUE) req = UPL_WAKE;
+        if (req & UPL_WAKE) {
+            if (!sk->ok) req |= UPL_HEALTH;   // may be the half-open trial; health re-probes too
+            else ep_refresh(sk);
+        }
+        upl_stream_sync(sk);   // follows endpoint switches made by ep_refresh
+
+        if (req & UPL_HEALTH) {
+            sk->http.stats_due = true;
+            // a 2xx ingest within the last period already proved the server is up
+            bool ok;
+            int64_t now = esp_timer_get_time();
+            if (sk->ok && sk->last_ok_us && now - sk->last_ok_us < upl_health_window_us(sk)) {
+                ok = true;
+                sk->health_skipped++;
+            } else if (!ep_ready(sk->ep, now)) {
+                ok = false;              // breaker open: no request, no radio
+                sk->health_deferred++;
+            } else {
+                ok = https_health_check(sk);
+                sk->health_probes++;
+            }
+            ep_refresh(sk);
+            sk->ok = ok;
+            ep_log_stats(sk->id, sk->ep);
+            http_session_log_stats(sk);
+            mqtt_up_log_stats(sk->id);
+            ws_up_log_stats(sk->id);
+            coap_up_log_stats(sk->id);
+            if (sk->id == 0) {
+                // shared by all sinks, log them once
+                spool_log_stats();
+                dns_cache_log_stats();
+                for (int ch = 0; ch < TC_N; ++ch) max31856_log_stats(s_tc[ch]);
+                max31856_log_sweep_stats();
+            }
+            upl_log_stats(sk);
+            // let task_net act on the verdict right away (it requests the flush)
+            if (s_task_net) xTaskNotifyGive(s_task_net);
+        }
+        int64_t now = esp_timer_get_time();
+        if ((req & UPL_FLUSH) && sk->ok && upl_due(sk, now) && ep_ready(sk->ep, now)) {
+            // timer ticks land on either side of the cadence: due a little early
+            sk->next_flush_us = now + upl_period_us(sk) * 7 / 8;
+            upl_flush(sk);
+            ep_reselect(sk);   // the flush just fed the scores
+        }
+    }
+}
+
+// health bookkeeping, alert LED; network work is handed to task_upl
 // wakes always from health timer, and sample timer when healthy
 static void task_net(void *arg){
 
     int64_t last_health_us = 0;
+    bool was_ok = any_sink_ok();
 
     for(;;){
-        // wait for “software interrupt” from health timer (or sample timer when healthy)
+        // wait for “software interrupt” from health timer (or sample timer when healthy,
+        // or the uploader reporting a health result)
         ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
-        // 1) periodic health check (max once per HEALTH_PERIOD_US)
+        // 1) periodic liveness refresh (max once per HEALTH_PERIOD_US); the uploader
+        //    only sends /health when no ingest succeeded recently or while unhealthy
         int64_t now = esp_timer_get_time();
-        bool ok = s_server_ok;  // default to current view
         //health check every 60s
         if (now - last_health_us >= HEALTH_PERIOD_US) {
-            ok = https_health_check();
+            upl_request(UPL_HEALTH);
             last_health_us = now;
-            maybe_prefer_local_again();
         }
 
-        if (ok && !s_server_ok) {
+        bool ok = any_sink_ok();  // latest verdicts from the uploaders
+        if (ok && !was_ok) {
             ESP_LOGI(TAG, "Server healthy; clearing alert");
             s_alert_active = false;
             update_alert_led(false);
         }
-        s_server_ok = ok;
-
-        // 2) If healthy, flush any queued samples
-        if (s_server_ok){
-            reading_t r;
-            int sent = 0;
-
-            //while loop for if healthy, flush queued samples to server
-            while (rb_pop(&r)) {
-                int sc = http_post_reading(s_device_id, r.t_c, r.sr, r.ts_ms_utc);
-                if (sc == 200) {
-                    s_last_ingest_ok_us = esp_timer_get_time();
-                    sent++;
-                } else if (sc >= 500 || sc < 0) {
-                    // server problem or transport error → requeue and stop for now
-                    rb_push(r);
-                    break;
-                } else if (sc == 401 || sc == 403) {
-                    ESP_LOGE(TAG, "Forbidden (API key?) — dropping sample and keeping alert active");
-                    // drop this sample; optionally set a sticky flag to blink LED faster
-                } else if (sc >= 400) {
-                    ESP_LOGW(TAG, "Client error %d — dropping bad sample", sc);
-                    // drop this sample (don’t requeue)
-                } else {
-                    // unexpected → be conservative
-                    rb_push(r);
-                    break;
-                }
-            }
-            if (sent) ESP_LOGI(TAG, "Flushed %d queued reading(s)", sent);
-        }
+        was_ok = ok;
+
+        // 2) If healthy, have the healthy sinks' uploaders flush their backlog
+        if (ok) upl_request(UPL_FLUSH);
 
         // 3) Alert if no successful ingest for too long
         now = esp_timer_get_time();
-        if (s_last_ingest_ok_us == 0) s_last_ingest_ok_us = now; // baseline at boot
-        // Alert if no successful ingest for 2 minutes
-        bool overdue = (now - s_last_ingest_ok_us) > ALERT_WINDOW_US;
+        // Alert if no successful ingest for 2 minutes (longer if servers slowed every sink down)
+        bool overdue = (now - last_ingest_ok(now)) > alert_window_us();
         if (overdue && !s_alert_active){
             s_alert_active = true;
             update_alert_led(true);
             ESP_LOGW(TAG, "ALERT: No successful ingest for > %d min",
-                (int)(ALERT_WINDOW_US/60000000LL));    
+                (int)(alert_window_us()/60000000LL));    
         }
         if (!overdue && s_alert_active){
             s_alert_active = false;
@@ -298,23 +977,33 @@ static void task_net(void *arg){
     }
 }
 
-static void maybe_prefer_local_again(void) {
-    static int counter = 0;
-    // every 5 health cycles (5 minutes)
-    if (++counter % 5) return;
-
-    // on cloud, check if local sever is available
-    if (strcmp(s_base_url, URL_LOCAL) != 0) {
+static void use_endpoint(sink_t *sk, int ep) {
+    if (ep != sk->ep) upl_clear_hints(sk);   // the new server hasn't asked for anything
+    strncpy(sk->base, ep_base(ep), sizeof(sk->base)-1);
+    sk->tls = ep_tls(ep);
+    sk->ep = ep;
+}
 
-        // if local is reachable switch back to local
-        if (try_health_once(URL_LOCAL, false)) {
-            strncpy(s_base_url, URL_LOCAL, sizeof(s_base_url)-1);
-            s_use_tls = false;
-            ESP_LOGI(TAG, "Re-selected BASE=LOCAL: %s", s_base_url);
-        }
+// Moves the sink to its best-scored endpoint; runs after every flush, so a
+// slowing server is left as soon as its scores say so
+static void ep_reselect(sink_t *sk) {
+    int best = ep_best(sk->id, sk->ep);
+    if (best >= 0 && best != sk->ep) {
+        use_endpoint(sk, best);
+        ESP_LOGI(TAG, "Sink %d re-selected BASE=ep%d: %s", sk->id, best, sk->base);
     }
 }
 
+// Probes at most one idle endpoint that ep_next_probe says is due (its
+// decayed score could beat the current one), then re-selects. Runs each
+// health cycle and whenever the uploader's re-probe wake-up fires.
+static void ep_refresh(sink_t *sk) {
+    int64_t now = esp_timer_get_time();
+    int probe = ep_next_probe(sk->id, sk->ep, now);
+    if (probe >= 0 && ep_allow(probe, now)) try_health_once(probe, 8000);
+    ep_reselect(sk);
+}
+
 
 
 // -------------------- Helpers --------------------
@@ -328,118 +1017,409 @@ static void sntp_sync(void) {
     }
 }
 
-static bool https_health_check(void) {
-    return try_health_once(s_base_url, s_use_tls);
+// A base "scheme://host[:port]" with its hostname swapped for the DNS cache's
+// address, so (re)connects skip the lookup. The hostname is still sent as the
+// Host header and used as the TLS server name (SNI and certificate check).
+typedef struct {
+    char url[160];         // base to connect to
+    char host[96];         // hostname, "" if the base was used as-is
+    char authority[104];   // "host[:port]" for the Host header
+} resolved_base_t;
+
+static void resolve_base(const char *base, resolved_base_t *rb) {
+    snprintf(rb->url, sizeof(rb->url), "%s", base);
+    rb->host[0] = rb->authority[0] = 0;
+
+    const char *h = strstr(base, "://");
+    if (!h) return;
+    h += 3;
+    size_t hl = strcspn(h, ":/");
+    size_t al = strcspn(h, "/");
+    if (hl == 0 || hl >= sizeof(rb->host) || al >= sizeof(rb->authority)) return;
+
+    char host[96], ip[16];
+    memcpy(host, h, hl);
+    host[hl] = 0;
+    if (!dns_cache_lookup(host, ip, sizeof(ip)) || strcmp(ip, host) == 0) return;  // IP literal or unresolvable
+
+    snprintf(rb->url, sizeof(rb->url), "%.*s%s%s", (int)(h - base), base, ip, h + hl);
+    memcpy(rb->host, host, hl + 1);
+    memcpy(rb->authority, h, al);
+    rb->authority[al] = 0;
+}
+
+static esp_err_t http_evt(esp_http_client_event_t *evt) {
+    http_session_t *sess = (http_session_t *)evt->user_data;
+    if (!sess) return ESP_OK;
+    if (evt->event_id == HTTP_EVENT_ON_CONNECTED) {
+        // TCP connect + TLS handshake (full or resumed) for this request
+        int64_t dt = esp_timer_get_time() - sess->req_start_us;
+        sess->connects++;
+        sess->connect_us_total += dt;
+        if (dt > sess->connect_us_max) sess->connect_us_max = dt;
+        ESP_LOGI(TAG, "Connected to %s in %lld ms", sess->base, (long long)(dt / 1000));
+    } else if (evt->event_id == HTTP_EVENT_ON_HEADER) {
+        srv_hints_header(&sess->hints, evt->header_key, evt->header_value);
+    } else if (evt->event_id == HTTP_EVENT_ON_DATA) {
+        http_resp_t *resp = &sess->resp;
+        int room = (int)sizeof(resp->buf) - 1 - resp->len;
+        int n = evt->data_len < room ? evt->data_len : room;
+        if (n > 0) {
+            memcpy(resp->buf + resp->len, evt->data, n);
+            resp->len += n;
+            resp->buf[resp->len] = 0;
+        }
+    }
+    return ESP_OK;
+}
+
+// Drops the connection but keeps the client, so the next request reconnects
+// with the saved TLS session (abbreviated handshake) instead of a full one
+static void http_session_close(http_session_t *hs) {
+    if (!hs->h) return;
+    esp_http_client_close(hs->h);
+    hs->resets++;
+}
+
+static void http_session_destroy(http_session_t *hs) {
+    if (!hs->h) return;
+    esp_http_client_cleanup(hs->h);
+    hs->h = NULL;
+    hs->resets++;
+}
+
+// (Re)opens the sink's session if there is none or its base has changed
+static esp_http_client_handle_t http_session_get(sink_t *sk) {
+    http_session_t *hs = &sk->http;
+    if (hs->h && hs->tls == sk->tls && strcmp(hs->base, sk->base) == 0) return hs->h;
+    http_session_destroy(hs);
+
+    resolved_base_t rb;
+    resolve_base(sk->base, &rb);
+    // the TLS layer keeps a pointer to common_name, so it lives in the session
+    strncpy(hs->host, rb.host, sizeof(hs->host)-1);
+    char url[200];
+    snprintf(url, sizeof(url), "%s/health", rb.url);
+
+    esp_http_client_config_t cfg = {
+        .url = url,
+        .transport_type = sk->tls ? HTTP_TRANSPORT_OVER_SSL : HTTP_TRANSPORT_OVER_TCP,
+
+        // Transport Layer Security is enabled, it attaches the esp_crt_bundle_attach cert bundle
+        // we use esp_crt_bundle_attach so that we dont get our own privacy-enhanced mail (PEM) cert
+        .crt_bundle_attach = sk->tls ? esp_crt_bundle_attach : NULL,
+        // connecting by address: verify the certificate (and send SNI) for the hostname
+        .common_name = (sk->tls && hs->host[0]) ? hs->host : NULL,
+        .timeout_ms = 10000,
+        .keep_alive_enable = true,
+        .event_handler = http_evt,
+        .user_data = hs,
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        // keep the server's session ticket so reconnects resume the TLS session
+        .save_client_session = sk->tls,
+#endif
+    };
+    hs->h = esp_http_client_init(&cfg);
+    if (!hs->h) { ESP_LOGW(TAG, "http session init failed"); return NULL; }
+
+    strncpy(hs->base, sk->base, sizeof(hs->base)-1);
+    hs->tls = sk->tls;
+#if ENABLE_HTTP_POST
+    // X-API-KEY stays on the client for every request
+    esp_http_client_set_header(hs->h, "X-API-Key", API_KEY);
+#endif
+    return hs->h;
+}
+
+// How an HTTP answer scores its endpoint (ep_report / ep_release). 429 and
+// 503 + Retry-After are a server shedding load: neither a success nor a
+// breaker failure. So is a /health 503 (server up, its upstream failing),
+// which the health checks still count as reachable. Any other 5xx fails,
+// and so does a /health answer other than 200 (not our server).
+typedef enum { HTTP_SCORE_OK, HTTP_SCORE_NEUTRAL, HTTP_SCORE_FAIL } http_score_t;
+
+static http_score_t http_score(int status, const srv_hints_t *h, bool health) {
+    bool retry_after = h && h->retry_after_s >= 0;
+    if (status == 429 || (status == 503 && (health || retry_after))) return HTTP_SCORE_NEUTRAL;
+    if (health) return status == 200 ? HTTP_SCORE_OK : HTTP_SCORE_FAIL;
+    return status < 500 ? HTTP_SCORE_OK : HTTP_SCORE_FAIL;
+}
+
+static void ep_score(int ep, http_score_t score, int64_t rtt_us) {
+    if (score == HTTP_SCORE_NEUTRAL) ep_release(ep);   // hands a half-open trial back, score untouched
+    else ep_report(ep, score == HTTP_SCORE_OK, rtt_us);
+}
+
+// One request on the sink's session: BASE<path>, body NULL for GET.
+// Returns the HTTP status, or -1 on transport error (the connection is then
+// closed so the next request reconnects).
+static int http_session_request(sink_t *sk, esp_http_client_method_t method, const char *path,
+                                const char *ctype, const char *body, int n, int timeout_ms) {
+    http_session_t *hs = &sk->http;
+    esp_http_client_handle_t h = http_session_get(sk);
+    if (!h) return -1;
+
+    // cache hit in the steady state; a new address (TTL expired, server moved)
+    // makes set_url drop the old connection
+    resolved_base_t rb;
+    resolve_base(sk->base, &rb);
+    if (strcmp(rb.host, hs->host) != 0) {
+        // resolvability changed since the client was opened: reopen with the right TLS name
+        http_session_destroy(hs);
+        if (!(h = http_session_get(sk))) return -1;
+    }
+    char url[200];
+    snprintf(url, sizeof(url), "%s%s", rb.url, path);
+    esp_http_client_set_url(h, url);
+    if (rb.host[0]) esp_http_client_set_header(h, "Host", rb.authority);
+    esp_http_client_set_method(h, method);
+    esp_http_client_set_timeout_ms(h, timeout_ms);
+    if (body) esp_http_client_set_header(h, "Content-Type", ctype);
+    // resolver counters ride along once per health cycle (the /health GET, or
+    // the first ingest when a recent one made the GET unnecessary)
+    if (hs->stats_due) {
+        char dns[96];
+        dns_cache_format_stats(dns, sizeof(dns));
+        esp_http_client_set_header(h, "X-DNS-Stats", dns);
+    } else {
+        esp_http_client_delete_header(h, "X-DNS-Stats");
+    }
+    // NULL clears the previous body and its Content-Type
+    esp_http_client_set_post_field(h, body, body ? n : 0);
+
+    hs->resp.len = 0;
+    hs->resp.buf[0] = 0;
+    srv_hints_clear(&hs->hints);
+    hs->req_start_us = esp_timer_get_time();
+    // the breaker (half-open trial) is taken only now; both exits below report
+    if (!ep_allow(sk->ep, hs->req_start_us)) return -1;
+    hs->requests++;
+
+    const char *verb = (method == HTTP_METHOD_POST) ? "POST" : "GET";
+    esp_err_t err = esp_http_client_perform(h);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "HTTP %s %s failed (%s): %s, errno=%d",
+                 verb, path, sk->base, esp_err_to_name(err), esp_http_client_get_errno(h));
+        ep_report(sk->ep, false, 0);
+        http_session_close(hs);
+        if (hs->host[0]) dns_cache_expire(hs->host);  // re-resolve before the next attempt
+        return -1;
+    }
+    int status = esp_http_client_get_status_code(h);
+    hs->stats_due = false;   // delivered
+    // every session request scores the current endpoint (http_score); the
+    // body's hints first, a Retry-After there makes a 503 neutral too
+    srv_hints_body(&hs->hints, hs->resp.buf);
+    ep_score(sk->ep, http_score(status, &hs->hints, strcmp(path, "/health") == 0),
+             esp_timer_get_time() - hs->req_start_us);
+    ESP_LOGI(TAG, "%s %s -> %d (%s)", verb, path, status, sk->base);
+    if (srv_hints_any(&hs->hints)) upl_apply_hints(sk, &hs->hints);
+    if (status != 200 && hs->resp.len > 0) ESP_LOGW(TAG, "resp: %s", hs->resp.buf);
+    return status;
+}
+
+static void http_session_log_stats(sink_t *sk) {
+    const http_session_t *hs = &sk->http;
+    uint32_t reused = hs->requests > hs->connects ? hs->requests - hs->connects : 0;
+    int64_t avg_ms = hs->connects ? hs->connect_us_total / hs->connects / 1000 : 0;
+    ESP_LOGI(TAG, "http session %d: %u request(s), %u connect(s), %u reused, %u reset(s), connect avg %lld ms max %lld ms",
+             sk->id, (unsigned)hs->requests, (unsigned)hs->connects, (unsigned)reused, (unsigned)hs->resets,
+             (long long)avg_ms, (long long)(hs->connect_us_max / 1000));
+}
+
+// sustained append/drain cost of the flash spool
+static void spool_log_stats(void) {
+    spool_stats_t st;
+    spool_get_stats(&st);
+    if (!st.appended && !st.drained && !st.pending) return;
+    ESP_LOGI(TAG, "spool: %u/%u pending, appended %u (avg %lld us), drained %u (avg %lld us), dropped %u, erases %u",
+             (unsigned)st.pending, (unsigned)st.capacity,
+             (unsigned)st.appended, (long long)(st.appended ? st.append_us / st.appended : 0),
+             (unsigned)st.drained,  (long long)(st.drained ? st.drain_us / st.drained : 0),
+             (unsigned)st.dropped, (unsigned)st.erases);
+}
+
+static bool https_health_check(sink_t *sk) {
+    ep_proto_t proto = ep_proto(sk->ep);
+    if (proto != EP_HTTP && !ep_allow(sk->ep, esp_timer_get_time())) return false;
+    if (proto == EP_COAP) {
+        // CoAP ping: an empty CON the server answers with RST
+        bool ok = coap_up_ping(sk->id, 8000);
+        ep_report(sk->ep, ok, coap_up_rtt_us(sk->id));
+        return ok;
+    }
+    if (proto != EP_HTTP) {
+        // a streaming session's keepalive pings are the liveness check; a new one gets time to connect
+        bool mq = proto == EP_MQTT;
+        bool ok = mq ? mqtt_up_connected(sk->id, 8000) : ws_up_connected(sk->id, 8000);
+        ep_report(sk->ep, ok, mq ? mqtt_up_rtt_us(sk->id) : ws_up_rtt_us(sk->id));
+        return ok;
+    }
+    int sc = http_session_request(sk, HTTP_METHOD_GET, "/health", NULL, NULL, 0, 8000);
+    // 200, or a neutral answer (503: server up, upstream failure; 429) count as reachable
+    return sc > 0 && http_score(sc, &sk->http.hints, true) != HTTP_SCORE_FAIL;
 }
 
-static bool try_health_once(const char *base, bool tls){
+// One-shot /health probe of endpoint ep (not the shared session); feeds its score
+static bool try_health_once(int ep, int timeout_ms){
+    const char *base = ep_base(ep);
+    bool tls = ep_tls(ep);
+    if (ep_proto(ep) == EP_MQTT) {
+        // brokers have no /health: a TCP connect to the broker port stands in
+        int64_t dt = mqtt_up_probe(base, timeout_ms);
+        if (dt >= 0) ESP_LOGI(TAG, "broker %s reachable in %lld ms", base, (long long)(dt / 1000));
+        ep_report(ep, dt >= 0, dt);
+        return dt >= 0;
+    }
+    if (ep_proto(ep) == EP_COAP) {
+        int64_t dt = coap_up_probe(base, timeout_ms);
+        if (dt >= 0) ESP_LOGI(TAG, "CoAP ping %s answered in %lld ms", base, (long long)(dt / 1000));
+        ep_report(ep, dt >= 0, dt);
+        return dt >= 0;
+    }
+    char http_base[128];
+    if (ep_proto(ep) == EP_WS) {
+        // the WebSocket server answers /health over HTTP(S) on the same host: ws[s]:// → http[s]://
+        snprintf(http_base, sizeof(http_base), "http%s", base + 2);
+        base = http_base;
+    }
+    resolved_base_t rb;
+    resolve_base(base, &rb);
     char url[200];
-    snprintf(url, sizeof(url), "%s/health", base);
+    snprintf(url, sizeof(url), "%s/health", rb.url);
 
     esp_http_client_config_t hc = {
         .url = url,
         .transport_type = tls ? HTTP_TRANSPORT_OVER_SSL : HTTP_TRANSPORT_OVER_TCP,
         .crt_bundle_attach = tls ? esp_crt_bundle_attach : NULL,
-        .timeout_ms = 8000,
+        .common_name = (tls && rb.host[0]) ? rb.host : NULL,
+        .timeout_ms = timeout_ms,
         .keep_alive_enable = false,
     };
     esp_http_client_handle_t h = esp_http_client_init(&hc);
-    if (!h) { ESP_LOGW(TAG, "health(init) failed"); return false; }
+    if (!h) { ESP_LOGW(TAG, "health(init) failed"); ep_release(ep); return false; }
+    if (rb.host[0]) esp_http_client_set_header(h, "Host", rb.authority);
 
     bool ok = false;
+    http_score_t score = HTTP_SCORE_FAIL;
+    int64_t t0 = esp_timer_get_time();
     esp_err_t err = esp_http_client_perform(h);
     if (err == ESP_OK) {
         int sc = esp_http_client_get_status_code(h);
         ESP_LOGI(TAG, "GET /health -> %d (%s)", sc, base);
-        // check if health is 200 (server connection success) or 503 (server connection failure)
-        // we keep trying even if failure
-        ok = (sc == 200 || sc == 503);
+        // scored as the session's /health is (http_score): 200 succeeds, 503
+        // (server up, upstream failure) and 429 are neutral but reachable,
+        // so we keep trying that base
+        score = http_score(sc, NULL, true);
+        ok = score != HTTP_SCORE_FAIL;
     } else {
         ESP_LOGW(TAG, "GET /health failed (%s): %s (errno=%d)",
                  base, esp_err_to_name(err), esp_http_client_get_errno(h));
+        if (rb.host[0]) dns_cache_expire(rb.host);
     }
+    ep_score(ep, score, esp_timer_get_time() - t0);
     esp_http_client_cleanup(h);
     return ok;
 }
 
-static void pick_base_url(void){
-    // Try LOCAL server first
-    if (try_health_once(URL_LOCAL, /*tls=*/false)) {
-        strncpy(s_base_url, URL_LOCAL, sizeof(s_base_url)-1);
-        s_use_tls = false;
-        ESP_LOGI(TAG, "Selected BASE=LOCAL: %s", s_base_url);
-        return;
-    }
-    // Fallback to CLOUD server with Transport Layer Security (Refer to 7 layers of OSI Model)
-    if (try_health_once(URL_CLOUD, /*tls=*/true)) {
-        strncpy(s_base_url, URL_CLOUD, sizeof(s_base_url)-1);
-        s_use_tls = true;
-        ESP_LOGI(TAG, "Selected BASE=CLOUD: %s", s_base_url);
-        return;
-    }
-    // if neither reachable, try cloud anyways
-    if (!s_base_url[0]) {
-        strncpy(s_base_url, URL_CLOUD, sizeof(s_base_url)-1);
-        s_use_tls = true;
-        ESP_LOGW(TAG, "No server reachable; defaulting BASE=%s", s_base_url);
+// Boot-time base selection, per sink: every endpoint probed in parallel (ep_pick.c).
+// Returns true if at least one sink's selected base answered its health probe
+static bool pick_endpoints(void){
+    int winner[SQ_SINKS];
+    int64_t dt_ms = ep_pick(try_health_once, s_sink_n, winner) / 1000;
+    bool any = false;
+    for (int k = 0; k < s_sink_n; ++k) {
+        sink_t *sk = &s_sink[k];
+        if (winner[k] >= 0) {
+            use_endpoint(sk, winner[k]);
+            sk->ok = any = true;
+            ESP_LOGI(TAG, "Sink %d selected BASE=ep%d: %s in %lld ms", k, sk->ep, sk->base, (long long)dt_ms);
+        } else {
+            // if none reachable, take the best-scored one anyways (the probes' errors are already counted)
+            use_endpoint(sk, ep_best(k, -1));
+            sk->ok = false;
+            ESP_LOGW(TAG, "Sink %d: no server reachable after %lld ms; defaulting BASE=%s",
+                     k, (long long)dt_ms, sk->base);
+        }
     }
+    return any;
 }
 
 
 
 #if ENABLE_HTTP_POST
-// method building JSON and posts to BASE/ingest
+// POSTs a prepared JSON body to BASE<path> over the sink's session
 // sets headers: content type -> applications and JSON
-// X-API-KEY
-static int http_post_reading(const char *device_id, float temp_c, uint8_t sr, int64_t ts_ms) {
+static int http_post_json(sink_t *sk, const char *path, const char *body, int n) {
+    return http_session_request(sk, HTTP_METHOD_POST, path, "application/json", body, n, 10000);
+}
+
+// method building JSON and posts to BASE/ingest
+static int http_post_reading(sink_t *sk, const char *device_id, float temp_c, uint8_t sr, uint8_t ch, int64_t ts_ms) {
     // character buffer to build JSON
     char body[256];
     // writes measurement logs into buffer
     int n = snprintf(body, sizeof(body),
-                     "{\"device_id\":\"%s\",\"temp_c\":%.2f,\"sr\":%u,\"ts_ms\":%lld}",
-                     device_id, temp_c, (unsigned)sr, (long long)ts_ms);
+                     "{\"device_id\":\"%s\",\"temp_c\":%.2f,\"sr\":%u,\"ch\":%u,\"ts_ms\":%lld}",
+                     device_id, temp_c, (unsigned)sr, (unsigned)ch, (long long)ts_ms);
     if (n < 0 || n >= (int)sizeof(body)) return -1;
 
-    char url[200];
-    // writes ingest message
-    snprintf(url, sizeof(url), "%s/ingest", s_base_url);
+    return http_post_json(sk, "/ingest", body, n);
+}
 
-    //setting http client config
-    esp_http_client_config_t cfg = {
-        .url = url,
-        .method = HTTP_METHOD_POST,
-        .transport_type = s_use_tls ? HTTP_TRANSPORT_OVER_SSL : HTTP_TRANSPORT_OVER_TCP,
-        
-        // Transport Layer Security is enabled, it attaches the esp_crt_bundle_attach cert bundle
-        // we use esp_crt_bundle_attach so that we dont get our own privacy-enhanced mail (PEM) cert
-        .crt_bundle_attach = s_use_tls ? esp_crt_bundle_attach : NULL,
-        .timeout_ms = 10000,
-        .keep_alive_enable = true,
-    };
-    
-    int status = -1;
-    esp_http_client_handle_t client = esp_http_client_init(&cfg);
-    if (!client) return -1;
+// Encodes n readings as one body (INGEST_FORMAT) and posts it to
+// BASE/ingest/batch (JSON) or BASE/ingest/bin (binary and delta).
+// The server answers 200 when every reading was stored, or 207 with
+// {"accepted":k} when only the first k were. *accepted is set from that.
+// A single JSON reading (the steady state) goes through the plain /ingest path.
+static int http_post_batch(sink_t *sk, const char *device_id, const reading_t *rs, int n, int *accepted) {
+    *accepted = 0;
+    int64_t t0 = esp_timer_get_time();
+    int status;
+
+#if INGEST_FORMAT == INGEST_FMT_BIN
+    // static to keep it off t_upl's stack, one per sink
+    static uint8_t bodies[SQ_SINKS][INGEST_BIN_MAX(INGEST_BATCH_MAX)];
+    uint8_t *body = bodies[sk->id];
+    int len = ingest_enc_bin(body, sizeof(bodies[0]), device_id, rs, n);
+    if (len < 0) return -1;
+    ESP_LOGI(TAG, "Encoded %d reading(s): %d B binary in %lld us",
+             n, len, (long long)(esp_timer_get_time() - t0));
+    status = http_session_request(sk, HTTP_METHOD_POST, "/ingest/bin", "application/octet-stream",
+                                  (const char *)body, len, 10000);
+#elif INGEST_FORMAT == INGEST_FMT_DELTA
+    static uint8_t bodies[SQ_SINKS][INGEST_DELTA_MAX(INGEST_BATCH_MAX)];
+    uint8_t *body = bodies[sk->id];
+    int len = ingest_enc_delta(body, sizeof(bodies[0]), device_id, rs, n, s_period_ms);
+    if (len < 0) return -1;
+    ESP_LOGI(TAG, "Encoded %d reading(s): %d B delta in %lld us",
+             n, len, (long long)(esp_timer_get_time() - t0));
+    status = http_session_request(sk, HTTP_METHOD_POST, "/ingest/bin", "application/octet-stream",
+                                  (const char *)body, len, 10000);
+#else
+    if (n == 1) {
+        status = http_post_reading(sk, device_id, rs[0].t_c, rs[0].sr, rs[0].ch, rs[0].ts_ms_utc);
+        if (status == 200) *accepted = 1;
+        return status;
+    }
 
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_header(client, "X-API-Key",    API_KEY);
-    esp_http_client_set_post_field(client, body, n);
+    static char bodies[SQ_SINKS][INGEST_JSON_MAX(INGEST_BATCH_MAX)];
+    char *body = bodies[sk->id];
+    int len = ingest_enc_json(body, sizeof(bodies[0]), device_id, rs, n);
+    if (len < 0) return -1;
+    ESP_LOGI(TAG, "Encoded %d reading(s): %d B JSON in %lld us",
+             n, len, (long long)(esp_timer_get_time() - t0));
+    status = http_post_json(sk, "/ingest/batch", body, len);
+#endif
 
-    esp_err_t err = esp_http_client_perform(client);
-    if (err == ESP_OK) {
-        status = esp_http_client_get_status_code(client);
-        ESP_LOGI(TAG, "POST /ingest -> %d (%s)", status, s_base_url);
-        if (status != 200) {
-            char buf[160];
-            int rd = esp_http_client_read_response(client, buf, sizeof(buf)-1);
-            if (rd > 0) { buf[rd]=0; ESP_LOGW(TAG, "resp: %s", buf); }
-        }
-    } else {
-        ESP_LOGE(TAG, "HTTP POST failed (%s): %s, errno=%d",
-                 s_base_url, esp_err_to_name(err), esp_http_client_get_errno(client));
-        status = -1;
+    // partial ack: {"accepted":k}; without it 200 means all, 207 means none
+    const char *a = (status == 200 || status == 207) ? strstr(sk->http.resp.buf, "\"accepted\":") : NULL;
+    if (a) {
+        long k = strtol(a + 11, NULL, 10);
+        *accepted = k < 0 ? 0 : (k > n ? n : (int)k);
+    } else if (status == 200) {
+        *accepted = n;
     }
-    esp_http_client_cleanup(client);
     return status;
 }
 
@@ -473,24 +1453,29 @@ void app_main(void) {
     // Init Wi-Fi stack
     ESP_ERROR_CHECK(spi_bus_initialize(SPI2_HOST, &buscfg, SPI_DMA_DISABLED));
 
-    // Config device interface
-    spi_device_interface_config_t devcfg = {
-        .clock_speed_hz = 1 * 1000 * 1000, // 1 MHz
-        .mode = 1,                         // MAX31856 uses SPI mode 1
-        .spics_io_num = PIN_NUM_CS,
-        .queue_size = 1,
-    };
-
-    // Error check device handle
-    spi_device_handle_t dev;
-    ESP_ERROR_CHECK(spi_bus_add_device(SPI2_HOST, &devcfg, &dev));
+    // one MAX31856 per thermocouple channel, each on its own CS pin
+    for (int ch = 0; ch < TC_N; ++ch) {
+        ESP_ERROR_CHECK(max31856_add(SPI2_HOST, &TC_CHANNELS[ch], &s_tc[ch]));
+    }
     // configuring GPIO pin pull down
     gpio_set_pull_mode(PIN_NUM_MOSI, GPIO_PULLDOWN_ONLY);
-    ESP_LOGI(TAG, "SPI bus initialized");
+    ESP_LOGI(TAG, "SPI bus initialized, %d thermocouple channel(s)", TC_N);
 
-    // attach device and initialize max31856 interfaces
-    max31856_attach(dev);
-    max31856_init();
+    // initialize max31856 interfaces
+    for (int ch = 0; ch < TC_N; ++ch) max31856_init(s_tc[ch]);
+
+    // Ingest endpoints from NVS (or the built-in LOCAL/CLOUD pair); each sink gets every reading
+    ep_load(EP_DEFAULTS, sizeof(EP_DEFAULTS) / sizeof(EP_DEFAULTS[0]));
+    s_sink_n = ep_sinks();
+    for (int k = 0; k < s_sink_n; ++k) { s_sink[k].id = k; s_sink[k].ep = -1; }
+    sq_init(s_sink_n);
+
+    // Flash spool for outage backlog (survives reboots), one ack bit per sink
+    spool_init(s_sink_n);
+    // every channel queues a reading per tick
+    ESP_LOGI(TAG, "Sample queue: %d x %d B = %d B RAM, %d min of backlog at %d s cadence, %d channel(s)",
+             SQ_CAP, SQ_REC_SIZE, SQ_CAP * SQ_REC_SIZE,
+             (int)((int64_t)SQ_CAP * POST_PERIOD_MS / 60000 / TC_N), POST_PERIOD_MS / 1000, TC_N);
 
     // Wi-Fi initialize call
     wifi_netif_init_once();
@@ -525,15 +1510,15 @@ void app_main(void) {
 
     sntp_sync();
 
-    // Pick LOCAL, else CLOUD -> this also checks both /health once
-    pick_base_url();
-    s_server_ok = try_health_once(s_base_url, s_use_tls);
+    // Probe all endpoints in parallel; each sink's preferred healthy one wins, and the probe doubles as the first health check
+    pick_endpoints();
 
     // Device ID
     char device_id[32] = {0};
     get_device_id(device_id, sizeof(device_id));
     ESP_LOGI(TAG, "Device ID: %s", device_id);
     strncpy(s_device_id, device_id, sizeof(s_device_id)-1);
+    snprintf(s_mqtt_topic, sizeof(s_mqtt_topic), MQTT_TOPIC_FMT, device_id);
 
     // Re-tune the already-initialized Task Watch dog timer (ESP-IDF auto-starts it)
     const esp_task_wdt_config_t twdt_cfg = {
@@ -561,7 +1546,13 @@ void app_main(void) {
 
     // Create tasks
     xTaskCreatePinnedToCore(task_sensor, "t_sensor", 4096, NULL, 8, &s_task_sensor, 1);
-    xTaskCreatePinnedToCore(task_net,    "t_net",    6144, NULL, 8, &s_task_net,    1);
+    xTaskCreatePinnedToCore(task_net,    "t_net",    4096, NULL, 8, &s_task_net,    1);
+    // uploaders below sensor/net so bookkeeping preempts them while they wait on the network
+    for (int k = 0; k < s_sink_n; ++k) {
+        char name[12];
+        snprintf(name, sizeof(name), "t_upl%d", k);
+        xTaskCreatePinnedToCore(task_upl, name, 6144, &s_sink[k], 7, &s_sink[k].task, 1);
+    }
 
     // Create periodic timers (software “interrupts”)
     const esp_timer_create_args_t t_sample_args = {
@@ -572,7 +1563,7 @@ void app_main(void) {
     // we use 1000ULL because our constants are in ms, so what we want is micro seconds and ULL ensures 64 bit math
     // 64 bit math because we don't want overflows.
     ESP_ERROR_CHECK( esp_timer_create(&t_sample_args, &s_timer_sample) );
-    ESP_ERROR_CHECK( esp_timer_start_periodic(s_timer_sample, (uint64_t)POST_PERIOD_MS * 1000ULL) );
+    ESP_ERROR_CHECK( esp_timer_start_periodic(s_timer_sample, (uint64_t)s_period_ms * 1000ULL) );
 
     // health timer configuration
     const esp_timer_create_args_t t_health_args = {
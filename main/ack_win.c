@@ -0,0 +1,212 @@
+//ack_win.c
+//In-flight message window for the acked uplinks (MQTT, WebSocket, CoAP)
+/*
+An HTTP POST is stop-and-wait: the next batch leaves only after the previous
+response, so a backlog drains at one batch per round-trip. The other
+transports put up to `size` messages on the wire before the first ack
+returns.
+
+The window against the sample queue: sample_q only knows "peek from the
+sink's cursor" and "commit up to a mark". The window always holds the
+sink's oldest readings, in send order. A refill peeks (in flight + one
+batch) and sends only the part beyond what is already in flight, keeping
+the mark just past it; each ack at the front of the window commits up to
+that message's mark. An ack for a later message is remembered until the
+ones before it are acked. The mark carries the spool sequence numbers of
+what was sent, so if the spool recycled a sector under the window (ring
+full) nothing is acked that never left: the refill sees the queue no
+longer starts with what is in flight and forgets the window.
+
+Lost acks: with a retransmit hook (CoAP), an unacked front message is sent
+again after timeout_us, 2x, 4x ... up to max_retries times, as RFC 7252
+does for confirmable messages. Without one, or once the retries are used
+up, if the front message is not acked within the timeout of being sent (or
+of the last reconnect) the window is forgotten. Its readings are
+still at the head of the queue and are sent again, so delivery is
+at-least-once and the server may see a reading twice.
+
+A message the server has accepted but not yet answered (ack_win_held, a
+CoAP empty ACK) is never retransmitted: the server already has it, and
+RFC 7252 4.2 ends the retransmissions there. Only its response is waited
+for, held_timeout_us from the accept, then the window is forgotten as above.
+Events share one queue of ints: id > 0 acked, -id held, 0 link down.
+*/
+#include "ack_win.h"
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sample_q.h"
+
+static const char *TAG = "ack_win";
+
+bool ack_win_init(ack_win_t *w, int sink, int size, int batch, int timeout_ms, bool resends,
+                  ack_win_send_t send, void *ctx)
+{
+    if (!w->events) w->events = xQueueCreate(ACK_WIN_MAX * 2 + 2, sizeof(int));
+    if (!w->events) return false;
+    xQueueReset(w->events);
+    w->sink = sink;
+    w->size = size < 1 ? 1 : size > ACK_WIN_MAX ? ACK_WIN_MAX : size;
+    w->batch = batch < 1 ? 1 : batch > ACK_WIN_BATCH ? ACK_WIN_BATCH : batch;
+    w->timeout_us = (int64_t)timeout_ms * 1000LL;
+    w->resends = resends;
+    w->send = send;
+    w->retransmit = NULL;
+    w->max_retries = 0;
+    w->held_timeout_us = w->timeout_us;
+    w->ctx = ctx;
+    w->up = false;
+    ack_win_reset(w);
+    return true;
+}
+
+void ack_win_reset(ack_win_t *w)
+{
+    w->head = w->count = w->readings = 0;
+}
+
+// the two below run in the transport's task
+void ack_win_link(ack_win_t *w, bool up)
+{
+    int ev = 0;
+    if (up) {
+        w->up_us = esp_timer_get_time();
+        w->epoch++;
+    }
+    w->up = up;
+    if (!up) xQueueSend(w->events, &ev, 0);   // wake a flush waiting for acks
+}
+
+void ack_win_acked(ack_win_t *w, int id)
+{
+    if (id > 0) xQueueSend(w->events, &id, 0);   // full → that ack times out and the readings are resent
+}
+
+void ack_win_held(ack_win_t *w, int id)
+{
+    int ev = -id;
+    if (id > 0) xQueueSend(w->events, &ev, 0);   // full → retransmitted, the server answers it again
+}
+
+static void note_held(ack_win_t *w, int id)
+{
+    for (int i = 0; i < w->count; ++i) {
+        int k = (w->head + i) % ACK_WIN_MAX;
+        if (w->m[k].id != id || w->m[k].acked || w->m[k].held) continue;
+        w->m[k].held = true;
+        w->m[k].held_us = esp_timer_get_time();
+        return;
+    }
+}
+
+static void note_ack(ack_win_t *w, int id)
+{
+    for (int i = 0; i < w->count; ++i) {
+        int k = (w->head + i) % ACK_WIN_MAX;
+        if (w->m[k].id != id || w->m[k].acked) continue;
+        int64_t dt = esp_timer_get_time() - w->m[k].sent_us;
+        w->m[k].acked = true;
+        w->acked++;
+        w->ack_us_last = dt;
+        w->ack_us_total += dt;
+        if (dt > w->ack_us_max) w->ack_us_max = dt;
+        return;
+    }
+    // not in the window: a late ack after the window was forgotten
+}
+
+int ack_win_flush(ack_win_t *w, int *msgs)
+{
+    *msgs = 0;
+    int sent = 0;
+    if (!w->up) return -1;
+
+    for (;;) {
+        // sent on a connection that is gone and nobody resends it → send it again
+        if (!w->resends && w->count && w->m[w->head].epoch != w->epoch) ack_win_reset(w);
+
+        // refill: send the readings right behind the ones already in flight
+        while (w->up && w->count < w->size) {
+            int n = sq_peek_n(w->sink, w->buf, w->readings + w->batch);
+            if (w->count) {
+                sq_mark_t at = sq_peek_mark(w->sink, w->readings);
+                const sq_mark_t *last = &w->m[(w->head + w->count - 1) % ACK_WIN_MAX].mark;
+                if (at.ram != last->ram || at.spool_seq != last->spool_seq) {
+                    // the queue no longer starts with what is in flight: the spool dropped it
+                    ESP_LOGW(TAG, "sink %d: %d reading(s) in flight lost from the spool, resending",
+                             w->sink, w->readings);
+                    ack_win_reset(w);
+                    continue;
+                }
+            }
+            int k = n - w->readings;
+            if (k <= 0) break;
+            int id = w->send(w->ctx, w->buf + w->readings, k);
+            if (id <= 0) break;   // transport busy or link just dropped: wait for acks instead
+
+            int slot = (w->head + w->count) % ACK_WIN_MAX;
+            w->m[slot].id = id;
+            w->m[slot].n = k;
+            w->m[slot].acked = false;
+            w->m[slot].held = false;
+            w->m[slot].sent_us = esp_timer_get_time();
+            w->m[slot].tries = 0;
+            w->m[slot].epoch = w->epoch;
+            w->m[slot].mark = sq_peek_mark(w->sink, n);
+            w->count++;
+            w->readings += k;
+            w->sent++;
+            (*msgs)++;
+        }
+        sq_abort(w->sink);
+        if (w->count == 0) break;   // queue drained and everything acknowledged
+
+        // next event; queued acks are taken without waiting even if overdue
+        int h = w->head;
+        bool held = w->m[h].held;
+        int64_t start = held ? w->m[h].held_us : w->m[h].sent_us;
+        if (w->up_us > start) start = w->up_us;
+        int64_t due_us = start + (held ? w->held_timeout_us : w->timeout_us << w->m[h].tries) - esp_timer_get_time();
+        TickType_t wait = due_us > 0 ? pdMS_TO_TICKS(due_us / 1000) + 1 : 0;
+        int id;
+        if (xQueueReceive(w->events, &id, wait) != pdTRUE) {
+            if (!held && w->retransmit && w->m[h].tries < w->max_retries && w->retransmit(w->ctx, w->m[h].id)) {
+                w->m[h].tries++;
+                w->m[h].sent_us = esp_timer_get_time();
+                w->retransmits++;
+                continue;
+            }
+            w->timeouts++;
+            ESP_LOGW(TAG, "sink %d: %s for msg %d overdue, resending %d reading(s)",
+                     w->sink, held ? "response" : "ack", w->m[w->head].id, w->readings);
+            ack_win_reset(w);
+            return -1;
+        }
+        if (id == 0) {
+            if (!w->up) return -1;   // link down; the window is dealt with after the reconnect
+            continue;                // stale: the link is already back
+        }
+        if (id < 0) {
+            note_held(w, -id);
+            continue;
+        }
+        note_ack(w, id);
+
+        // commit the acknowledged front of the window
+        int done = 0;
+        sq_mark_t upto = { 0 };
+        while (w->count && w->m[w->head].acked) {
+            done += w->m[w->head].n;
+            upto = w->m[w->head].mark;
+            w->head = (w->head + 1) % ACK_WIN_MAX;
+            w->count--;
+        }
+        if (done) {
+            sq_commit_mark(w->sink, upto);
+            w->readings -= done;
+            sent += done;
+        }
+    }
+    return sent;
+}
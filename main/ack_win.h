@@ -0,0 +1,86 @@
+//ack_win.h
+// Window of in-flight upload messages over a sink's sample queue cursor
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "reading.h"
+#include "sample_q.h"
+
+#define ACK_WIN_MAX    4   // messages in flight, upper bound for every transport
+#define ACK_WIN_BATCH  8   // readings per message, upper bound
+
+// Sends rs[0..n) as one message; returns its id (> 0), or <= 0 if the
+// transport cannot take it now (buffer full, link just dropped)
+typedef int (*ack_win_send_t)(void *ctx, const reading_t *rs, int n);
+
+// Sends message id again, unchanged; false if it can't (optional hook)
+typedef bool (*ack_win_retransmit_t)(void *ctx, int id);
+
+/* Used by the transports that acknowledge messages asynchronously
+   (mqtt_up, ws_up, coap_up). The window always holds the sink's oldest
+   readings, in send order; readings are committed to the sample queue only
+   when the acks reach the front of the window. When the window is full
+   nothing more is sent, so a slow server backs up into the queue (then the
+   spool) instead of into socket buffers. */
+typedef struct {
+    int            sink;
+    int            size;          // messages in flight at most (<= ACK_WIN_MAX)
+    int            batch;         // readings per message (<= ACK_WIN_BATCH)
+    int64_t        timeout_us;    // ack overdue → forget the window, resend from the queue
+    bool           resends;       // transport retransmits unacked messages after a reconnect (MQTT outbox)
+    ack_win_send_t send;
+    ack_win_retransmit_t retransmit;   // optional, set after ack_win_init: lossy transports (UDP)
+    int            max_retries;   // retransmissions before the timeout counts, timeout doubling each time
+    int64_t        held_timeout_us;   // accepted, response still to come (ack_win_held) → wait this long
+    void          *ctx;
+    QueueHandle_t  events;        // acked ids from the transport, 0 = link went down
+    volatile bool  up;
+    volatile int64_t up_us;       // when the link last came up; ack deadlines restart there
+    volatile uint32_t epoch;      // connections so far; a message sent on an older one is lost
+                                  // unless the transport resends
+
+    struct {
+        int      id;
+        int      n;               // readings in the message
+        bool     acked;
+        bool     held;            // accepted by the server, its response comes separately
+        int64_t  sent_us;        // last (re)transmission
+        int64_t  held_us;        // when the server accepted it
+        uint8_t  tries;          // retransmissions so far
+        uint32_t epoch;
+        sq_mark_t mark;           // the queue just past its readings: what its ack commits
+    } m[ACK_WIN_MAX];
+    int       head, count;        // ring of in-flight messages, oldest at head
+    int       readings;           // readings in flight
+    reading_t buf[ACK_WIN_MAX * ACK_WIN_BATCH];
+
+    // stats
+    uint32_t  sent, acked, timeouts, retransmits;
+    int64_t   ack_us_last, ack_us_total, ack_us_max;
+} ack_win_t;
+
+// Set up (or reconfigure) w; starts with the link down and nothing in flight
+bool ack_win_init(ack_win_t *w, int sink, int size, int batch, int timeout_ms, bool resends,
+                  ack_win_send_t send, void *ctx);
+
+// Forget the in-flight messages (new session: their acks will never come)
+void ack_win_reset(ack_win_t *w);
+
+// From the transport's event handler: link state changes and acks
+void ack_win_link(ack_win_t *w, bool up);
+void ack_win_acked(ack_win_t *w, int id);
+
+// From the transport's event handler: message id reached the server and its
+// response will follow separately (CoAP empty ACK). It is not retransmitted
+// any more; only the response is waited for, up to held_timeout_us.
+void ack_win_held(ack_win_t *w, int id);
+
+/* Sends the sink's backlog keeping up to `size` messages in flight and
+   returns once everything sent is acknowledged. Returns the readings
+   delivered, or -1 if the link dropped or an ack timed out. After a drop
+   the window is kept if the transport resends, so acks of its retransmits
+   still commit; otherwise messages of the old connection are sent again.
+   *msgs counts the messages sent. */
+int ack_win_flush(ack_win_t *w, int *msgs);
@@ -0,0 +1,114 @@
+//breaker.c
+//Closed / open / half-open state machine for one endpoint
+/*
+Backoff for the n-th consecutive open period:
+    cap  = min(BRK_BACKOFF_MAX_US, BRK_BACKOFF_MIN_US << n)
+    wait = cap/2 + rnd % (cap/2)        ("equal jitter")
+Half the window is fixed so a dead server is never hammered, the other
+half is random so a farm of devices that lost the server together does
+not come back to it in lockstep.
+*/
+#include "breaker.h"
+#include <string.h>
+
+void brk_init(breaker_t *b)
+{
+    memset(b, 0, sizeof(*b));
+    b->state = BRK_CLOSED;
+}
+
+bool brk_allow(breaker_t *b, int64_t now_us)
+{
+    switch (b->state) {
+    case BRK_CLOSED:
+        return true;
+    case BRK_OPEN:
+        if (now_us >= b->retry_us) {
+            b->state = BRK_HALF_OPEN;  // this caller gets the trial
+            b->trial_us = now_us;
+            return true;
+        }
+        b->denied++;
+        return false;
+    case BRK_HALF_OPEN:
+    default:
+        if (now_us - b->trial_us >= BRK_TRIAL_TIMEOUT_US) {
+            // its owner never reported (a path that forgot to): this caller gets a new one
+            b->lost++;
+            b->trial_us = now_us;
+            return true;
+        }
+        b->denied++;  // trial already out
+        return false;
+    }
+}
+
+bool brk_ready(const breaker_t *b, int64_t now_us)
+{
+    switch (b->state) {
+    case BRK_CLOSED:    return true;
+    case BRK_OPEN:      return now_us >= b->retry_us;
+    case BRK_HALF_OPEN:
+    default:            return now_us - b->trial_us >= BRK_TRIAL_TIMEOUT_US;
+    }
+}
+
+void brk_release(breaker_t *b)
+{
+    if (b->state == BRK_HALF_OPEN) b->state = BRK_OPEN;  // retry_us already passed
+}
+
+int64_t brk_retry_in(const breaker_t *b, int64_t now_us)
+{
+    if (b->state != BRK_OPEN || now_us >= b->retry_us) return 0;
+    return b->retry_us - now_us;
+}
+
+void brk_success(breaker_t *b)
+{
+    b->state = BRK_CLOSED;
+    b->fails = 0;
+    b->level = 0;
+}
+
+static void brk_open(breaker_t *b, int64_t now_us, uint32_t rnd)
+{
+    int64_t cap = BRK_BACKOFF_MIN_US;
+    for (int i = 0; i < b->level && cap < BRK_BACKOFF_MAX_US; ++i) cap <<= 1;
+    if (cap > BRK_BACKOFF_MAX_US) cap = BRK_BACKOFF_MAX_US;
+    int64_t half = cap / 2;
+
+    b->state = BRK_OPEN;
+    b->retry_us = now_us + half + (int64_t)(rnd % (uint64_t)half);
+    b->trips++;
+    if (b->level < 31) b->level++;
+}
+
+void brk_failure(breaker_t *b, int64_t now_us, uint32_t rnd)
+{
+    switch (b->state) {
+    case BRK_CLOSED:
+        if (++b->fails >= BRK_TRIP_FAILS) {
+            b->fails = 0;
+            brk_open(b, now_us, rnd);
+        }
+        break;
+    case BRK_HALF_OPEN:
+        brk_open(b, now_us, rnd);  // trial failed → longer wait
+        break;
+    case BRK_OPEN:
+    default:
+        // a request that slipped through before the trip; keep the current deadline
+        break;
+    }
+}
+
+const char *brk_state_name(brk_state_t s)
+{
+    switch (s) {
+    case BRK_CLOSED:    return "closed";
+    case BRK_OPEN:      return "open";
+    case BRK_HALF_OPEN: return "half-open";
+    default:            return "?";
+    }
+}
@@ -0,0 +1,57 @@
+//breaker.h
+// Circuit breaker with jittered exponential backoff, one per endpoint
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/* closed    → requests flow; BRK_TRIP_FAILS failures in a row open it
+   open      → nothing is sent until the backoff expires
+   half-open → exactly one trial request; success closes, failure re-opens
+               with the backoff doubled (up to BRK_BACKOFF_MAX_US). A trial
+               that was never sent is handed back with brk_release; one that
+               never reports is given up after BRK_TRIAL_TIMEOUT_US
+   No clock or RNG inside: callers pass now_us and a random word, so the
+   state machine runs the same on the host with a fake clock. */
+typedef enum { BRK_CLOSED = 0, BRK_OPEN, BRK_HALF_OPEN } brk_state_t;
+
+#define BRK_TRIP_FAILS      3
+#define BRK_BACKOFF_MIN_US  (30LL * 1000000LL)        // first open period (before jitter)
+#define BRK_BACKOFF_MAX_US  (16LL * 60LL * 1000000LL) // cap
+#define BRK_TRIAL_TIMEOUT_US (2LL * 60LL * 1000000LL)  // a trial outstanding this long is lost
+
+typedef struct {
+    brk_state_t state;
+    uint8_t  fails;      // consecutive failures while closed
+    uint8_t  level;      // backoff doublings so far
+    int64_t  retry_us;   // open: when the half-open trial may go
+    int64_t  trial_us;   // half-open: when the trial was handed out
+    uint32_t trips;      // closed/half-open → open transitions
+    uint32_t denied;     // attempts refused while open
+    uint32_t lost;       // trials that timed out without a report
+} breaker_t;
+
+void brk_init(breaker_t *b);
+
+// May a request go now? Moves open → half-open once the backoff expired
+// (that caller owns the trial; others are refused until it reports, releases
+// it, or BRK_TRIAL_TIMEOUT_US passes). Ask right before sending.
+bool brk_allow(breaker_t *b, int64_t now_us);
+
+// Would brk_allow say yes? Takes nothing, so it can gate work that may end
+// up sending nothing.
+bool brk_ready(const breaker_t *b, int64_t now_us);
+
+// The trial owner sent nothing, or got an answer that says nothing about the
+// server's health: half-open → open with the backoff already expired, so the
+// next brk_allow gets the trial. No-op in the other states.
+void brk_release(breaker_t *b);
+
+// Time until brk_allow would say yes (0 = now); half-open with a trial out counts as 0
+int64_t brk_retry_in(const breaker_t *b, int64_t now_us);
+
+void brk_success(breaker_t *b);
+
+// rnd: any uniformly random 32-bit word (esp_random() on target)
+void brk_failure(breaker_t *b, int64_t now_us, uint32_t rnd);
+
+const char *brk_state_name(brk_state_t s);
@@ -0,0 +1,366 @@
+//coap_up.c
+//Minimal CoAP client (RFC 7252) for the LAN ingest path: CON POST + piggybacked ACK
+/*
+Per reading, the keep-alive HTTP path still costs a request and a response
+segment plus TCP ACKs, and a new TCP handshake whenever the server closed
+the idle connection. Here it is one request datagram and one ACK datagram,
+so the radio is on for a single exchange.
+
+Only what the uplink needs is implemented: CON POST with Uri-Path and
+Content-Format options, piggybacked or separate responses, CoAP ping, and
+retransmission with exponential backoff (through ack_win's retransmit
+hook). No blockwise transfer: a batch is kept to one datagram.
+
+Message ids: messages use 1..0x7FFF (they double as ack_win ids), pings
+0x8000..0xFFFF, so a ping never collides with a message in flight.
+Datagrams of the messages in flight are kept for retransmission, indexed
+by send count modulo COAP_WINDOW (only the last COAP_WINDOW sends can
+still be in flight).
+*/
+#include "coap_up.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "sample_q.h"      // SQ_SINKS
+#include "ack_win.h"
+#include "ingest_enc.h"    // INGEST_JSON_MAX
+#include "dns_cache.h"
+
+static const char *TAG = "coap_up";
+
+#define COAP_PORT      5683
+#define COAP_CON       0
+#define COAP_NON       1
+#define COAP_ACK       2
+#define COAP_RST       3
+#define COAP_POST      0x02
+#define COAP_OPT_URI_PATH   11
+#define COAP_OPT_CONTENT_FMT 12
+#define COAP_CF_OCTETS 42
+#define COAP_CF_JSON   50
+#define COAP_HDR_MAX   48     // header, token, options, payload marker
+#define COAP_DGRAM_MAX (COAP_HDR_MAX + INGEST_JSON_MAX(COAP_BATCH_MAX))
+
+typedef struct {
+    int           sock;           // -1 = closed
+    char          base[128];
+    coap_up_cfg_t cfg;
+    ack_win_t     win;
+    TaskHandle_t  rx;             // receive task, NULL once it exited
+    volatile bool running;
+    uint32_t      sends;          // messages sent so far (picks the tx slot and the message id)
+    uint16_t      ping_seq;
+    volatile uint16_t ping_mid;
+    SemaphoreHandle_t ping_sem;   // given by the receive task on the ping's RST
+    int64_t       ping_us;        // last ping round-trip
+
+    // datagrams of the messages in flight, for retransmission
+    struct {
+        uint16_t mid;
+        int      len;
+        uint8_t  buf[COAP_DGRAM_MAX];
+    } tx[COAP_WINDOW];
+
+    // stats
+    uint32_t dgrams_tx, dgrams_rx, client_errors, server_errors, separate;
+    uint64_t bytes_tx, bytes_rx;
+} coap_sess_t;
+
+static coap_sess_t s_sess[SQ_SINKS] = { [0 ... SQ_SINKS - 1] = { .sock = -1 } };
+
+// coap://host[:port] → connected UDP socket, or -1
+static int open_socket(const char *base)
+{
+    const char *h = strstr(base, "://");
+    if (!h) return -1;
+    h += 3;
+    char host[96], ip[16];
+    size_t hl = strcspn(h, ":/");
+    if (hl == 0 || hl >= sizeof(host)) return -1;
+    memcpy(host, h, hl);
+    host[hl] = 0;
+    int port = h[hl] == ':' ? atoi(h + hl + 1) : COAP_PORT;
+    if (!dns_cache_lookup(host, ip, sizeof(ip))) return -1;
+
+    struct sockaddr_in to = { .sin_family = AF_INET, .sin_port = htons(port) };
+    if (inet_pton(AF_INET, ip, &to.sin_addr) != 1) return -1;
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) return -1;
+    // connected: plain send()/recv(), and datagrams from anyone else are filtered out
+    if (connect(sock, (struct sockaddr *)&to, sizeof(to)) != 0) {
+        close(sock);
+        return -1;
+    }
+    struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };   // lets the receive task notice a close
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return sock;
+}
+
+// One option; delta < 13 always here, length up to 268
+static int put_opt(uint8_t *p, size_t room, int delta, const void *v, size_t len)
+{
+    if (len > 268 || room < len + 2) return -1;
+    size_t o = 0;
+    if (len < 13) {
+        p[o++] = (uint8_t)(delta << 4 | len);
+    } else {
+        p[o++] = (uint8_t)(delta << 4 | 13);
+        p[o++] = (uint8_t)(len - 13);
+    }
+    memcpy(p + o, v, len);
+    return (int)(o + len);
+}
+
+// CON POST <path> with the readings as payload; returns the length or -1
+static int build_post(const coap_sess_t *s, uint8_t *p, size_t cap, uint16_t mid,
+                      const reading_t *rs, int n)
+{
+    size_t o = 0;
+    p[o++] = 0x40 | (COAP_CON << 4) | 2;   // version 1, CON, 2-byte token
+    p[o++] = COAP_POST;
+    p[o++] = mid >> 8;
+    p[o++] = mid & 0xFF;
+    p[o++] = mid >> 8;                     // token = message id
+    p[o++] = mid & 0xFF;
+
+    // options by ascending number: one Uri-Path per segment, then Content-Format
+    int last = 0;
+    for (const char *seg = s->cfg.path; *seg; ) {
+        size_t len = strcspn(seg, "/");
+        if (len) {
+            int k = put_opt(p + o, COAP_HDR_MAX - 2 - o, COAP_OPT_URI_PATH - last, seg, len);
+            if (k < 0) return -1;
+            o += k;
+            last = COAP_OPT_URI_PATH;
+        }
+        seg += len;
+        if (*seg == '/') seg++;
+    }
+    uint8_t cf = s->cfg.json ? COAP_CF_JSON : COAP_CF_OCTETS;
+    int k = put_opt(p + o, COAP_HDR_MAX - 1 - o, COAP_OPT_CONTENT_FMT - last, &cf, 1);
+    if (k < 0) return -1;
+    o += k;
+    p[o++] = 0xFF;                         // payload marker
+
+    int b = s->cfg.enc(p + o, cap - o, rs, n);
+    return b < 0 ? -1 : (int)o + b;
+}
+
+static bool send_dgram(coap_sess_t *s, const uint8_t *p, int len)
+{
+    if (send(s->sock, p, len, 0) != len) return false;
+    s->dgrams_tx++;
+    s->bytes_tx += len;
+    return true;
+}
+
+// Receives ACK / RST / separate responses and feeds them to the window
+static void task_coap_rx(void *arg)
+{
+    coap_sess_t *s = (coap_sess_t *)arg;
+    uint8_t m[64];   // only header and token matter; longer datagrams are truncated
+    while (s->running) {
+        int n = recv(s->sock, m, sizeof(m), 0);
+        if (n < 4 || (m[0] >> 6) != 1) continue;   // timeout, or not CoAP v1
+        s->dgrams_rx++;
+        s->bytes_rx += n;
+        int type = (m[0] >> 4) & 3, tkl = m[0] & 0x0F, code = m[1];
+        uint16_t mid = (uint16_t)(m[2] << 8 | m[3]);
+
+        if (type == COAP_RST) {
+            if (mid == s->ping_mid) xSemaphoreGive(s->ping_sem);
+            continue;   // a rejected message is retransmitted, then times out
+        }
+        if (code == 0) {
+            // empty ACK: the server has the POST, the response comes separately.
+            // Retransmitting now would only make the server answer it again
+            if (type == COAP_ACK && mid > 0 && mid <= 0x7FFF) {
+                s->separate++;
+                ack_win_held(&s->win, mid);
+            }
+            continue;
+        }
+
+        int id;
+        if (type == COAP_ACK) {
+            id = mid;   // piggybacked response
+        } else {
+            // separate response, matched by token; a CON one needs our empty ACK
+            if (tkl != 2 || n < 6) continue;
+            id = m[4] << 8 | m[5];
+            if (type == COAP_CON) {
+                uint8_t ack[4] = { 0x40 | (COAP_ACK << 4), 0, m[2], m[3] };
+                send_dgram(s, ack, sizeof(ack));
+            }
+        }
+        if (id == 0 || id > 0x7FFF) continue;
+
+        int cls = code >> 5;
+        if (cls == 2) {
+            ack_win_acked(&s->win, id);
+        } else if (cls == 4) {
+            // the server will never take it: drop it, like an HTTP 4xx
+            s->client_errors++;
+            ESP_LOGW(TAG, "sink %d: %d.%02d for msg %d — dropping it", (int)(s - s_sess), cls, code & 0x1F, id);
+            ack_win_acked(&s->win, id);
+        } else {
+            s->server_errors++;   // 5.xx: retransmitted until the window gives up
+        }
+    }
+    s->rx = NULL;
+    vTaskDelete(NULL);
+}
+
+// ack_win_send_t: one CON POST, id = its message id
+static int coap_send(void *ctx, const reading_t *rs, int n)
+{
+    coap_sess_t *s = (coap_sess_t *)ctx;
+    uint16_t mid = (uint16_t)(s->sends % 0x7FFF + 1);
+    int slot = s->sends % COAP_WINDOW;
+    int len = build_post(s, s->tx[slot].buf, sizeof(s->tx[slot].buf), mid, rs, n);
+    if (len < 0) return -1;
+    if (!send_dgram(s, s->tx[slot].buf, len)) return 0;   // no buffer right now: wait for acks
+    s->tx[slot].mid = mid;
+    s->tx[slot].len = len;
+    s->sends++;
+    return mid;
+}
+
+// ack_win_retransmit_t: the same datagram again (same message id, so the server deduplicates)
+static bool coap_retransmit(void *ctx, int id)
+{
+    coap_sess_t *s = (coap_sess_t *)ctx;
+    for (int i = 0; i < COAP_WINDOW; ++i) {
+        if (s->tx[i].len > 0 && s->tx[i].mid == id) return send_dgram(s, s->tx[i].buf, s->tx[i].len);
+    }
+    return false;
+}
+
+bool coap_up_open(int sink, const coap_up_cfg_t *cfg)
+{
+    if (sink < 0 || sink >= SQ_SINKS) return false;
+    coap_sess_t *s = &s_sess[sink];
+    if (s->sock >= 0 && strcmp(s->base, cfg->base) == 0) return true;
+    coap_up_close(sink);
+
+    if (!s->ping_sem) s->ping_sem = xSemaphoreCreateBinary();
+    if (!s->ping_sem) return false;
+    if (!ack_win_init(&s->win, sink, COAP_WINDOW, COAP_BATCH_MAX, COAP_ACK_TIMEOUT_MS, false, coap_send, s)) {
+        return false;
+    }
+    s->win.retransmit = coap_retransmit;
+    s->win.max_retries = COAP_MAX_RETRANSMIT;
+    s->win.held_timeout_us = COAP_RESP_TIMEOUT_MS * 1000LL;
+    memset(s->tx, 0, sizeof(s->tx));
+
+    s->sock = open_socket(cfg->base);
+    if (s->sock < 0) { ESP_LOGW(TAG, "sink %d: cannot open %s", sink, cfg->base); return false; }
+    strncpy(s->base, cfg->base, sizeof(s->base) - 1);
+    s->cfg = *cfg;
+
+    s->running = true;
+    char name[12];
+    snprintf(name, sizeof(name), "t_coap%d", sink);
+    if (xTaskCreatePinnedToCore(task_coap_rx, name, 3072, s, 7, &s->rx, 1) != pdPASS) {
+        s->running = false;
+        close(s->sock);
+        s->sock = -1;
+        return false;
+    }
+    ack_win_link(&s->win, true);   // UDP: nothing to connect, the window is usable right away
+    ESP_LOGI(TAG, "sink %d: CoAP to %s/%s", sink, s->base, cfg->path);
+    return true;
+}
+
+void coap_up_close(int sink)
+{
+    if (sink < 0 || sink >= SQ_SINKS) return;
+    coap_sess_t *s = &s_sess[sink];
+    if (s->sock < 0) return;
+    s->running = false;
+    ack_win_link(&s->win, false);
+    // the receive task leaves within its 1 s recv timeout
+    for (int t = 0; s->rx && t < 3000; t += 50) vTaskDelay(pdMS_TO_TICKS(50));
+    close(s->sock);
+    s->sock = -1;
+    s->base[0] = 0;
+    ack_win_reset(&s->win);
+}
+
+bool coap_up_ping(int sink, int timeout_ms)
+{
+    if (sink < 0 || sink >= SQ_SINKS || s_sess[sink].sock < 0) return false;
+    coap_sess_t *s = &s_sess[sink];
+    uint16_t mid = 0x8000 | (++s->ping_seq & 0x7FFF);
+    uint8_t ping[4] = { 0x40 | (COAP_CON << 4), 0, mid >> 8, mid & 0xFF };   // empty CON
+    xSemaphoreTake(s->ping_sem, 0);   // drop a late RST of an earlier ping
+    s->ping_mid = mid;
+
+    int64_t t0 = esp_timer_get_time();
+    // resent after 1 s, 2 s, 4 s ... within timeout_ms
+    for (int waited = 0, step = COAP_ACK_TIMEOUT_MS / 2; waited < timeout_ms; waited += step, step *= 2) {
+        if (step > timeout_ms - waited) step = timeout_ms - waited;
+        send_dgram(s, ping, sizeof(ping));
+        if (xSemaphoreTake(s->ping_sem, pdMS_TO_TICKS(step)) == pdTRUE) {
+            s->ping_us = esp_timer_get_time() - t0;
+            return true;
+        }
+    }
+    return false;
+}
+
+int coap_up_flush(int sink, int *msgs)
+{
+    *msgs = 0;
+    if (sink < 0 || sink >= SQ_SINKS || s_sess[sink].sock < 0) return -1;
+    return ack_win_flush(&s_sess[sink].win, msgs);
+}
+
+int64_t coap_up_rtt_us(int sink)
+{
+    if (sink < 0 || sink >= SQ_SINKS) return 0;
+    return s_sess[sink].win.ack_us_last ? s_sess[sink].win.ack_us_last : s_sess[sink].ping_us;
+}
+
+int64_t coap_up_probe(const char *base, int timeout_ms)
+{
+    int sock = open_socket(base);
+    if (sock < 0) return -1;
+    uint16_t mid = 0x8000 | (uint16_t)(esp_timer_get_time() & 0x7FFF);
+    uint8_t ping[4] = { 0x40 | (COAP_CON << 4), 0, mid >> 8, mid & 0xFF };
+    int64_t t0 = esp_timer_get_time(), dt = -1;
+    for (int tries = 0; tries * 1000 < timeout_ms && dt < 0; ++tries) {
+        if (send(sock, ping, sizeof(ping), 0) != sizeof(ping)) break;
+        uint8_t m[16];
+        int n = recv(sock, m, sizeof(m), 0);   // 1 s timeout from open_socket
+        if (n >= 4 && ((m[0] >> 4) & 3) == COAP_RST && m[2] == ping[2] && m[3] == ping[3]) {
+            dt = esp_timer_get_time() - t0;
+        }
+    }
+    close(sock);
+    if (dt < 0) ESP_LOGW(TAG, "CoAP server %s not answering", base);
+    return dt;
+}
+
+void coap_up_log_stats(int sink)
+{
+    if (sink < 0 || sink >= SQ_SINKS) return;
+    const coap_sess_t *s = &s_sess[sink];
+    const ack_win_t *w = &s->win;
+    if (s->sock < 0 && !w->sent) return;
+    // datagrams per delivered message is the figure to hold against the HTTP session's stats
+    ESP_LOGI(TAG, "coap %d: %u msg(s), %u acked (avg %lld ms max %lld ms), %u retransmit(s), %u timeout(s), %d in flight, datagrams %u tx / %u rx (%llu / %llu B), %u separate, %u 4.xx, %u 5.xx",
+             sink, (unsigned)w->sent, (unsigned)w->acked,
+             (long long)(w->acked ? w->ack_us_total / w->acked / 1000 : 0), (long long)(w->ack_us_max / 1000),
+             (unsigned)w->retransmits, (unsigned)w->timeouts, w->count,
+             (unsigned)s->dgrams_tx, (unsigned)s->dgrams_rx,
+             (unsigned long long)s->bytes_tx, (unsigned long long)s->bytes_rx,
+             (unsigned)s->separate, (unsigned)s->client_errors, (unsigned)s->server_errors);
+}
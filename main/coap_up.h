@@ -0,0 +1,52 @@
+//coap_up.h
+// CoAP uplink for the LAN server: confirmable POSTs over UDP, nothing to connect
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "reading.h"
+
+#define COAP_WINDOW          4      // confirmable messages in flight, <= ACK_WIN_MAX
+#define COAP_BATCH_MAX       8      // readings per message, <= ACK_WIN_BATCH (JSON: ~610 B, one datagram)
+#define COAP_ACK_TIMEOUT_MS  2000   // RFC 7252 ACK_TIMEOUT, doubled on each retransmission
+#define COAP_MAX_RETRANSMIT  4      // RFC 7252 MAX_RETRANSMIT
+#define COAP_RESP_TIMEOUT_MS 10000  // empty ACK received → wait this long for the separate response
+
+/* One reading (or batch) is one CON POST to coap://host[:port]/<path> and
+   one piggybacked ACK back: two datagrams instead of a TCP exchange. The
+   token is the 2-byte message id, so a separate response can be matched
+   too; after the server's empty ACK the POST is no longer retransmitted
+   and only the response is waited for. 2.xx stores the batch; 4.xx drops it (like an HTTP 4xx); anything
+   else is retransmitted. coap:// only, no DTLS: meant for the LAN server. */
+
+// Encodes n readings as one payload; returns its length or -1 if cap is too small
+typedef int (*coap_up_enc_t)(uint8_t *dst, size_t cap, const reading_t *rs, int n);
+
+typedef struct {
+    const char   *base;   // coap://host[:port]
+    const char   *path;   // Uri-Path, e.g. "ingest/batch"
+    bool          json;   // Content-Format application/json, else application/octet-stream
+    coap_up_enc_t enc;
+} coap_up_cfg_t;
+
+// Opens sink's UDP socket and receive task; no-op while open for the same base
+bool coap_up_open(int sink, const coap_up_cfg_t *cfg);
+void coap_up_close(int sink);
+
+// CoAP ping (empty CON, answered by RST): is the server there? (the health check)
+bool coap_up_ping(int sink, int timeout_ms);
+
+/* Sends sink's backlog (sample_q.h) with up to COAP_WINDOW messages in flight
+   (ack_win.h) and returns once everything sent is acknowledged. Returns the
+   readings delivered, or -1 once a message went unacknowledged through all
+   its retransmissions; unacknowledged readings stay queued. *msgs counts
+   the messages sent (retransmissions not included). */
+int coap_up_flush(int sink, int *msgs);
+
+// Send → ACK time of the last acknowledged message, or of the last ping (0 = none)
+int64_t coap_up_rtt_us(int sink);
+
+// CoAP ping of base on a throwaway socket: round-trip in us, or -1
+int64_t coap_up_probe(const char *base, int timeout_ms);
+
+void coap_up_log_stats(int sink);
@@ -0,0 +1,303 @@
+//dns_cache.c
+//Caches A records of the ingest hosts so reconnects skip the DNS round-trip
+/*
+lwIP's resolver (getaddrinfo) does not report the record's TTL, so a miss
+sends one small A query straight to the DHCP-provided DNS server and keeps
+the answer for its TTL. If that query fails, getaddrinfo is tried and its
+answer kept for DNS_TTL_FALLBACK_S.
+
+Entries are never dropped on expiry: when the next resolution fails (DNS
+server down, Wi-Fi flapping) the expired address is still served for up to
+DNS_LKG_MAX_S, since a server's address rarely changes between two lookups.
+*/
+#include "dns_cache.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include "lwip/dns.h"
+
+static const char *TAG = "dns_cache";
+
+#define DNS_TTL_MIN_S       30      // floor for very short TTLs (load-balancer names)
+#define DNS_TTL_MAX_S       3600
+#define DNS_TTL_FALLBACK_S  60      // getaddrinfo answers carry no TTL
+#define DNS_LKG_MAX_S       (24 * 3600)
+#define DNS_QUERY_TIMEOUT_MS 2000
+#ifndef DNS_SERVER_PORT
+#define DNS_SERVER_PORT     53      // overridden by the host test's scripted server
+#endif
+#define DNS_QUERY_TRIES     4       // datagrams read per query before giving up
+
+typedef struct {
+    char     host[96];
+    uint32_t addr;        // network byte order, 0 = empty slot
+    uint32_t ttl_s;
+    int64_t  expires_us;
+    int64_t  used_us;     // for LRU replacement
+} dns_entry_t;
+
+static dns_entry_t s_tab[DNS_CACHE_SIZE];
+static dns_cache_stats_t s_stats;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int find(const char *host)
+{
+    for (int i = 0; i < DNS_CACHE_SIZE; ++i) {
+        if (s_tab[i].addr && strcmp(s_tab[i].host, host) == 0) return i;
+    }
+    return -1;
+}
+
+// Encodes "a.b.c" as DNS labels; returns bytes written or -1
+static int put_qname(uint8_t *p, size_t room, const char *host)
+{
+    size_t o = 0;
+    while (*host) {
+        const char *dot = strchr(host, '.');
+        size_t len = dot ? (size_t)(dot - host) : strlen(host);
+        if (len == 0 || len > 63 || o + 1 + len + 1 > room) return -1;
+        p[o++] = (uint8_t)len;
+        memcpy(p + o, host, len);
+        o += len;
+        host += len + (dot ? 1 : 0);
+    }
+    p[o++] = 0;
+    return (int)o;
+}
+
+// Skips a (possibly compressed) name at off; returns the offset after it or -1
+static int skip_name(const uint8_t *m, int len, int off)
+{
+    while (off < len) {
+        uint8_t l = m[off];
+        if (l == 0) return off + 1;
+        if ((l & 0xC0) == 0xC0) return off + 2 <= len ? off + 2 : -1;
+        off += 1 + l;
+    }
+    return -1;
+}
+
+// The reply's question section echoes ours (QDCOUNT 1, same QNAME ignoring
+// case, QTYPE / QCLASS): anything else answers some other query
+static bool question_matches(const uint8_t *m, int len, const uint8_t *q, int qlen)
+{
+    if (len < qlen || m[4] != 0 || m[5] != 1) return false;
+    for (int i = 12; i < qlen; ++i) {
+        uint8_t a = m[i], b = q[i];
+        if (a >= 'A' && a <= 'Z') a += 'a' - 'A';
+        if (b >= 'A' && b <= 'Z') b += 'a' - 'A';
+        if (a != b) return false;
+    }
+    return true;
+}
+
+// One A query to the first DNS server; true with *addr / *ttl_s on success
+static bool query_a(const char *host, uint32_t *addr, uint32_t *ttl_s)
+{
+    const ip_addr_t *srv = dns_getserver(0);
+    if (!srv || !IP_IS_V4(srv) || ip4_addr_get_u32(ip_2_ip4(srv)) == 0) return false;
+
+    uint8_t query[12 + 256 + 4];
+    uint16_t id = (uint16_t)esp_random();
+    memset(query, 0, 12);
+    query[0] = id >> 8; query[1] = id & 0xFF;
+    query[2] = 0x01;                     // RD
+    query[5] = 1;                        // QDCOUNT
+    int q = put_qname(query + 12, sizeof(query) - 12 - 4, host);
+    if (q < 0) return false;
+    int qlen = 12 + q;
+    query[qlen++] = 0; query[qlen++] = 1;    // QTYPE A
+    query[qlen++] = 0; query[qlen++] = 1;    // QCLASS IN
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) return false;
+    struct timeval tv = { .tv_sec = DNS_QUERY_TIMEOUT_MS / 1000, .tv_usec = (DNS_QUERY_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in to = { .sin_family = AF_INET, .sin_port = htons(DNS_SERVER_PORT) };
+    to.sin_addr.s_addr = ip4_addr_get_u32(ip_2_ip4(srv));
+
+    // connected: the stack drops datagrams from anyone but the server's
+    // address and port. A reply that isn't ours (id, question) is skipped,
+    // not believed: the cache keeps what it is given for up to a day (LKG).
+    uint8_t msg[512];
+    bool ok = false;
+    int len = -1;
+    if (connect(sock, (struct sockaddr *)&to, sizeof(to)) == 0 && send(sock, query, qlen, 0) == qlen) {
+        for (int t = 0; t < DNS_QUERY_TRIES; ++t) {
+            len = recv(sock, msg, sizeof(msg), 0);
+            if (len < 0) break;
+            // header: same id, QR set; then the question we asked
+            if (len >= 12 && msg[0] == (id >> 8) && msg[1] == (id & 0xFF) && (msg[2] & 0x80) &&
+                question_matches(msg, len, query, qlen)) break;
+            taskENTER_CRITICAL(&s_lock);
+            s_stats.rejected++;
+            taskEXIT_CRITICAL(&s_lock);
+            len = -1;
+        }
+    }
+    close(sock);
+
+    // RCODE 0, at least one answer
+    if (len < 12 || (msg[3] & 0x0F) != 0) return false;
+    int an = (msg[6] << 8) | msg[7];
+    int off = qlen;
+
+    // first A record wins; a CNAME chain in front of it is skipped over
+    for (int i = 0; i < an && !ok; ++i) {
+        off = skip_name(msg, len, off);
+        if (off < 0 || off + 10 > len) break;
+        uint16_t type  = (msg[off] << 8) | msg[off + 1];
+        uint16_t klass = (msg[off + 2] << 8) | msg[off + 3];
+        uint32_t ttl   = ((uint32_t)msg[off + 4] << 24) | ((uint32_t)msg[off + 5] << 16) |
+                         ((uint32_t)msg[off + 6] << 8) | msg[off + 7];
+        uint16_t rdlen = (msg[off + 8] << 8) | msg[off + 9];
+        off += 10;
+        if (off + rdlen > len) break;
+        if (type == 1 && klass == 1 && rdlen == 4) {
+            memcpy(addr, msg + off, 4);
+            *ttl_s = ttl;
+            ok = true;
+        }
+        off += rdlen;
+    }
+    return ok;
+}
+
+static bool resolve(const char *host, uint32_t *addr, uint32_t *ttl_s)
+{
+    if (query_a(host, addr, ttl_s)) return true;
+
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(host, NULL, &hints, &res) != 0 || !res) return false;
+    *addr = ((struct sockaddr_in *)res->ai_addr)->sin_addr.s_addr;
+    *ttl_s = DNS_TTL_FALLBACK_S;
+    freeaddrinfo(res);
+    return true;
+}
+
+static void fmt_ip(uint32_t addr, char *ip, size_t n)
+{
+    const uint8_t *b = (const uint8_t *)&addr;
+    snprintf(ip, n, "%u.%u.%u.%u", b[0], b[1], b[2], b[3]);
+}
+
+bool dns_cache_lookup(const char *host, char *ip, size_t n)
+{
+    struct in_addr lit;
+    if (inet_aton(host, &lit)) {
+        snprintf(ip, n, "%s", host);
+        return true;
+    }
+
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_lock);
+    int i = find(host);
+    if (i >= 0 && now < s_tab[i].expires_us) {
+        uint32_t addr = s_tab[i].addr;
+        s_tab[i].used_us = now;
+        s_stats.hits++;
+        taskEXIT_CRITICAL(&s_lock);
+        fmt_ip(addr, ip, n);
+        return true;
+    }
+    s_stats.misses++;
+    taskEXIT_CRITICAL(&s_lock);
+
+    // resolve outside the lock: it blocks for up to a few seconds
+    uint32_t addr = 0, ttl = 0;
+    bool ok = resolve(host, &addr, &ttl);
+    int64_t t1 = esp_timer_get_time();
+    if (ttl < DNS_TTL_MIN_S) ttl = DNS_TTL_MIN_S;
+    if (ttl > DNS_TTL_MAX_S) ttl = DNS_TTL_MAX_S;
+
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.resolve_us += t1 - now;
+    i = find(host);
+    if (ok) {
+        if (i < 0) {
+            // empty slot, else least recently used
+            i = 0;
+            for (int k = 0; k < DNS_CACHE_SIZE; ++k) {
+                if (!s_tab[k].addr) { i = k; break; }
+                if (s_tab[k].used_us < s_tab[i].used_us) i = k;
+            }
+            strncpy(s_tab[i].host, host, sizeof(s_tab[i].host) - 1);
+            s_tab[i].host[sizeof(s_tab[i].host) - 1] = 0;
+        }
+        s_tab[i].addr = addr;
+        s_tab[i].ttl_s = ttl;
+        s_tab[i].expires_us = t1 + (int64_t)ttl * 1000000LL;
+        s_tab[i].used_us = t1;
+    } else if (i >= 0 && t1 - s_tab[i].expires_us < (int64_t)DNS_LKG_MAX_S * 1000000LL) {
+        addr = s_tab[i].addr;   // last-known-good
+        s_tab[i].used_us = t1;
+        s_stats.stale++;
+        ok = true;
+    } else {
+        s_stats.failures++;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (ok) fmt_ip(addr, ip, n);
+    else ESP_LOGW(TAG, "Cannot resolve %s", host);
+    return ok;
+}
+
+void dns_cache_expire(const char *host)
+{
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_lock);
+    int i = find(host);
+    if (i >= 0 && s_tab[i].expires_us > now) s_tab[i].expires_us = now;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void dns_cache_get_stats(dns_cache_stats_t *st)
+{
+    if (!st) return;
+    taskENTER_CRITICAL(&s_lock);
+    *st = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+int dns_cache_format_stats(char *buf, size_t n)
+{
+    dns_cache_stats_t st;
+    dns_cache_get_stats(&st);
+    int len = snprintf(buf, n, "hits=%u misses=%u avg_ms=%lld lkg=%u fail=%u",
+                       (unsigned)st.hits, (unsigned)st.misses,
+                       (long long)(st.misses ? st.resolve_us / st.misses / 1000 : 0),
+                       (unsigned)st.stale, (unsigned)st.failures);
+    return (n && len >= (int)n) ? (int)n - 1 : len;
+}
+
+void dns_cache_log_stats(void)
+{
+    dns_cache_stats_t st;
+    dns_entry_t tab[DNS_CACHE_SIZE];
+    taskENTER_CRITICAL(&s_lock);
+    st = s_stats;
+    memcpy(tab, s_tab, sizeof(tab));
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (!st.hits && !st.misses) return;
+    ESP_LOGI(TAG, "dns: %u hit(s), %u miss(es) (avg %lld ms), %u last-known-good, %u failure(s), %u reply(ies) rejected",
+             (unsigned)st.hits, (unsigned)st.misses,
+             (long long)(st.misses ? st.resolve_us / st.misses / 1000 : 0),
+             (unsigned)st.stale, (unsigned)st.failures, (unsigned)st.rejected);
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < DNS_CACHE_SIZE; ++i) {
+        if (!tab[i].addr) continue;
+        char ip[16];
+        fmt_ip(tab[i].addr, ip, sizeof(ip));
+        ESP_LOGI(TAG, "  %s -> %s ttl %u s, %lld s left", tab[i].host, ip, (unsigned)tab[i].ttl_s,
+                 (long long)((tab[i].expires_us - now) / 1000000LL));
+    }
+}
@@ -0,0 +1,38 @@
+//dns_cache.h
+// Small TTL-respecting IPv4 cache for the ingest hosts, with last-known-good fallback
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DNS_CACHE_SIZE 4
+
+typedef struct {
+    uint32_t hits;        // answered from a fresh entry
+    uint32_t misses;      // had to resolve (expired or unknown)
+    uint32_t stale;       // resolution failed, answered with the last-known-good address
+    uint32_t failures;    // resolution failed and nothing was cached
+    uint32_t rejected;    // DNS replies skipped: wrong id or not our question
+    int64_t  resolve_us;  // total time spent resolving on misses
+} dns_cache_stats_t;
+
+/* Dotted IPv4 address for host into ip (at least 16 bytes).
+   A fresh entry answers without touching the network; otherwise the name is
+   resolved and cached for the record's TTL (clamped to DNS_TTL_MIN_S ..
+   DNS_TTL_MAX_S). If that fails, an expired address is returned for up to
+   DNS_LKG_MAX_S. IP literals are copied as-is. Returns false if no address. */
+bool dns_cache_lookup(const char *host, char *ip, size_t n);
+
+// Mark host's entry expired (e.g. a connect to it failed) so the next lookup
+// re-resolves; the address stays as the last-known-good fallback
+void dns_cache_expire(const char *host);
+
+void dns_cache_get_stats(dns_cache_stats_t *st);
+
+// The counters as one header-safe line for the server:
+//   "hits=12 misses=3 avg_ms=41 lkg=0 fail=0"
+// Returns the length (truncated to n-1 like snprintf)
+int dns_cache_format_stats(char *buf, size_t n);
+
+// One log line with the counters and the cached entries
+void dns_cache_log_stats(void);
@@ -0,0 +1,307 @@
+//endpoints.c
+//Scores the configured ingest servers from live request outcomes
+/*
+score (ms, lower is better) = rtt EWMA + err EWMA * ERR_PENALTY + prio * PRIO_PENALTY
+
+- rtt:  EWMA of successful request round-trips (seeded with RTT_SEED_MS)
+- err:  EWMA of failures, 0..1, so a dead server quickly scores ~5 s worse
+- prio: configured preference; one level is worth PRIO_PENALTY_MS of RTT
+Switching needs the new score to beat the current one by SWITCH_MARGIN,
+so two similar servers do not flap. Endpoints whose circuit breaker is
+open (breaker.c) are skipped until their backoff expires.
+
+Confidence in an endpoint's err decays with the time since its last report:
+    conf = exp(-age / EP_CONF_TAU_US)
+The score used to decide on a re-probe counts err * conf, so a failed
+server drifts back towards its rtt + prio. An idle endpoint is re-probed
+once that decayed score could beat the current one, or once conf drops
+under EP_CONF_MIN (stats too old to trust at all). A fresh report first
+ages the old err by conf, so one good probe after a long silence is enough.
+
+Selection is per sink: endpoints of one sink are failover alternatives for
+the same destination, and every sink gets its own copy of each reading.
+*/
+#include "endpoints.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "nvs_kv.h"
+#include "breaker.h"
+#include "sample_q.h"   // SQ_SINKS
+
+static const char *TAG = "endpoints";
+
+#define EP_ALPHA          0.2f
+#define RTT_SEED_MS       1000.0f
+#define ERR_PENALTY_MS    5000.0f
+#define PRIO_PENALTY_MS   250.0f
+#define SWITCH_MARGIN     0.8f                      // new score must be < 80% of current
+#define EP_CONF_TAU_US    (3LL * 60LL * 1000000LL)  // err evidence fades by 1/e every 3 min
+#define EP_CONF_MIN       0.05f                     // ~3 tau (9 min): re-probe regardless
+
+typedef struct {
+    char     base[128];
+    bool     tls;
+    uint8_t  proto;      // ep_proto_t
+    uint8_t  prio;
+    uint8_t  sink;       // delivery destination, 0..SQ_SINKS-1
+    float    rtt_ms;     // EWMA of successful round-trips
+    float    err;        // EWMA of failures (0..1)
+    uint32_t ok, fail;
+    int64_t  last_us;    // esp_timer time of the last report (0 = never)
+    breaker_t brk;
+} endpoint_t;
+
+static endpoint_t s_ep[EP_MAX];
+static int s_n = 0;
+// late boot probes may still report while the uploader does
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void ep_add(const char *base, int prio, int sink)
+{
+    if (s_n >= EP_MAX || !base[0]) return;
+    endpoint_t *e = &s_ep[s_n++];
+    memset(e, 0, sizeof(*e));
+    strncpy(e->base, base, sizeof(e->base) - 1);
+    e->tls = strncmp(base, "https://", 8) == 0 || strncmp(base, "mqtts://", 8) == 0 ||
+             strncmp(base, "wss://", 6) == 0;
+    e->proto = strncmp(base, "mqtt", 4) == 0 ? EP_MQTT :
+               strncmp(base, "ws", 2) == 0   ? EP_WS :
+               strncmp(base, "coap", 4) == 0 ? EP_COAP : EP_HTTP;
+    e->prio = (uint8_t)(prio < 0 ? 0 : prio > 255 ? 255 : prio);
+    e->sink = (uint8_t)(sink < 0 ? 0 : sink >= SQ_SINKS ? SQ_SINKS - 1 : sink);
+    e->rtt_ms = RTT_SEED_MS;
+    brk_init(&e->brk);
+}
+
+int ep_load(const char *const *defaults, int n)
+{
+    char cfg[EP_MAX * 136];
+    s_n = 0;
+    if (kv_get_str("endpoints", cfg, sizeof(cfg)) == 0) {
+        // "<prio>[@<sink>]=<base>;..." parsed in place
+        for (char *tok = strtok(cfg, ";"); tok; tok = strtok(NULL, ";")) {
+            char *eq = strchr(tok, '=');
+            if (!eq) continue;
+            *eq = 0;
+            char *at = strchr(tok, '@');
+            ep_add(eq + 1, atoi(tok), at ? atoi(at + 1) : 0);
+        }
+    }
+    if (s_n == 0) {
+        // every built-in base is its own destination: LOCAL and CLOUD both get each reading
+        for (int i = 0; i < n; ++i) ep_add(defaults[i], i, i);
+        ESP_LOGI(TAG, "Using %d built-in endpoint(s)", s_n);
+    } else {
+        ESP_LOGI(TAG, "Loaded %d endpoint(s) from NVS", s_n);
+    }
+    // number sinks densely (e.g. "@0" and "@3" → 0 and 1) so none is left without endpoints
+    uint8_t map[SQ_SINKS];
+    memset(map, 0xFF, sizeof(map));
+    for (int k = 0, next = 0; k < SQ_SINKS; ++k) {
+        for (int i = 0; i < s_n; ++i) if (s_ep[i].sink == k) { map[k] = (uint8_t)next++; break; }
+    }
+    for (int i = 0; i < s_n; ++i) s_ep[i].sink = map[s_ep[i].sink];
+
+    // keep the table in preference order (stable), so index 0 is tried first
+    for (int i = 1; i < s_n; ++i) {
+        endpoint_t e = s_ep[i];
+        int j = i;
+        for (; j > 0 && s_ep[j - 1].prio > e.prio; --j) s_ep[j] = s_ep[j - 1];
+        s_ep[j] = e;
+    }
+    return s_n;
+}
+
+int ep_count(void) { return s_n; }
+
+int ep_sinks(void)
+{
+    int n = 1;
+    for (int i = 0; i < s_n; ++i) if (s_ep[i].sink + 1 > n) n = s_ep[i].sink + 1;
+    return n;
+}
+
+int ep_sink(int i) { return (i >= 0 && i < s_n) ? s_ep[i].sink : -1; }
+
+const char *ep_base(int i) { return (i >= 0 && i < s_n) ? s_ep[i].base : ""; }
+
+bool ep_tls(int i) { return (i >= 0 && i < s_n) && s_ep[i].tls; }
+
+ep_proto_t ep_proto(int i) { return (i >= 0 && i < s_n) ? (ep_proto_t)s_ep[i].proto : EP_HTTP; }
+
+// Weight of i's stats now: 1 right after a report, fading to 0 (never reported: 0)
+static float conf(const endpoint_t *e, int64_t now_us)
+{
+    if (!e->last_us) return 0.0f;
+    return expf(-(float)(now_us - e->last_us) / (float)EP_CONF_TAU_US);
+}
+
+void ep_report(int i, bool ok, int64_t rtt_us)
+{
+    if (i < 0 || i >= s_n) return;
+    int64_t now = esp_timer_get_time();
+    endpoint_t *e = &s_ep[i];
+    uint32_t rnd = esp_random();
+    taskENTER_CRITICAL(&s_lock);
+    e->err *= conf(e, now);   // age the old evidence first
+    if (ok) {
+        e->ok++;
+        e->rtt_ms += EP_ALPHA * ((float)rtt_us / 1000.0f - e->rtt_ms);
+        brk_success(&e->brk);
+    } else {
+        e->fail++;
+        brk_failure(&e->brk, now, rnd);
+    }
+    e->err += EP_ALPHA * ((ok ? 0.0f : 1.0f) - e->err);
+    e->last_us = now;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+bool ep_allow(int i, int64_t now_us)
+{
+    if (i < 0 || i >= s_n) return false;
+    taskENTER_CRITICAL(&s_lock);
+    bool ok = brk_allow(&s_ep[i].brk, now_us);
+    taskEXIT_CRITICAL(&s_lock);
+    return ok;
+}
+
+bool ep_ready(int i, int64_t now_us)
+{
+    if (i < 0 || i >= s_n) return false;
+    taskENTER_CRITICAL(&s_lock);
+    bool ok = brk_ready(&s_ep[i].brk, now_us);
+    taskEXIT_CRITICAL(&s_lock);
+    return ok;
+}
+
+void ep_release(int i)
+{
+    if (i < 0 || i >= s_n) return;
+    taskENTER_CRITICAL(&s_lock);
+    brk_release(&s_ep[i].brk);
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+int64_t ep_retry_in_us(int i, int64_t now_us)
+{
+    if (i < 0 || i >= s_n) return 0;
+    taskENTER_CRITICAL(&s_lock);
+    int64_t t = brk_retry_in(&s_ep[i].brk, now_us);
+    taskEXIT_CRITICAL(&s_lock);
+    return t;
+}
+
+// c scales the error term: 1 for the measured score, conf() for the decayed one
+static float score_at(const endpoint_t *e, float c)
+{
+    return e->rtt_ms + e->err * c * ERR_PENALTY_MS + e->prio * PRIO_PENALTY_MS;
+}
+
+static float score(const endpoint_t *e) { return score_at(e, 1.0f); }
+
+int ep_best(int sink, int current)
+{
+    if (s_n == 0) return -1;
+    float sc[EP_MAX];
+    bool  open[EP_MAX];
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < s_n; ++i) {
+        sc[i] = score(&s_ep[i]);
+        open[i] = brk_retry_in(&s_ep[i].brk, now) > 0;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    // breaker-open endpoints only count when every endpoint of the sink is open
+    int best = -1, first = -1;
+    for (int i = 0; i < s_n; ++i) {
+        if (s_ep[i].sink != sink) continue;
+        if (first < 0) first = i;
+        if (open[i]) continue;
+        if (best < 0 || sc[i] < sc[best]) best = i;
+    }
+    if (current >= 0 && (current >= s_n || s_ep[current].sink != sink)) current = -1;
+    if (best < 0) return current >= 0 ? current : first;
+    if (current >= 0 && current < s_n && best != current && !open[current] &&
+        sc[best] >= SWITCH_MARGIN * sc[current]) {
+        return current;  // not clearly better → stay
+    }
+    return best;
+}
+
+// Time until idle endpoint e is worth a probe against threshold `beat` (a
+// score it has to undercut): 0 = now, -1 = not a candidate. Call under s_lock.
+static int64_t probe_due_in(const endpoint_t *e, float beat, int64_t now_us)
+{
+    if (e->brk.state == BRK_HALF_OPEN) return -1;   // a trial is already out
+    int64_t backoff = brk_retry_in(&e->brk, now_us);
+    if (!e->last_us) return backoff;
+    int64_t age = now_us - e->last_us;
+    // when conf falls under EP_CONF_MIN
+    int64_t due = (int64_t)(-logf(EP_CONF_MIN) * (float)EP_CONF_TAU_US) - age;
+    // when err * conf * ERR_PENALTY_MS shrinks enough for the decayed score to undercut `beat`
+    float room = beat - score_at(e, 0.0f);
+    float pen = e->err * ERR_PENALTY_MS;
+    if (room > 0.0f) {
+        int64_t cross = pen <= room ? 0 : (int64_t)(logf(pen / room) * (float)EP_CONF_TAU_US) - age;
+        if (cross < due) due = cross;
+    }
+    if (due < 0) due = 0;
+    return backoff > due ? backoff : due;
+}
+
+int ep_next_probe(int sink, int current, int64_t now_us)
+{
+    int pick = -1;
+    float pick_sc = 0.0f;
+    taskENTER_CRITICAL(&s_lock);
+    float beat = (current >= 0 && current < s_n) ? SWITCH_MARGIN * score(&s_ep[current]) : INFINITY;
+    for (int i = 0; i < s_n; ++i) {
+        const endpoint_t *e = &s_ep[i];
+        if (i == current || e->sink != sink) continue;
+        if (probe_due_in(e, beat, now_us) != 0) continue;
+        // most promising first; ties (e.g. never probed) go to the stalest
+        float sc = score_at(e, conf(e, now_us));
+        if (pick < 0 || sc < pick_sc || (sc == pick_sc && e->last_us < s_ep[pick].last_us)) {
+            pick = i;
+            pick_sc = sc;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return pick;
+}
+
+int64_t ep_probe_in_us(int sink, int current, int64_t now_us)
+{
+    int64_t next = -1;
+    taskENTER_CRITICAL(&s_lock);
+    float beat = (current >= 0 && current < s_n) ? SWITCH_MARGIN * score(&s_ep[current]) : INFINITY;
+    for (int i = 0; i < s_n; ++i) {
+        if (i == current || s_ep[i].sink != sink) continue;
+        int64_t t = probe_due_in(&s_ep[i], beat, now_us);
+        if (t >= 0 && (next < 0 || t < next)) next = t;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return next;
+}
+
+void ep_log_stats(int sink, int current)
+{
+    for (int i = 0; i < s_n; ++i) {
+        const endpoint_t *e = &s_ep[i];
+        if (e->sink != sink) continue;
+        ESP_LOGI(TAG, "%c[%d] sink %d %s prio %u rtt %.0f ms err %.2f ok %u fail %u score %.0f, breaker %s (trips %u, denied %u, lost trials %u, retry in %lld s)",
+                 i == current ? '*' : ' ', i, sink, e->base, (unsigned)e->prio, e->rtt_ms, e->err,
+                 (unsigned)e->ok, (unsigned)e->fail, score(e),
+                 brk_state_name(e->brk.state), (unsigned)e->brk.trips, (unsigned)e->brk.denied, (unsigned)e->brk.lost,
+                 (long long)(brk_retry_in(&e->brk, esp_timer_get_time()) / 1000000LL));
+    }
+}
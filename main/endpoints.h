@@ -0,0 +1,68 @@
+//endpoints.h
+// Table of ingest servers with live RTT / error scoring
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#define EP_MAX 4
+
+// Uplink protocol, from the base's scheme
+typedef enum {
+    EP_HTTP = 0,   // http://, https://  (POST /ingest over a keep-alive session)
+    EP_MQTT,       // mqtt://, mqtts://  (QoS1 publishes over a persistent session, mqtt_up.h)
+    EP_WS,         // ws://, wss://      (frames streamed over one WebSocket, ws_up.h)
+    EP_COAP,       // coap://            (confirmable POSTs over UDP, coap_up.h; LAN only, no DTLS)
+} ep_proto_t;
+
+/* Load the table from NVS key "endpoints":
+     "<prio>[@<sink>]=<base>;..."   e.g. "0=http://172.16.0.123:3000;1@1=https://host"
+   e.g. "0=mqtt://172.16.0.123:1883" sends sink 0 over MQTT instead of HTTP.
+   Lower prio is preferred. The sink (default 0) is the delivery destination:
+   endpoints sharing a sink are failover alternatives, and each sink gets
+   every reading (mirroring). If the key is missing or unparsable, the n
+   compiled-in defaults are used with priorities 0..n-1, each its own sink.
+   The table is kept sorted by prio, so index order is preference order.
+   Returns the count. */
+int ep_load(const char *const *defaults, int n);
+
+int         ep_count(void);
+const char *ep_base(int i);
+bool        ep_tls(int i);     // base starts with https://, mqtts:// or wss://
+ep_proto_t  ep_proto(int i);
+int         ep_sink(int i);
+
+// Number of sinks in use (highest sink + 1, at least 1)
+int ep_sinks(void);
+
+// Feed the outcome of one request to endpoint i (rtt_us only used when ok)
+void ep_report(int i, bool ok, int64_t rtt_us);
+
+// Circuit breaker gate (breaker.h): may a request to i go now? An expired
+// backoff turns into the one half-open trial, so only ask right before
+// sending, and end every path after a yes with ep_report or ep_release.
+bool ep_allow(int i, int64_t now_us);
+
+// Would ep_allow say yes? Takes no trial: for gating work before the send.
+bool ep_ready(int i, int64_t now_us);
+
+// After an ep_allow yes that sent nothing (or got a neutral answer): hands
+// a half-open trial back; the score is left alone
+void ep_release(int i);
+
+// How long until i's breaker lets a request through (0 = now)
+int64_t ep_retry_in_us(int i, int64_t now_us);
+
+// Best endpoint of `sink` by score, skipping breaker-open ones;
+// stays on `current` unless another is clearly better
+int ep_best(int sink, int current);
+
+// Another endpoint of `sink` worth a probe now, or -1: not backing off, and
+// either its score with decayed errors could beat `current`'s or its stats
+// are too old to trust (see endpoints.c)
+int ep_next_probe(int sink, int current, int64_t now_us);
+
+// Time until ep_next_probe has a candidate (0 = now, -1 = none)
+int64_t ep_probe_in_us(int sink, int current, int64_t now_us);
+
+// One log line per endpoint of `sink`; `current` is marked with '*'
+void ep_log_stats(int sink, int current);
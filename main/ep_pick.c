@@ -0,0 +1,128 @@
+//ep_pick.c
+//Parallel /health probes at boot and the per-sink choice between them
+/*
+Every endpoint is probed in parallel, one short-lived task each, so a dead
+LAN server no longer delays the others by its full timeout.
+
+Probes can't be aborted once started: esp_http_client (and the MQTT/CoAP
+probes) block in connect/handshake and aren't safe to close from another
+task. So the work left behind after a pick is bounded instead: boot probes
+use a shorter timeout, and the ones still running are counted and logged
+with how long they outlived the pick (each holds its 8 KB stack till then).
+*/
+#include "ep_pick.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "endpoints.h"
+#include "sample_q.h"   // SQ_SINKS
+
+static const char *TAG = "ep_pick";
+
+#define PROBE_DONE(i)  (1u << (2 * (i)))
+#define PROBE_OK(i)    (1u << (2 * (i) + 1))
+
+static EventGroupHandle_t s_probe_evt = NULL;
+static ep_pick_probe_t s_probe = NULL;
+static volatile uint32_t s_probe_gen = 0;   // bumped when a pick finishes; late results are ignored
+static volatile int64_t  s_probe_end_us = 0; // when the last pick finished
+static atomic_int s_probe_live = 0;         // probe tasks still running
+
+// arg packs (round << 4) | candidate index
+static void task_probe(void *arg){
+    uint32_t v = (uint32_t)(uintptr_t)arg;
+    int i = (int)(v & 0xF);
+    bool ok = s_probe(i, EP_PICK_TIMEOUT_MS);
+    if ((v >> 4) == s_probe_gen) {
+        xEventGroupSetBits(s_probe_evt, PROBE_DONE(i) | (ok ? PROBE_OK(i) : 0));
+    } else {
+        // outlived the pick: this is the leaked work
+        ESP_LOGI(TAG, "probe ep%d (%s) finished %lld ms after the pick; ignored", i,
+                 ok ? "ok" : "failed", (long long)((esp_timer_get_time() - s_probe_end_us) / 1000));
+    }
+    atomic_fetch_sub(&s_probe_live, 1);
+    vTaskDelete(NULL);
+}
+
+// Sink's winner so far: its highest-priority healthy endpoint once every
+// better one has failed, or with `late` the best healthy one answered yet.
+// *done is set when every endpoint of the sink has answered.
+static int probe_winner(EventBits_t bits, int sink, bool late, bool *done){
+    bool better_pending = false;
+    *done = true;
+    for (int i = 0; i < ep_count(); ++i) {
+        if (ep_sink(i) != sink) continue;
+        if ((bits & PROBE_OK(i)) && (late || !better_pending)) return i;
+        if (!(bits & PROBE_DONE(i))) { better_pending = true; *done = false; }
+    }
+    return -1;
+}
+
+int64_t ep_pick(ep_pick_probe_t probe, int sinks, int *winner){
+    // Endpoints are in priority order: LAN first, then the CLOUD server
+    const int n = ep_count();
+    const EventBits_t all = (1u << (2 * n)) - 1;
+    if (sinks > SQ_SINKS) sinks = SQ_SINKS;
+
+    if (!s_probe_evt) s_probe_evt = xEventGroupCreate();
+    xEventGroupClearBits(s_probe_evt, all);
+    s_probe = probe;
+    uint32_t gen = s_probe_gen;
+    int64_t t0 = esp_timer_get_time();
+
+    for (int i = 0; i < n; ++i) {
+        // TLS handshakes need the larger stack
+        atomic_fetch_add(&s_probe_live, 1);
+        if (xTaskCreate(task_probe, "probe", 8192, (void *)(uintptr_t)((gen << 4) | i), 5, NULL) != pdPASS) {
+            atomic_fetch_sub(&s_probe_live, 1);
+            bool ok = probe(i, EP_PICK_TIMEOUT_MS);  // no memory: probe inline
+            xEventGroupSetBits(s_probe_evt, PROBE_DONE(i) | (ok ? PROBE_OK(i) : 0));
+        }
+    }
+
+    // A sink is decided once it has a winner or all its probes failed; the
+    // grace period starts when any undecided sink has a healthy answer.
+    bool decided[SQ_SINKS] = {0};
+    for (int k = 0; k < sinks; ++k) winner[k] = -1;
+    int64_t grace_until = 0;
+    EventBits_t seen = 0;
+    for (;;) {
+        EventBits_t bits = xEventGroupGetBits(s_probe_evt);
+        int64_t now = esp_timer_get_time();
+        bool late = grace_until && now >= grace_until;
+        bool all_decided = true, any_ok = false;
+        for (int k = 0; k < sinks; ++k) {
+            if (decided[k]) continue;
+            bool done;
+            winner[k] = probe_winner(bits, k, late, &done);
+            if (winner[k] >= 0 || done) { decided[k] = true; continue; }
+            all_decided = false;
+            bool ignored;
+            if (probe_winner(bits, k, true, &ignored) >= 0) any_ok = true;
+        }
+        if (all_decided) break;
+
+        if (any_ok && !grace_until) grace_until = now + EP_PICK_GRACE_MS * 1000LL;
+        // sleep until a new result lands (or the grace period runs out)
+        seen = bits;
+        TickType_t wait = (grace_until && !late) ? pdMS_TO_TICKS((grace_until - now) / 1000) + 1 : portMAX_DELAY;
+        xEventGroupWaitBits(s_probe_evt, all & ~seen, pdFALSE, pdFALSE, wait);
+    }
+    // cancel the rest: probes still blocked in their request finish on their
+    // own (within EP_PICK_TIMEOUT_MS) and are ignored
+    s_probe_end_us = esp_timer_get_time();
+    s_probe_gen++;
+
+    ESP_LOGI(TAG, "endpoint pick took %lld ms; %d of %d probe(s) still running (<= %d ms more)",
+             (long long)((s_probe_end_us - t0) / 1000), atomic_load(&s_probe_live), n, EP_PICK_TIMEOUT_MS);
+    return s_probe_end_us - t0;
+}
+
+int ep_pick_live(void){
+    return atomic_load(&s_probe_live);
+}
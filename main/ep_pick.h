@@ -0,0 +1,23 @@
+//ep_pick.h
+// Boot-time base selection: every endpoint probed in parallel, one winner per sink
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#define EP_PICK_GRACE_MS   1500   // how long a healthy lower-priority base waits for better ones
+#define EP_PICK_TIMEOUT_MS 4000   // per-operation timeout of a boot probe (ticks use 8 s)
+
+// One health probe of endpoint i, in its own task: true if it answered
+// (reachable, even if shedding load)
+typedef bool (*ep_pick_probe_t)(int i, int timeout_ms);
+
+/* Probes every endpoint of ep_count() at once and fills winner[k] for the
+   first `sinks` sinks: the sink's highest-priority healthy endpoint once
+   every better one has failed, or after EP_PICK_GRACE_MS the best healthy
+   one answered yet; -1 if all of the sink's endpoints failed. Returns the
+   time the pick took, in us. Probes still running are left to finish on
+   their own (within EP_PICK_TIMEOUT_MS) and their results are ignored. */
+int64_t ep_pick(ep_pick_probe_t probe, int sinks, int *winner);
+
+// Probe tasks still running, of this pick or earlier ones
+int ep_pick_live(void);
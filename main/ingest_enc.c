@@ -0,0 +1,154 @@
+//ingest_enc.c
+//Encodes batches of readings for POST bodies (JSON or compact binary)
+#include "ingest_enc.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+int ingest_enc_json(char *dst, size_t cap, const char *device_id, const reading_t *rs, int n)
+{
+    int len = snprintf(dst, cap, "{\"device_id\":\"%s\",\"readings\":[", device_id);
+    for (int i = 0; i < n && len > 0 && len < (int)cap; ++i) {
+        len += snprintf(dst + len, cap - len,
+                        "%s{\"temp_c\":%.2f,\"sr\":%u,\"ch\":%u,\"ts_ms\":%lld}",
+                        i ? "," : "", rs[i].t_c, (unsigned)rs[i].sr, (unsigned)rs[i].ch,
+                        (long long)rs[i].ts_ms_utc);
+    }
+    if (len > 0 && len < (int)cap) len += snprintf(dst + len, cap - len, "]}");
+    // snprintf truncated somewhere → caller's buffer is too small
+    return (len < 0 || len >= (int)cap) ? -1 : len;
+}
+
+// little-endian writers; the wire order does not depend on the CPU
+static uint8_t *put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_u64(uint8_t *p, uint64_t v)
+{
+    for (int i = 0; i < 8; ++i) p[i] = (uint8_t)(v >> (8 * i));
+    return p + 8;
+}
+
+// LEB128: 7 bits per byte, high bit set on all but the last
+static uint8_t *put_varint(uint8_t *p, uint64_t v)
+{
+    while (v >= 0x80) { *p++ = (uint8_t)(v | 0x80); v >>= 7; }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+// zigzag maps small negative and positive deltas to small unsigned values
+static uint8_t *put_zz(uint8_t *p, int64_t v)
+{
+    return put_varint(p, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+// 'F' 'M' | fmt | id_len | device_id
+static uint8_t *put_header(uint8_t *p, uint8_t fmt, const char *device_id, size_t id_len)
+{
+    *p++ = 'F'; *p++ = 'M';
+    *p++ = fmt;
+    *p++ = (uint8_t)id_len;
+    memcpy(p, device_id, id_len);
+    return p + id_len;
+}
+
+// temperature in the sensor's native 1/128 °C steps
+static int32_t temp_q7(float t_c)
+{
+    return (int32_t)lroundf(t_c * 128.0f);
+}
+
+// the older channel-less formats are kept for single-probe batches
+static bool multi_channel(const reading_t *rs, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        if (rs[i].ch) return true;
+    }
+    return false;
+}
+
+// previous reading of rs[i]'s channel, or -1
+static int prev_same_ch(const reading_t *rs, int i)
+{
+    for (int j = i - 1; j >= 0; --j) {
+        if (rs[j].ch == rs[i].ch) return j;
+    }
+    return -1;
+}
+
+int ingest_enc_bin(uint8_t *dst, size_t cap, const char *device_id, const reading_t *rs, int n)
+{
+    size_t id_len = strlen(device_id);
+    if (id_len > 255 || n < 0 || n > 0xFFFF) return -1;
+    bool chs = multi_channel(rs, n);
+    size_t rec = chs ? INGEST_BIN_CH_REC_SIZE : INGEST_BIN_REC_SIZE;
+    if (cap < 2 + 1 + 1 + id_len + 2 + (size_t)n * rec) return -1;
+
+    uint8_t *p = put_header(dst, chs ? INGEST_BIN_FMT_CH_RECORDS : INGEST_BIN_FMT_RECORDS,
+                            device_id, id_len);
+    p = put_u16(p, (uint16_t)n);
+
+    for (int i = 0; i < n; ++i) {
+        // centi-degrees, same resolution as the JSON "%.2f"; clamp to int16
+        float c = roundf(rs[i].t_c * 100.0f);
+        if (c > 32767.0f)  c = 32767.0f;
+        if (c < -32768.0f) c = -32768.0f;
+
+        p = put_u64(p, (uint64_t)rs[i].ts_ms_utc);
+        p = put_u16(p, (uint16_t)(int16_t)c);
+        *p++ = rs[i].sr;
+        if (chs) *p++ = rs[i].ch;
+    }
+    return (int)(p - dst);
+}
+
+int ingest_enc_delta(uint8_t *dst, size_t cap, const char *device_id, const reading_t *rs, int n,
+                     uint32_t period_ms)
+{
+    size_t id_len = strlen(device_id);
+    if (id_len > 255 || n < 1 || n > 0xFFFF) return -1;
+    // worst case for every varint, so the writers below never overrun
+    if (cap < INGEST_DELTA_MAX((size_t)n) - (255 - id_len)) return -1;
+
+    bool chs = multi_channel(rs, n);
+    uint8_t *p = put_header(dst, chs ? INGEST_BIN_FMT_CH_DELTA : INGEST_BIN_FMT_DELTA,
+                            device_id, id_len);
+    p = put_varint(p, (uint64_t)n);
+    p = put_u64(p, (uint64_t)rs[0].ts_ms_utc);
+    p = put_zz(p, temp_q7(rs[0].t_c));
+    p = put_varint(p, period_ms);
+
+    // channel column (fmt 4), run-length encoded like sr below
+    for (int i = 0; chs && i < n; ) {
+        int run = 1;
+        while (i + run < n && rs[i + run].ch == rs[i].ch) run++;
+        *p++ = rs[i].ch;
+        p = put_varint(p, (uint64_t)run);
+        i += run;
+    }
+    // timestamp column: deviation from the nominal period, usually 0 or a few ms
+    for (int i = 1; i < n; ++i) {
+        int j = chs ? prev_same_ch(rs, i) : i - 1;
+        p = put_zz(p, j < 0 ? rs[i].ts_ms_utc - rs[0].ts_ms_utc
+                            : rs[i].ts_ms_utc - rs[j].ts_ms_utc - (int64_t)period_ms);
+    }
+    // temperature column: change since the previous reading in 1/128 °C
+    for (int i = 1; i < n; ++i) {
+        int j = chs ? prev_same_ch(rs, i) : i - 1;
+        p = put_zz(p, (int64_t)temp_q7(rs[i].t_c) - temp_q7(rs[j < 0 ? 0 : j].t_c));
+    }
+    // fault byte column, run-length encoded (almost always one run of 0)
+    for (int i = 0; i < n; ) {
+        int run = 1;
+        while (i + run < n && rs[i + run].sr == rs[i].sr) run++;
+        *p++ = rs[i].sr;
+        p = put_varint(p, (uint64_t)run);
+        i += run;
+    }
+    return (int)(p - dst);
+}
@@ -0,0 +1,59 @@
+//ingest_enc.h
+// Body encoders for batched POSTs of queued readings
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "reading.h"
+
+// Wire formats selectable with INGEST_FORMAT
+#define INGEST_FMT_JSON 0   // application/json, readings as an array
+#define INGEST_FMT_BIN  1   // application/octet-stream, fixed records
+#define INGEST_FMT_DELTA 2  // application/octet-stream, delta/varint columns
+
+/* Compact binary batch, all multi-byte fields little-endian:
+     'F' 'M' | fmt=1 | id_len | device_id[id_len] | count:u16 | count x record
+     record  = ts_ms:i64 | temp:i16 (0.01 °C) | sr:u8        -> 11 bytes
+   device_id is sent once per batch instead of once per reading. */
+#define INGEST_BIN_FMT_RECORDS 1
+#define INGEST_BIN_HDR_MAX     (2 + 1 + 1 + 255 + 2)
+#define INGEST_BIN_REC_SIZE    11
+#define INGEST_BIN_MAX(n)      (INGEST_BIN_HDR_MAX + (n) * INGEST_BIN_CH_REC_SIZE)
+
+/* Multi-channel batches (any reading with ch != 0) use fmt=3, the same
+   layout with the channel appended:
+     record  = ts_ms:i64 | temp:i16 (0.01 °C) | sr:u8 | ch:u8   -> 12 bytes
+   Single-probe units keep sending fmt=1. */
+#define INGEST_BIN_FMT_CH_RECORDS 3
+#define INGEST_BIN_CH_REC_SIZE    12
+
+/* Delta batch for backlog drains, same 'F' 'M' | fmt | id_len | device_id
+   header with fmt=2, then (varint = LEB128, zz = zigzag varint):
+     count:varint | base_ts:i64 | base_temp:zz (1/128 °C) | period_ms:varint
+     (count-1) x ts delta:zz      (ms, minus period_ms)
+     (count-1) x temp delta:zz    (1/128 °C, the MAX31856 LSB)
+     sr runs: { sr:u8 | run:varint } until count readings are covered
+   A steady backlog costs ~3 bytes per reading. */
+#define INGEST_BIN_FMT_DELTA   2
+#define INGEST_DELTA_MAX(n)    (INGEST_BIN_HDR_MAX + 3 + 8 + 5 + 5 + (n) * (10 + 5 + 4 + 4))
+
+/* Multi-channel delta, fmt=4: the channels take turns within a sweep, so
+   each reading is a delta from the previous reading of the *same* channel
+   (from the base, for a channel's first reading):
+     count:varint | base_ts:i64 | base_temp:zz | period_ms:varint
+     ch runs: { ch:u8 | run:varint } until count readings are covered
+     (count-1) x ts delta:zz      (ms, minus period_ms if not the channel's first)
+     (count-1) x temp delta:zz    (1/128 °C)
+     sr runs, as fmt=2
+   The channel column comes first so a decoder knows whose delta it reads. */
+#define INGEST_BIN_FMT_CH_DELTA 4
+
+// JSON needs ~60 bytes per reading plus the envelope
+#define INGEST_JSON_MAX(n)     (96 + (n) * 64)
+
+// Both return the encoded length, or -1 if dst is too small.
+// JSON: {"device_id":"...","readings":[{"temp_c":..,"sr":..,"ch":..,"ts_ms":..},...]}
+int ingest_enc_json(char *dst, size_t cap, const char *device_id, const reading_t *rs, int n);
+int ingest_enc_bin(uint8_t *dst, size_t cap, const char *device_id, const reading_t *rs, int n);
+// period_ms is the nominal sample spacing subtracted from every ts delta
+int ingest_enc_delta(uint8_t *dst, size_t cap, const char *device_id, const reading_t *rs, int n,
+                     uint32_t period_ms);
@@ -4,18 +4,34 @@
 https://github.com/adafruit/Adafruit_MAX31856/blob/master/Adafruit_MAX31856.h
 https://www.analog.com/media/en/technical-documentation/data-sheets/max31856.pdf
 */
+/*
+Several chips share one SPI bus, one CS GPIO each. The bus carries a
+single spi_device with no hardware CS; each transaction names its chip in
+t->user and the pre/post callbacks drive that chip's CS pin. That way the
+channel count is limited by GPIOs, not by the host's CS lines (SPI2 has
+six), and queued transactions select the right chip too.
+Single accesses are polling transactions: a few bytes at 1 MHz take less
+time than the interrupt and task wake-up of a queued one. A sweep queues
+one burst read per chip and collects them in one pass, so the bus runs
+them back to back and the task wakes once. All 5-byte transfers fit the
+64-byte FIFO, so the bus stays without DMA (no descriptors, no bounce
+buffers). All SPI comes from one task (task_sensor); init runs before it
+and max31856_drdy_enable (which reads the chip) runs in it.
+*/
 #include "max31856.h"
 #include "esp_log.h"
 #include <string.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "hal/gpio_ll.h"      // register-level GPIO: callable from an IRAM ISR
+#include "soc/gpio_struct.h"
 
 static const char *TAG = "MAX31856_DRV";
-static spi_device_handle_t s_dev = NULL;
 
-// Calibration & sanity window (driver-local)
-#define CALIBRATION_OFFSET 0.0f
+// Sanity window (driver-local); the calibration offset is per channel (max31856_cfg_t)
 #define TEMP_MIN_C  (-100.0f)
 #define TEMP_MAX_C  (100.0f)
 
@@ -57,9 +73,69 @@ static spi_device_handle_t s_dev = NULL;
 #define SR_TCRANGE  (1u << 6)
 #define SR_CJRANGE  (1u << 7)
 
+#define SHADOW_N (REG_CJTO + 1)
+
+struct max31856_dev {
+    int            ch;            // index in s_devs, the reading's channel
+    max31856_cfg_t cfg;
+
+    // Shadow of the configuration registers (CR0..CJTO) as last written or
+    // read back, so a write that would not change anything is skipped
+    uint8_t shadow[SHADOW_N];
+    bool    shadow_ok;
+
+    max31856_spi_stats_t stats;
+
+    // DRDY: written by the ISR, read by the acquisition task
+    TaskHandle_t      drdy_task;
+    uint32_t          drdy_bits;
+    volatile int64_t  drdy_us;     // last edge (first interrupt of the low level)
+    volatile uint32_t drdy_edges;  // interrupts taken, one per conversion
+    uint32_t          drdy_reads;
+    uint8_t           last_sr;     // fault logging on change
+
+    // a sweep's burst read of this chip, in its own buffers while queued
+    spi_transaction_t sweep_t;
+    uint8_t           sweep_tx[5];
+    uint8_t           sweep_rx[5];
+    bool              sweep_done;   // its result was collected
+};
+
+static struct max31856_dev s_devs[MAX31856_MAX_CH];
+static int s_ndev = 0;
+static spi_device_handle_t s_spi = NULL;   // shared by all chips, CS by GPIO
+static max31856_sweep_stats_t s_sweep;
+
 // ---------- Low-level SPI helpers ----------
-static esp_err_t write_reg(uint8_t reg, uint8_t val) {
-    if (!s_dev) return ESP_ERR_INVALID_STATE;
+// CS of the chip named in t->user, around every transaction. These run in
+// the SPI ISR, which is in IRAM: gpio_set_level is not (unless
+// CONFIG_GPIO_CTRL_FUNC_IN_IRAM), so the register is written directly.
+static void IRAM_ATTR cs_select(spi_transaction_t *t) {
+    gpio_ll_set_level(&GPIO, ((struct max31856_dev *)t->user)->cfg.cs_pin, 0);
+}
+
+static void IRAM_ATTR cs_release(spi_transaction_t *t) {
+    gpio_ll_set_level(&GPIO, ((struct max31856_dev *)t->user)->cfg.cs_pin, 1);
+}
+
+// every transaction goes through here, so the counters see all of them
+static esp_err_t xfer(max31856_handle_t h, spi_transaction_t *t) {
+    t->user = h;
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err = spi_device_polling_transmit(s_spi, t);
+    h->stats.xfers++;
+    h->stats.xfer_us += esp_timer_get_time() - t0;
+    return err;
+}
+
+static esp_err_t write_reg(max31856_handle_t h, uint8_t reg, uint8_t val) {
+    if (!h || !s_spi) return ESP_ERR_INVALID_STATE;
+    // self-clearing CR0 bits (fault clear, one-shot start) are never in the
+    // shadow, so a write carrying them always goes out
+    if (reg < SHADOW_N && h->shadow_ok && h->shadow[reg] == val) {
+        h->stats.writes_skipped++;
+        return ESP_OK;
+    }
 
     //SPI register read/write format.
     /*
@@ -71,13 +147,18 @@ static esp_err_t write_reg(uint8_t reg, uint8_t val) {
 
     uint8_t tx[2] = { (uint8_t)(0x80 | (reg & 0x7F)), val };
     spi_transaction_t t = { .length = 16, .tx_buffer = tx };
-    return spi_device_transmit(s_dev, &t);
+    esp_err_t err = xfer(h, &t);
+    h->stats.writes++;
+    if (err == ESP_OK && reg < SHADOW_N) {
+        h->shadow[reg] = reg == REG_CR0 ? (uint8_t)(val & ~(CR0_FAULTCLR | CR0_1SHOT)) : val;
+    }
+    return err;
 }
 
 
 // read_reg caps at 32 bytes to allocate fixed buffers
-static esp_err_t read_regs(uint8_t start_reg, uint8_t *dst, size_t n) {
-    if (!s_dev) return ESP_ERR_INVALID_STATE;
+static esp_err_t read_regs(max31856_handle_t h, uint8_t start_reg, uint8_t *dst, size_t n) {
+    if (!h || !s_spi) return ESP_ERR_INVALID_STATE;
     if (!dst || n == 0 || n > 32) return ESP_ERR_INVALID_ARG;
 
     uint8_t tx[1 + 32] = {0};
@@ -99,24 +180,16 @@ static esp_err_t read_regs(uint8_t start_reg, uint8_t *dst, size_t n) {
         .tx_buffer = tx,
         .rx_buffer = rx
     };
-    esp_err_t err = spi_device_transmit(s_dev, &t);
+    esp_err_t err = xfer(h, &t);
     if (err != ESP_OK) return err;
     memcpy(dst, &rx[1], n); // skip first dummy byte
     return ESP_OK;
 }
 
-static uint8_t read_reg1(uint8_t reg) {
-    uint8_t v = 0;
-    if (read_regs(reg, &v, 1) != ESP_OK) {
-        ESP_LOGE(TAG, "Read reg 0x%02X failed", reg);
-    }
-    return v;
-}
-
-static void log_faults(uint8_t sr) {
+static void log_faults(max31856_handle_t h, uint8_t sr) {
     if (!sr) return;
-    ESP_LOGW(TAG, "Fault SR=0x%02X%s%s%s%s%s%s%s%s",
-             sr,
+    ESP_LOGW(TAG, "ch%d fault SR=0x%02X%s%s%s%s%s%s%s%s",
+             h->ch, sr,
              (sr & SR_OPEN)     ? " OPEN"     : "",
              (sr & SR_OVUV)     ? " OVUV"     : "",
              (sr & SR_TCLOW)    ? " TCLOW"    : "",
@@ -128,17 +201,61 @@ static void log_faults(uint8_t sr) {
 }
 
 // ---------- Public API ----------
-void max31856_attach(spi_device_handle_t dev) {
-    s_dev = dev;
+esp_err_t max31856_add(spi_host_device_t host, const max31856_cfg_t *cfg, max31856_handle_t *out) {
+    if (!cfg || !out) return ESP_ERR_INVALID_ARG;
+    if (s_ndev >= MAX31856_MAX_CH) return ESP_ERR_NO_MEM;
+
+    gpio_config_t io = {
+        .pin_bit_mask = 1ULL << cfg->cs_pin,
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = 0, .pull_down_en = 0, .intr_type = GPIO_INTR_DISABLE
+    };
+    esp_err_t err = gpio_config(&io);
+    if (err != ESP_OK) return err;
+    gpio_set_level(cfg->cs_pin, 1);   // deselected until its first transaction
+
+    if (!s_spi) {
+        spi_device_interface_config_t devcfg = {
+            .clock_speed_hz = 1 * 1000 * 1000, // 1 MHz
+            .mode = 1,                         // MAX31856 uses SPI mode 1
+            .spics_io_num = -1,                // CS per chip, in cs_select / cs_release
+            .queue_size = MAX31856_MAX_CH,     // a sweep queues one read per chip
+            .pre_cb = cs_select,
+            .post_cb = cs_release,
+        };
+        err = spi_bus_add_device(host, &devcfg, &s_spi);
+        if (err != ESP_OK) return err;
+    }
+
+    struct max31856_dev *h = &s_devs[s_ndev];
+    memset(h, 0, sizeof(*h));
+    h->ch = s_ndev++;
+    h->cfg = *cfg;
+    *out = h;
+    return ESP_OK;
+}
+
+int max31856_channel(max31856_handle_t h) {
+    return h ? h->ch : -1;
+}
+
+// CR0 at rest: conversion mode and mains filter (1SHOT / FAULTCLR are added per write)
+static uint8_t cr0(max31856_handle_t h) {
+    return (uint8_t)((h->cfg.one_shot ? 0 : CR0_CMODE) | (h->cfg.filt_50hz ? CR0_FILT50HZ : 0));
 }
 
 // Set wide thresholds to avoid fault interrupts tripping
 // Register CJHF (HIGH) set to Address 0x7F (127) Register CJLF (LOW) set to Address 0xC0 (-64)
 // CJHF = 0x7F and CJLF = 0xC0 defines the high and the low limits.
-void max31856_init(void) {
+void max31856_init(max31856_handle_t h) {
+    if (!h) return;
+    // Seed the shadow from the chip in one burst: registers that already hold
+    // the wanted value (power-on defaults, or a warm reboot) are not rewritten
+    h->shadow_ok = read_regs(h, REG_CR0, h->shadow, SHADOW_N) == ESP_OK;
+
     // Wide thresholds
-    write_reg(REG_CJHF,   0x7F); // +127°C
-    write_reg(REG_CJLF,   0xC0); // -64°C
+    write_reg(h, REG_CJHF,   0x7F); // +127°C
+    write_reg(h, REG_CJLF,   0xC0); // -64°C
 
     // LTHFTH/LTHFTL and LTLFTH/LTLFTL define thermocouple temp high/low limits.
     // High Temperature fault limit / Low Temperature fault limit
@@ -159,54 +276,44 @@ void max31856_init(void) {
     */
 
     //High fault
-    write_reg(REG_LTHFTH, 0x7F); // TC high max
-    write_reg(REG_LTHFTL, 0xFF); // -1
+    write_reg(h, REG_LTHFTH, 0x7F); // TC high max
+    write_reg(h, REG_LTHFTL, 0xFF); // -1
 
     //Low fault
-    write_reg(REG_LTLFTH, 0x80); // TC low min
-    write_reg(REG_LTLFTL, 0x00); // 0
+    write_reg(h, REG_LTLFTH, 0x80); // TC low min
+    write_reg(h, REG_LTLFTL, 0x00); // 0
 
     // Cold-junction offset = 0
-    write_reg(REG_CJTO, 0x00);
+    write_reg(h, REG_CJTO, 0x00);
 
-    // Continuous, 60 Hz (bit0=0), T-type + AVG=2
-    write_reg(REG_CR0, CR0_CMODE);      // 0x80 continuous conversion
-    write_reg(REG_CR1, 0x10 | 0x07);    // AVG=2 | T-type averaging & t type select
+    // Continuous or one-shot, mains filter and thermocouple type / averaging per channel
+    write_reg(h, REG_CR0, cr0(h));
+    write_reg(h, REG_CR1, (uint8_t)((h->cfg.avg_sel & 0x07) << 4 | (h->cfg.tc_type & 0x0F)));
 
     //Delay for 50 ms
     vTaskDelay(pdMS_TO_TICKS(50));
 
-    // Sanity readback
-    uint8_t cr0 = read_reg1(REG_CR0);
-    uint8_t cr1 = read_reg1(REG_CR1);
-    uint8_t cjhf = read_reg1(REG_CJHF), cjlf = read_reg1(REG_CJLF);
-    uint8_t thh  = read_reg1(REG_LTHFTH), thl = read_reg1(REG_LTHFTL);
-    uint8_t tlh  = read_reg1(REG_LTLFTH), tll = read_reg1(REG_LTLFTL);
-    ESP_LOGI(TAG, "Init OK: CR0=0x%02X CR1=0x%02X | CJHF=0x%02X CJLF=0x%02X | TCH=0x%02X%02X TCL=0x%02X%02X",
-             cr0, cr1, cjhf, cjlf, thh, thl, tlh, tll);
-}
-
-
-bool max31856_get_temp_c(float *out_c, uint8_t *out_sr) {
-    //Check float pointer
-    if (!out_c) return false;
-
-    //Read the status register (Fault Bits)
-    uint8_t sr = 0;
-    if (read_regs(REG_SR, &sr, 1) != ESP_OK) {
-        ESP_LOGE(TAG, "Read SR failed");
-        return false;
+    // Sanity readback, one burst for the whole configuration block
+    uint8_t cfg[SHADOW_N] = {0};
+    if (read_regs(h, REG_CR0, cfg, SHADOW_N) != ESP_OK) {
+        ESP_LOGE(TAG, "ch%d config readback failed", h->ch);
+        h->shadow_ok = false;
+        return;
     }
-    log_faults(sr);
-    if (out_sr) *out_sr = sr;
-
-    // Read 3 bytes of thermocouple temperatures
-    uint8_t buf[3] = {0};
-    if (read_regs(REG_LTCBH, buf, 3) != ESP_OK) {
-        ESP_LOGE(TAG, "Read temp bytes failed");
-        return false;
+    if (memcmp(cfg, h->shadow, SHADOW_N) != 0) {
+        ESP_LOGW(TAG, "ch%d config readback differs from what was written", h->ch);
+        memcpy(h->shadow, cfg, SHADOW_N);   // the next write of a wrong register goes out
     }
+    h->shadow_ok = true;
+    ESP_LOGI(TAG, "ch%d (CS GPIO%d) init OK: CR0=0x%02X CR1=0x%02X | CJHF=0x%02X CJLF=0x%02X | TCH=0x%02X%02X TCL=0x%02X%02X (%u write(s) skipped)",
+             h->ch, h->cfg.cs_pin, cfg[REG_CR0], cfg[REG_CR1], cfg[REG_CJHF], cfg[REG_CJLF],
+             cfg[REG_LTHFTH], cfg[REG_LTHFTL], cfg[REG_LTLFTH], cfg[REG_LTLFTL],
+             (unsigned)h->stats.writes_skipped);
+}
+
 
+// LTCBH, LTCBM, LTCBL as read -> °C, calibration offset applied
+static float temp_decode(max31856_handle_t h, const uint8_t *buf) {
     // Pack 3 bytes into one integer
     int32_t raw = ((int32_t)buf[0] << 16) | ((int32_t)buf[1] << 8) | buf[2];
     // Align to the signed temperature value
@@ -215,28 +322,259 @@ bool max31856_get_temp_c(float *out_c, uint8_t *out_sr) {
     if (raw & 0x40000) raw |= 0xFFF80000; // sign-extend to 32-bit
 
     // Converting temperature to celsius
-    float t = (float)raw * 0.0078125f + CALIBRATION_OFFSET; // 1/128 °C
-    
+    return (float)raw * 0.0078125f + h->cfg.offset_c; // 1/128 °C
+}
+
+// After a read of the temperature registers: DRDY is high again (or, if the
+// read failed, still low and the interrupt comes straight back for a retry).
+// Wakeup and interrupt both, as drdy_isr masks both.
+static void drdy_rearm(max31856_handle_t h) {
+    if (!h->drdy_task) return;
+    gpio_wakeup_enable(h->cfg.drdy_pin, GPIO_INTR_LOW_LEVEL);
+    gpio_intr_enable(h->cfg.drdy_pin);
+}
+
+// quiet: no per-read fault / sanity logging (DRDY reads run at the conversion rate)
+static bool read_temp(max31856_handle_t h, float *out_c, uint8_t *out_sr, bool quiet) {
+    //Check float pointer
+    if (!out_c) return false;
+
+    // One burst over the contiguous LTCBH, LTCBM, LTCBL, SR (0x0C..0x0F):
+    // the temperature and the fault bits of the same conversion
+    uint8_t buf[4] = {0};
+    uint32_t x0 = h->stats.xfers;
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err = read_regs(h, REG_LTCBH, buf, 4);
+    h->stats.temp_reads++;
+    h->stats.temp_xfers += h->stats.xfers - x0;
+    h->stats.temp_us += esp_timer_get_time() - t0;
+    drdy_rearm(h);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ch%d read temp/SR failed", h->ch);
+        return false;
+    }
+
+    //Status register (Fault Bits)
+    uint8_t sr = buf[3];
+    if (!quiet) log_faults(h, sr);
+    if (out_sr) *out_sr = sr;
+
+    float t = temp_decode(h, buf);
+
     // Warning for temperature outside sanity window.
-    if (t < TEMP_MIN_C || t > TEMP_MAX_C) {
-        ESP_LOGW(TAG, "Temperature %.2f°C outside sanity window (%.1f..%.1f)!", t, TEMP_MIN_C, TEMP_MAX_C);
+    if (!quiet && (t < TEMP_MIN_C || t > TEMP_MAX_C)) {
+        ESP_LOGW(TAG, "ch%d temperature %.2f°C outside sanity window (%.1f..%.1f)!", h->ch, t, TEMP_MIN_C, TEMP_MAX_C);
     }
     *out_c = t;
     return true;
 }
 
+bool max31856_get_temp_c(max31856_handle_t h, float *out_c, uint8_t *out_sr) {
+    return h && read_temp(h, out_c, out_sr, false);
+}
+
+esp_err_t max31856_start(max31856_handle_t h) {
+    if (!h || !h->cfg.one_shot) return ESP_ERR_INVALID_STATE;
+    // 1SHOT is never in the shadow, so this always goes out
+    return write_reg(h, REG_CR0, cr0(h) | CR0_1SHOT);
+}
+
+// One-shot conversion, datasheet max: 155 ms (60 Hz) / 185 ms (50 Hz) for
+// one sample; each further averaged sample adds ~33 / 40 ms typ, taken +10%
+uint32_t max31856_conv_time_ms(max31856_handle_t h) {
+    if (!h) return 0;
+    uint32_t extra = (1u << (h->cfg.avg_sel > 4 ? 4 : h->cfg.avg_sel)) - 1;
+    return h->cfg.filt_50hz ? 185 + extra * 44 : 155 + extra * 37;
+}
+
+
+// DRDY low: stamp it and wake the acquisition task (no SPI in an ISR). The
+// interrupt is a level one and would fire again for as long as DRDY stays
+// low, so it is masked here and unmasked once the conversion is read
+// (drdy_rearm): one interrupt per conversion, stamped at its edge. The
+// light-sleep wakeup is the same level: it goes off with the mask, or an
+// unread DRDY would wake the chip again every time it tried to sleep.
+static void IRAM_ATTR drdy_isr(void *arg) {
+    struct max31856_dev *h = (struct max31856_dev *)arg;
+    gpio_ll_intr_disable(&GPIO, h->cfg.drdy_pin);   // gpio_intr_disable isn't in IRAM
+    gpio_ll_wakeup_disable(&GPIO, h->cfg.drdy_pin);
+    h->drdy_us = esp_timer_get_time();
+    h->drdy_edges++;
+    BaseType_t hpw = pdFALSE;
+    xTaskNotifyFromISR(h->drdy_task, h->drdy_bits, eSetBits, &hpw);
+    portYIELD_FROM_ISR(hpw);
+}
+
+esp_err_t max31856_drdy_enable(max31856_handle_t h, TaskHandle_t task, uint32_t bits) {
+    if (!h || !task) return ESP_ERR_INVALID_ARG;
+    if (h->cfg.drdy_pin < 0) return ESP_ERR_NOT_SUPPORTED;
+    gpio_num_t pin = h->cfg.drdy_pin;
+
+    gpio_config_t io = {
+        .pin_bit_mask = 1ULL << pin,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = 1,              // DRDY idles high
+        .pull_down_en = 0,
+        .intr_type = GPIO_INTR_DISABLE,   // armed below, once the pin is released
+    };
+    esp_err_t err = gpio_config(&io);
+    if (err != ESP_OK) return err;
+
+    // DRDY may already be low from a conversion nobody read: read it now to
+    // release the pin, so the first interrupt is a new conversion
+    float c;
+    read_temp(h, &c, NULL, true);
+    h->drdy_task = task;
+    h->drdy_bits = bits;
+    h->drdy_edges = h->drdy_reads = 0;
+
+    err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) return err;  // already installed is fine
+    err = gpio_isr_handler_add(pin, drdy_isr, h);
+    if (err != ESP_OK) return err;
+    // A low level, not the falling edge: with auto light sleep
+    // (CONFIG_PM_ENABLE) an edge while asleep is lost, so a low DRDY has to
+    // wake the chip, and gpio_wakeup_enable sets the pin's interrupt type to
+    // that level anyway. drdy_isr masks it until the read.
+    gpio_set_intr_type(pin, GPIO_INTR_LOW_LEVEL);
+    gpio_wakeup_enable(pin, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+    gpio_intr_enable(pin);
+    ESP_LOGI(TAG, "ch%d DRDY on GPIO%d", h->ch, (int)pin);
+    return ESP_OK;
+}
+
+// a conversion was read: fault logging on change only (not 10x a second), DRDY accounting
+static void conversion_read(max31856_handle_t h, uint8_t sr) {
+    if (sr != h->last_sr) log_faults(h, sr);
+    h->last_sr = sr;
+    h->drdy_reads++;
+}
+
+bool max31856_read_conversion(max31856_handle_t h, float *out_c, uint8_t *out_sr, int64_t *out_ts_us) {
+    if (!h) return false;
+    // stamp first: a new edge can only come after the registers are read
+    int64_t ts = h->drdy_us;
+    uint8_t sr = 0;
+    if (!read_temp(h, out_c, &sr, true)) return false;
+    conversion_read(h, sr);
+    if (out_sr) *out_sr = sr;
+    if (out_ts_us) *out_ts_us = ts;
+    return true;
+}
+
+int max31856_sweep(const max31856_handle_t *hs, int n, max31856_conv_t *out) {
+    if (!s_spi || !hs || !out || n <= 0 || n > MAX31856_MAX_CH) return 0;   // n == 0: not a sweep
+    int64_t t0 = esp_timer_get_time();
+
+    // queue every read first; the bus runs them back to back from its ISR
+    for (int i = 0; i < n; ++i) {
+        out[i].ok = false;   // also the ones never queued
+        hs[i]->sweep_done = false;
+    }
+    int queued = 0;
+    esp_err_t err = ESP_OK;
+    for (int i = 0; i < n; ++i) {
+        max31856_handle_t h = hs[i];
+        // stamp first, as in max31856_read_conversion
+        out[i].ts_us = h->drdy_task ? h->drdy_us : 0;
+        memset(&h->sweep_t, 0, sizeof(h->sweep_t));
+        memset(h->sweep_tx, 0, sizeof(h->sweep_tx));
+        h->sweep_tx[0] = REG_LTCBH & 0x7F;   // A7=0 → read LTCBH..SR
+        h->sweep_t.length = 8 * sizeof(h->sweep_tx);
+        h->sweep_t.tx_buffer = h->sweep_tx;
+        h->sweep_t.rx_buffer = h->sweep_rx;
+        h->sweep_t.user = h;
+        err = spi_device_queue_trans(s_spi, &h->sweep_t, portMAX_DELAY);
+        if (err != ESP_OK) break;
+        queued++;
+    }
+
+    // Collect every transaction that was queued, even after a failure: one
+    // left in the device's queue would come back as the next sweep's result.
+    // t->user names the chip, so a missing result can't shift the others.
+    int got = 0;
+    for (int i = 0; i < queued; ++i) {
+        spi_transaction_t *t;
+        esp_err_t e = spi_device_get_trans_result(s_spi, &t, portMAX_DELAY);
+        if (e != ESP_OK) { err = e; continue; }
+        ((struct max31856_dev *)t->user)->sweep_done = true;
+        got++;
+    }
+    int64_t now = esp_timer_get_time();
+    int64_t per = got ? (now - t0) / got : 0;
+
+    int ok = 0;
+    for (int i = 0; i < n; ++i) {
+        max31856_handle_t h = hs[i];
+        if (!h->sweep_done) continue;
+        const uint8_t *buf = &h->sweep_rx[1];   // skip the address phase byte
+        h->stats.xfers++;
+        h->stats.xfer_us += per;
+        h->stats.temp_reads++;
+        h->stats.temp_xfers++;
+        h->stats.temp_us += per;               // the sweep's time, shared out
+        out[i].t_c = temp_decode(h, buf);
+        out[i].sr = buf[3];
+        if (!out[i].ts_us) out[i].ts_us = now;
+        if (h->drdy_task) conversion_read(h, buf[3]);
+        else log_faults(h, buf[3]);
+        out[i].ok = true;
+        ok++;
+    }
+    for (int i = 0; i < n; ++i) drdy_rearm(hs[i]);   // read or not: see drdy_rearm
+    if (got < n) ESP_LOGE(TAG, "sweep: %d of %d read(s) failed (%s)", n - got, n, esp_err_to_name(err));
+
+    s_sweep.sweeps++;
+    s_sweep.chips += got;
+    s_sweep.us += now - t0;
+    return ok;
+}
+
+void max31856_drdy_counts(max31856_handle_t h, uint32_t *edges, uint32_t *reads) {
+    if (edges) *edges = h ? h->drdy_edges : 0;
+    if (reads) *reads = h ? h->drdy_reads : 0;
+}
+
+void max31856_get_spi_stats(max31856_handle_t h, max31856_spi_stats_t *st) {
+    *st = h->stats;
+}
+
+void max31856_log_stats(max31856_handle_t h) {
+    const max31856_spi_stats_t *st = &h->stats;
+    if (!st->temp_reads) return;
+    // per temperature read: transactions and SPI time (was 2 transactions before the burst read)
+    ESP_LOGI(TAG, "spi ch%d: %u read(s), %u.%02u xfer/read, avg %lld us/read; %u xfer(s) total (%lld us); %u write(s), %u skipped by shadow",
+             h->ch, (unsigned)st->temp_reads,
+             (unsigned)(st->temp_xfers / st->temp_reads), (unsigned)(st->temp_xfers * 100 / st->temp_reads % 100),
+             (long long)(st->temp_us / st->temp_reads),
+             (unsigned)st->xfers, (long long)st->xfer_us, (unsigned)st->writes, (unsigned)st->writes_skipped);
+}
+
+void max31856_get_sweep_stats(max31856_sweep_stats_t *st) {
+    *st = s_sweep;
+}
+
+void max31856_log_sweep_stats(void) {
+    const max31856_sweep_stats_t *st = &s_sweep;
+    if (!st->sweeps || !st->chips) return;
+    ESP_LOGI(TAG, "sweep: %u sweep(s), %u.%02u chip(s)/sweep, avg %lld us/sweep, %lld us/chip",
+             (unsigned)st->sweeps,
+             (unsigned)(st->chips / st->sweeps), (unsigned)(st->chips * 100 / st->sweeps % 100),
+             (long long)(st->us / st->sweeps), (long long)(st->us / st->chips));
+}
 
-void max31856_read_cj_debug(void) {
+void max31856_read_cj_debug(max31856_handle_t h) {
     uint8_t b[2];
     // Cold junction read/convert
     // read bytes
     // pack into integer
     // right shift to align signed value
     // scale to celsius
-    if (read_regs(REG_CJTH, b, 2) == ESP_OK) {
+    if (read_regs(h, REG_CJTH, b, 2) == ESP_OK) {
         int16_t cj_raw = ((int16_t)b[0] << 8) | b[1];
         cj_raw >>= 2; // 14-bit 1/16°C
         float cj_c = cj_raw / 16.0f;
-        ESP_LOGI(TAG, "CJ Temp: %.2f°C", cj_c);
+        ESP_LOGI(TAG, "ch%d CJ Temp: %.2f°C", h->ch, cj_c);
     }
 }
@@ -5,23 +5,122 @@
 #include <stdint.h>
 #include "esp_err.h"
 #include "driver/spi_master.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// Provide the SPI device handle from app_main after spi_bus_add_device()
-void max31856_attach(spi_device_handle_t dev);
+#define MAX31856_MAX_CH  8   // chips per driver (one per thermocouple channel)
 
-// Configure MAX31856 (wide thresholds, T-type, AVG=2, 60 Hz)
-void max31856_init(void);
+// CR1 TC TYPE field
+typedef enum {
+    MAX31856_TC_B = 0, MAX31856_TC_E, MAX31856_TC_J, MAX31856_TC_K,
+    MAX31856_TC_N, MAX31856_TC_R, MAX31856_TC_S, MAX31856_TC_T,
+} max31856_tc_t;
+
+// One thermocouple channel: its chip's pins and how it is configured
+typedef struct {
+    int           cs_pin;      // chip select GPIO (driven by the driver, not the SPI host)
+    int           drdy_pin;    // DRDY GPIO, -1 = not wired (poll only)
+    max31856_tc_t tc_type;
+    uint8_t       avg_sel;     // CR1 AVGSEL: 0..4 = 1, 2, 4, 8, 16 samples averaged
+    bool          filt_50hz;   // 50 Hz mains rejection, else 60 Hz
+    float         offset_c;    // calibration offset added to every reading
+    bool          one_shot;    // normally off, one conversion per max31856_start, else continuous
+} max31856_cfg_t;
+
+typedef struct max31856_dev *max31856_handle_t;
+
+/* Registers a chip on host's (initialised) bus; channels are numbered in
+   the order they are added, from 0. All chips share one SPI device whose
+   CS is done in software, so channels are not limited by the host's CS
+   lines. ESP_ERR_NO_MEM past MAX31856_MAX_CH. */
+esp_err_t max31856_add(spi_host_device_t host, const max31856_cfg_t *cfg, max31856_handle_t *out);
+
+// The reading's channel id (order of max31856_add)
+int max31856_channel(max31856_handle_t h);
+
+// Configure the chip (wide thresholds, continuous or one-shot, type / averaging / filter from its cfg)
+void max31856_init(max31856_handle_t h);
+
+/* One-shot mode (cfg.one_shot): starts a conversion (CR0 1SHOT). The chip
+   idles again once it is done, max31856_conv_time_ms later, when DRDY
+   falls; the temperature registers hold the result until the next one.
+   ESP_ERR_INVALID_STATE for a continuous channel. */
+esp_err_t max31856_start(max31856_handle_t h);
+
+// Worst-case time from max31856_start to a readable result, for the
+// channel's filter and averaging (datasheet maxima)
+uint32_t max31856_conv_time_ms(max31856_handle_t h);
 
 // Read thermocouple temperature (°C). Returns true on success.
 // Writes fault status register to *out_sr if non-NULL.
-bool max31856_get_temp_c(float *out_c, uint8_t *out_sr);
+bool max31856_get_temp_c(max31856_handle_t h, float *out_c, uint8_t *out_sr);
+
+/* DRDY-driven acquisition. DRDY (active low) falls when a conversion is
+   ready and is released by reading the temperature registers. It is a
+   low-level interrupt (so it also wakes the chip from light sleep): the
+   ISR masks it and the wakeup, stamps the time with esp_timer and sets `bits` in task's
+   notification value (xTaskNotifyWait); the task then calls
+   max31856_read_conversion (or a sweep), which reads the conversion and
+   unmasks both. One interrupt per conversion. In one-shot mode DRDY falls
+   once per max31856_start. ESP_ERR_NOT_SUPPORTED if the channel has no
+   drdy_pin. Reads the chip: call it from the task that does the SPI. */
+esp_err_t max31856_drdy_enable(max31856_handle_t h, TaskHandle_t task, uint32_t bits);
+
+// Like max31856_get_temp_c, plus the esp_timer time (us) of the DRDY edge
+// that announced this conversion (0 if DRDY is not enabled)
+bool max31856_read_conversion(max31856_handle_t h, float *out_c, uint8_t *out_sr, int64_t *out_ts_us);
+
+// DRDY interrupts taken / conversions read since enable (edges - reads = announced, not read)
+void max31856_drdy_counts(max31856_handle_t h, uint32_t *edges, uint32_t *reads);
+
+// One chip's result in a sweep
+typedef struct {
+    bool    ok;
+    float   t_c;
+    uint8_t sr;
+    int64_t ts_us;   // DRDY edge of the conversion, or the sweep's end if DRDY is off
+} max31856_conv_t;
+
+/* Reads n chips in one pass: one burst read per chip, all queued on the
+   bus before the first result is collected. For a DRDY chip this is a
+   max31856_read_conversion (faults logged on change); a polled one logs
+   every fault, as max31856_get_temp_c. out[i] is hs[i]'s result; returns
+   how many were read. */
+int max31856_sweep(const max31856_handle_t *hs, int n, max31856_conv_t *out);
+
+// SPI cost counters; every register access is one transaction, and a
+// temperature read is a single burst over LTCBH..SR
+typedef struct {
+    uint32_t xfers;            // SPI transactions, all kinds
+    int64_t  xfer_us;          // time spent in them
+    uint32_t temp_reads;       // temperature reads (get_temp_c / read_conversion)
+    uint32_t temp_xfers;       // transactions those took
+    int64_t  temp_us;          // time those took
+    uint32_t writes;           // register writes sent
+    uint32_t writes_skipped;   // writes the config shadow found unchanged
+} max31856_spi_stats_t;
+
+void max31856_get_spi_stats(max31856_handle_t h, max31856_spi_stats_t *st);
+void max31856_log_stats(max31856_handle_t h);
+
+// Sweep latency, all chips: a queued sweep's time per chip is what a
+// blocking read costs minus the per-transaction wake-ups
+typedef struct {
+    uint32_t sweeps;
+    uint32_t chips;   // reads over all sweeps
+    int64_t  us;      // queue to last result, summed
+} max31856_sweep_stats_t;
+
+void max31856_get_sweep_stats(max31856_sweep_stats_t *st);
+void max31856_log_sweep_stats(void);
 
 // read cold-junction temp (guarded in .c)
-void max31856_read_cj_debug(void);
+void max31856_read_cj_debug(max31856_handle_t h);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,218 @@
+//mqtt_up.c
+//Windowed QoS1 publisher over esp-mqtt, one persistent session per sink
+/*
+The publish window and its commits to the sample queue are ack_win.c; this
+file maps it onto esp-mqtt: send = QoS1 publish, ack = PUBACK.
+
+Reconnects: esp-mqtt keeps unacknowledged QoS1 publishes in its outbox and
+resends them (DUP) once reconnected, and with clean_session off the broker
+keeps our session too. The window is therefore kept across a disconnect
+(resends = true) so those late PUBACKs still commit.
+*/
+#include "mqtt_up.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_crt_bundle.h"
+#include "mqtt_client.h"
+#include "lwip/sockets.h"
+#include "sample_q.h"      // SQ_SINKS
+#include "ack_win.h"
+#include "ingest_enc.h"    // INGEST_JSON_MAX
+#include "dns_cache.h"
+
+static const char *TAG = "mqtt_up";
+
+typedef struct {
+    esp_mqtt_client_handle_t c;
+    char          base[128];
+    mqtt_up_cfg_t cfg;
+    ack_win_t     win;
+    int64_t       connect_start_us;
+    volatile int64_t connect_us;    // last TCP/TLS connect + CONNACK time
+
+    // stats
+    uint32_t connects, resumed, drops;
+} mqtt_sess_t;
+
+static mqtt_sess_t s_sess[SQ_SINKS];
+
+// one encoded payload per sink, static to keep it off t_upl's stack;
+// JSON is the largest ingest_enc.h format
+static uint8_t s_payload[SQ_SINKS][INGEST_JSON_MAX(MQTT_BATCH_MAX)];
+
+// runs in the esp-mqtt task
+static void mqtt_evt(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    mqtt_sess_t *s = (mqtt_sess_t *)arg;
+    esp_mqtt_event_handle_t ev = (esp_mqtt_event_handle_t)data;
+    switch ((esp_mqtt_event_id_t)id) {
+    case MQTT_EVENT_BEFORE_CONNECT:
+        s->connect_start_us = esp_timer_get_time();
+        break;
+    case MQTT_EVENT_CONNECTED:
+        s->connect_us = esp_timer_get_time() - s->connect_start_us;
+        ack_win_link(&s->win, true);
+        s->connects++;
+        if (ev->session_present) s->resumed++;
+        ESP_LOGI(TAG, "sink %d connected to %s (%s session)",
+                 (int)(s - s_sess), s->base, ev->session_present ? "resumed" : "new");
+        break;
+    case MQTT_EVENT_DISCONNECTED:
+        ack_win_link(&s->win, false);
+        s->drops++;
+        ESP_LOGW(TAG, "sink %d disconnected from %s", (int)(s - s_sess), s->base);
+        break;
+    case MQTT_EVENT_PUBLISHED:
+        ack_win_acked(&s->win, ev->msg_id);
+        break;
+    default:
+        break;
+    }
+}
+
+// ack_win_send_t: one QoS1 publish, id = MQTT message id
+static int mqtt_send(void *ctx, const reading_t *rs, int n)
+{
+    mqtt_sess_t *s = (mqtt_sess_t *)ctx;
+    int sink = (int)(s - s_sess);
+    int len = s->cfg.enc(s_payload[sink], sizeof(s_payload[0]), rs, n);
+    if (len < 0) return -1;
+    // -1 not connected, -2 outbox full
+    return esp_mqtt_client_publish(s->c, s->cfg.topic, (const char *)s_payload[sink], len, 1, 0);
+}
+
+bool mqtt_up_open(int sink, const mqtt_up_cfg_t *cfg)
+{
+    if (sink < 0 || sink >= SQ_SINKS) return false;
+    mqtt_sess_t *s = &s_sess[sink];
+    if (s->c && strcmp(s->base, cfg->base) == 0) return true;
+    mqtt_up_close(sink);
+
+    if (!ack_win_init(&s->win, sink, MQTT_WINDOW, MQTT_BATCH_MAX, MQTT_ACK_TIMEOUT_MS, true, mqtt_send, s)) {
+        return false;
+    }
+    strncpy(s->base, cfg->base, sizeof(s->base) - 1);
+    s->cfg = *cfg;
+
+    bool tls = strncmp(cfg->base, "mqtts://", 8) == 0;
+    esp_mqtt_client_config_t mc = {
+        .broker.address.uri = s->base,
+        .broker.verification.crt_bundle_attach = tls ? esp_crt_bundle_attach : NULL,
+        .credentials.client_id = cfg->client_id,
+        .credentials.username = cfg->username,
+        .credentials.authentication.password = cfg->password,
+        // keep the session (and our QoS1 state) at the broker across reconnects
+        .session.disable_clean_session = true,
+        .session.keepalive = 60,
+        .network.reconnect_timeout_ms = 5000,
+        .network.timeout_ms = 10000,
+    };
+    s->c = esp_mqtt_client_init(&mc);
+    if (!s->c) { ESP_LOGW(TAG, "mqtt client init failed"); return false; }
+    esp_mqtt_client_register_event(s->c, ESP_EVENT_ANY_ID, mqtt_evt, s);
+    if (esp_mqtt_client_start(s->c) != ESP_OK) {
+        ESP_LOGW(TAG, "mqtt client start failed");
+        esp_mqtt_client_destroy(s->c);
+        s->c = NULL;
+        return false;
+    }
+    ESP_LOGI(TAG, "sink %d: session to %s, client id %s, topic %s", sink, s->base, cfg->client_id, cfg->topic);
+    return true;
+}
+
+void mqtt_up_close(int sink)
+{
+    if (sink < 0 || sink >= SQ_SINKS) return;
+    mqtt_sess_t *s = &s_sess[sink];
+    if (!s->c) return;
+    esp_mqtt_client_destroy(s->c);   // stops the client task first
+    s->c = NULL;
+    s->win.up = false;
+    s->base[0] = 0;
+    ack_win_reset(&s->win);
+}
+
+bool mqtt_up_connected(int sink, int wait_ms)
+{
+    if (sink < 0 || sink >= SQ_SINKS || !s_sess[sink].c) return false;
+    for (int t = 0; !s_sess[sink].win.up && t < wait_ms; t += 100) vTaskDelay(pdMS_TO_TICKS(100));
+    return s_sess[sink].win.up;
+}
+
+int64_t mqtt_up_rtt_us(int sink)
+{
+    if (sink < 0 || sink >= SQ_SINKS) return 0;
+    return s_sess[sink].win.ack_us_last ? s_sess[sink].win.ack_us_last : s_sess[sink].connect_us;
+}
+
+int mqtt_up_flush(int sink, int *publishes)
+{
+    *publishes = 0;
+    if (sink < 0 || sink >= SQ_SINKS || !s_sess[sink].c) return -1;
+    return ack_win_flush(&s_sess[sink].win, publishes);
+}
+
+int64_t mqtt_up_probe(const char *base, int timeout_ms)
+{
+    // mqtt[s]://host[:port]
+    const char *h = strstr(base, "://");
+    if (!h) return -1;
+    bool tls = strncmp(base, "mqtts://", 8) == 0;
+    h += 3;
+    char host[96], ip[16];
+    size_t hl = strcspn(h, ":/");
+    if (hl == 0 || hl >= sizeof(host)) return -1;
+    memcpy(host, h, hl);
+    host[hl] = 0;
+    int port = h[hl] == ':' ? atoi(h + hl + 1) : (tls ? 8883 : 1883);
+    if (!dns_cache_lookup(host, ip, sizeof(ip))) return -1;
+
+    struct sockaddr_in to = { .sin_family = AF_INET, .sin_port = htons(port) };
+    if (inet_pton(AF_INET, ip, &to.sin_addr) != 1) return -1;
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+
+    // non-blocking connect, bounded by timeout_ms
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    int64_t t0 = esp_timer_get_time(), dt = -1;
+    if (connect(sock, (struct sockaddr *)&to, sizeof(to)) == 0) {
+        dt = esp_timer_get_time() - t0;
+    } else if (errno == EINPROGRESS) {
+        fd_set wr;
+        FD_ZERO(&wr);
+        FD_SET(sock, &wr);
+        struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+        int err = 0;
+        socklen_t el = sizeof(err);
+        if (select(sock + 1, NULL, &wr, NULL, &tv) == 1 &&
+            getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &el) == 0 && err == 0) {
+            dt = esp_timer_get_time() - t0;
+        }
+    }
+    close(sock);
+    if (dt < 0) {
+        ESP_LOGW(TAG, "broker %s unreachable", base);
+        dns_cache_expire(host);
+    }
+    return dt;
+}
+
+void mqtt_up_log_stats(int sink)
+{
+    if (sink < 0 || sink >= SQ_SINKS) return;
+    const mqtt_sess_t *s = &s_sess[sink];
+    const ack_win_t *w = &s->win;
+    if (!s->c && !w->sent) return;
+    ESP_LOGI(TAG, "mqtt %d: %s, %u publish(es), %u acked (avg %lld ms max %lld ms), %d in flight, %u ack timeout(s), %u connect(s) (%u resumed), %u drop(s)",
+             sink, w->up ? "up" : "down", (unsigned)w->sent, (unsigned)w->acked,
+             (long long)(w->acked ? w->ack_us_total / w->acked / 1000 : 0), (long long)(w->ack_us_max / 1000),
+             w->count, (unsigned)w->timeouts, (unsigned)s->connects, (unsigned)s->resumed, (unsigned)s->drops);
+}
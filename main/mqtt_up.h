@@ -0,0 +1,51 @@
+//mqtt_up.h
+// MQTT uplink: one persistent QoS1 session per sink, publishing queued readings
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "reading.h"
+
+#define MQTT_WINDOW         4       // publishes in flight (sent, PUBACK pending), <= ACK_WIN_MAX
+#define MQTT_BATCH_MAX      8       // readings per publish, <= ACK_WIN_BATCH
+#define MQTT_ACK_TIMEOUT_MS 20000   // PUBACK overdue → forget the window and republish
+
+// Encodes n readings into one payload; returns its length or -1 if cap is too small
+typedef int (*mqtt_up_enc_t)(uint8_t *dst, size_t cap, const reading_t *rs, int n);
+
+typedef struct {
+    const char   *base;       // mqtt://host[:port] or mqtts://host[:port]
+    const char   *client_id;  // also the broker's key for the persistent session
+    const char   *username;
+    const char   *password;
+    const char   *topic;
+    mqtt_up_enc_t enc;
+} mqtt_up_cfg_t;
+
+/* Starts sink's session (clean_session off, so after a Wi-Fi drop the broker
+   resumes it and unacknowledged publishes are retransmitted with the same
+   message ids). No-op while already open for the same base; another base
+   closes the old session first. The strings must outlive the session. */
+bool mqtt_up_open(int sink, const mqtt_up_cfg_t *cfg);
+void mqtt_up_close(int sink);
+
+// Connection up (CONNACK received), waiting up to wait_ms for a session
+// that is still connecting
+bool mqtt_up_connected(int sink, int wait_ms);
+
+/* Publishes sink's backlog (sample_q.h) with up to MQTT_WINDOW messages in
+   flight, committing readings as their PUBACKs arrive, in order (ack_win.h),
+   and returns once everything sent is acknowledged. Returns the readings delivered, or
+   -1 if the connection dropped or an ack timed out; unacknowledged readings
+   stay queued either way (QoS1 is at-least-once, so the server may see a
+   republished reading twice). *publishes counts the messages sent. */
+int mqtt_up_flush(int sink, int *publishes);
+
+// Publish → PUBACK time of the last acknowledged message, or the last
+// connect time before the first ack (0 = neither yet)
+int64_t mqtt_up_rtt_us(int sink);
+
+// TCP connect time to the broker of base in us, or -1 (boot / idle endpoint probe)
+int64_t mqtt_up_probe(const char *base, int timeout_ms);
+
+void mqtt_up_log_stats(int sink);
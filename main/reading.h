@@ -0,0 +1,11 @@
+//reading.h
+// One temperature sample as queued between task_sensor and task_net
+#pragma once
+#include <stdint.h>
+
+typedef struct {
+    float    t_c;        // °C (smoothed unless sr != 0)
+    uint8_t  sr;         // MAX31856 fault status register
+    uint8_t  ch;         // thermocouple channel (max31856_channel), 0 on one-probe units
+    int64_t  ts_ms_utc;  // sample time, ms since Unix epoch
+} reading_t;
@@ -0,0 +1,196 @@
+//sample_q.c
+//Lock-free single-producer / one-consumer-per-sink ring with flash spill
+/*
+head is only written by the producer and each sink's cursor only by that
+sink's consumer, so no critical section is needed: each side publishes its
+index with a release store and reads the others' with an acquire load.
+Indices run freely and are masked on access. The ring's tail is the cursor
+furthest behind head, so head - tail is the fill level and a slow sink only
+costs RAM (then spool) space, never the other sinks' progress.
+
+Ordering with the spool: once anything is in flash, new readings are also
+appended there until every sink drains it, and each consumer empties its
+RAM backlog before flash. Everything in RAM is therefore older than
+everything in the spool, for every sink.
+*/
+#include "sample_q.h"
+#include <math.h>
+#include <stdatomic.h>
+#include "spool.h"
+
+_Static_assert((SQ_CAP & (SQ_CAP - 1)) == 0, "SQ_CAP must be a power of two");
+
+typedef struct {
+    uint32_t dt_ms;   // ts_ms_utc - s_anchor_ms
+    int16_t  t_q7;    // °C in 1/128 steps (the MAX31856 LSB)
+    uint8_t  sr;
+    uint8_t  ch;
+} sq_rec_t;
+
+_Static_assert(sizeof(sq_rec_t) == SQ_REC_SIZE, "sq_rec_t must stay packed");
+
+static sq_rec_t s_buf[SQ_CAP];
+// Timestamp base for dt_ms. Only the producer moves it, and only while the
+// ring is empty; the release store of head publishes it with the record.
+static int64_t s_anchor_ms = 0;
+static _Atomic uint32_t s_head = 0;            // next slot to write (producer)
+static _Atomic uint32_t s_cur[SQ_SINKS];       // per sink: oldest slot not yet committed (its consumer)
+static _Atomic uint32_t s_dropped = 0;
+static int s_sinks = 1;
+// last peek, per sink: the first s_peek_ram came from RAM, the rest from the spool
+static int s_peek_ram[SQ_SINKS];
+static int s_peek_spool[SQ_SINKS];
+
+void sq_init(int sinks)
+{
+    s_sinks = sinks < 1 ? 1 : sinks > SQ_SINKS ? SQ_SINKS : sinks;
+}
+
+// slots from the furthest-behind sink up to head
+static uint32_t ram_used(uint32_t head)
+{
+    uint32_t used = 0;
+    for (int k = 0; k < s_sinks; ++k) {
+        uint32_t d = head - atomic_load_explicit(&s_cur[k], memory_order_acquire);
+        if (d > used) used = d;
+    }
+    return used;
+}
+
+// false if r->ts_ms_utc is not representable against the current anchor
+static bool pack(const reading_t *r, bool empty, sq_rec_t *out)
+{
+    int64_t dt = r->ts_ms_utc - s_anchor_ms;
+    if (dt < 0 || dt > (int64_t)UINT32_MAX) {
+        if (!empty) return false;
+        s_anchor_ms = r->ts_ms_utc;  // nothing queued refers to the old anchor
+        dt = 0;
+    }
+    float q = roundf(r->t_c * 128.0f);
+    if (q > INT16_MAX) q = INT16_MAX;
+    if (q < INT16_MIN) q = INT16_MIN;
+
+    out->dt_ms = (uint32_t)dt;
+    out->t_q7 = (int16_t)q;
+    out->sr = r->sr;
+    out->ch = r->ch;
+    return true;
+}
+
+static void unpack(const sq_rec_t *rec, reading_t *out)
+{
+    out->ts_ms_utc = s_anchor_ms + rec->dt_ms;
+    out->t_c = rec->t_q7 / 128.0f;
+    out->sr = rec->sr;
+    out->ch = rec->ch;
+}
+
+bool sq_push(const reading_t *r)
+{
+    // spool not empty → newer samples must queue behind it. If that append
+    // fails the reading is dropped: in RAM it would be delivered ahead of
+    // the older spooled backlog
+    if (spool_count() > 0) {
+        if (spool_append(r)) return true;
+        atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    uint32_t head = atomic_load_explicit(&s_head, memory_order_relaxed);
+    uint32_t used = ram_used(head);
+    sq_rec_t rec;
+    if (used < SQ_CAP && pack(r, used == 0, &rec)) {
+        s_buf[head & (SQ_CAP - 1)] = rec;
+        // publish the slot contents before the new head
+        atomic_store_explicit(&s_head, head + 1, memory_order_release);
+        return true;
+    }
+
+    // RAM full or not packable → spill to flash
+    if (spool_append(r)) return true;
+
+    // the producer cannot move the cursors, so without a spool the newest is dropped
+    atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+    return false;
+}
+
+int sq_peek_n(int sink, reading_t *out, int max)
+{
+    uint32_t cur = atomic_load_explicit(&s_cur[sink], memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&s_head, memory_order_acquire);
+    uint32_t avail = head - cur;
+
+    int n = 0;
+    for (; n < max && (uint32_t)n < avail; ++n) unpack(&s_buf[(cur + n) & (SQ_CAP - 1)], &out[n]);
+    s_peek_ram[sink] = n;
+
+    // RAM drained → continue with the (newer) spooled backlog
+    s_peek_spool[sink] = (n < max) ? spool_peek_n(sink, out + n, max - n) : 0;
+    return n + s_peek_spool[sink];
+}
+
+sq_mark_t sq_peek_mark(int sink, int k)
+{
+    int ram = k < s_peek_ram[sink] ? k : s_peek_ram[sink];
+    int sp = k - ram < s_peek_spool[sink] ? k - ram : s_peek_spool[sink];
+    sq_mark_t m = {
+        .ram = atomic_load_explicit(&s_cur[sink], memory_order_relaxed) + (uint32_t)(ram > 0 ? ram : 0),
+        .spool_seq = sp > 0 ? spool_peek_seq(sink, sp - 1) : 0,
+    };
+    return m;
+}
+
+void sq_commit_mark(int sink, sq_mark_t m)
+{
+    uint32_t cur = atomic_load_explicit(&s_cur[sink], memory_order_relaxed);
+    if ((int32_t)(m.ram - cur) > 0) {
+        // delivered to this sink; the slots go back to the producer once every sink is past them
+        atomic_store_explicit(&s_cur[sink], m.ram, memory_order_release);
+    }
+    if (m.spool_seq) spool_commit_seq(sink, m.spool_seq);
+}
+
+void sq_commit_n(int sink, int n)
+{
+    sq_commit_mark(sink, sq_peek_mark(sink, n));
+    sq_abort(sink);
+}
+
+void sq_abort(int sink)
+{
+    s_peek_ram[sink] = 0;
+    s_peek_spool[sink] = 0;
+}
+
+bool sq_peek(int sink, reading_t *out)
+{
+    return sq_peek_n(sink, out, 1) == 1;
+}
+
+void sq_commit(int sink)
+{
+    sq_commit_n(sink, 1);
+}
+
+bool sq_pop(int sink, reading_t *out)
+{
+    if (!sq_peek(sink, out)) return false;
+    sq_commit(sink);
+    return true;
+}
+
+uint32_t sq_count(void)
+{
+    return ram_used(atomic_load_explicit(&s_head, memory_order_acquire));
+}
+
+uint32_t sq_count_sink(int sink)
+{
+    return atomic_load_explicit(&s_head, memory_order_acquire) -
+           atomic_load_explicit(&s_cur[sink], memory_order_acquire);
+}
+
+uint32_t sq_dropped(void)
+{
+    return atomic_load_explicit(&s_dropped, memory_order_relaxed);
+}
@@ -0,0 +1,70 @@
+//sample_q.h
+// Sample queue between task_sensor (only producer) and one uploader per sink
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "reading.h"
+
+// RAM ring capacity (menuconfig → Freezer Monitor), must be a power of two
+#define SQ_CAP CONFIG_SAMPLE_QUEUE_CAP
+
+/* Readings are stored packed, 8 bytes instead of sizeof(reading_t) = 16:
+     dt_ms:u32 (ms after a per-queue epoch anchor) | temp:i16 (1/128 °C) | sr:u8
+   Temperature is clamped to the int16 range (±256 °C). A reading whose time
+   does not fit the anchor (clock stepped while readings are queued) goes to
+   the spool, which stores the full timestamp. */
+#define SQ_REC_SIZE 8
+
+/* Delivery sinks (e.g. LAN server and cloud). Every reading is delivered to
+   each sink once; each sink has its own consumer and acknowledged cursor,
+   and a slot is freed only when the slowest sink has committed it. Nothing
+   is copied per sink: one packed ring, one spool record, N cursors. */
+#define SQ_SINKS 2
+
+// Set the number of sinks in use (1..SQ_SINKS), before the first push
+void sq_init(int sinks);
+
+/* Producer side (task_sensor only). When the RAM ring is full, or the reading
+   cannot be packed, it spills to the flash spool; returns false only if it
+   had to be dropped. */
+bool sq_push(const reading_t *r);
+
+/* Consumer side (one task per sink), transactional:
+     n = sq_peek_n(sink, buf, max)  copy sink's oldest n readings, leave them queued
+     sq_commit_n(sink, k)           advance sink's cursor past the first k once delivered
+     sq_abort(sink)                 keep all of them for sink's next attempt
+   A failed or partial upload never re-pushes anything, so order is kept and
+   a full queue cannot evict a sample because of a retry. */
+int  sq_peek_n(int sink, reading_t *out, int max);
+void sq_commit_n(int sink, int n);
+void sq_abort(int sink);
+
+/* Where sink's last peek stood after its first k readings. A mark outlives
+   later peeks and aborts, so a consumer with several uploads in flight
+   (ack_win) commits each one against what it actually sent: spooled
+   readings are acked by sequence number, and ones the spool dropped since
+   (ring full, oldest sector recycled) cannot be acked in their place. */
+typedef struct {
+    uint32_t ram;         // sink's RAM cursor just past them
+    uint32_t spool_seq;   // sequence number of the last spooled one, 0 if none
+} sq_mark_t;
+
+sq_mark_t sq_peek_mark(int sink, int k);
+// Commit sink's readings up to mark m; readings queued after it stay
+void sq_commit_mark(int sink, sq_mark_t m);
+
+// Single-reading forms of the above
+bool sq_peek(int sink, reading_t *out);
+void sq_commit(int sink);
+bool sq_pop(int sink, reading_t *out);
+
+// Readings held in RAM (until the slowest sink commits them)
+uint32_t sq_count(void);
+
+// Readings in RAM that sink has not committed yet (the spool reports its own backlog)
+uint32_t sq_count_sink(int sink);
+
+// Readings dropped because both RAM and the spool were unavailable, or the
+// spool held a backlog and its append failed (RAM would reorder them)
+uint32_t sq_dropped(void);
@@ -0,0 +1,315 @@
+//spool.c
+//Append-only circular log of readings in a raw flash partition
+/*
+Layout: the partition is an array of 32-byte record slots, 128 per 4 KB
+sector. Appends walk the whole partition in order and a sector is erased
+only when the head enters it, so every sector wears at the same rate.
+
+Crash safety: nothing but the records themselves is stored.
+- A record is valid when its CRC matches; a torn append fails the CRC.
+- Each sink owns one bit of the record's ack byte (erased = 1 = pending).
+  A sink acks by clearing its bit; NOR flash can clear bits without an
+  erase, so this is a single in-place write. 0x00 means every sink is done.
+- At boot the head is the slot after the highest sequence number, and each
+  sink's tail is the lowest-sequence record that still has its bit set.
+  The ring's tail is the furthest-behind sink's tail.
+*/
+#include "spool.h"
+#include <stddef.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+
+static const char *TAG = "spool";
+
+#define SPOOL_LABEL        "spool"
+#define SPOOL_SECTOR_SIZE  4096
+#define SPOOL_REC_SIZE     32
+#define SLOTS_PER_SECTOR   (SPOOL_SECTOR_SIZE / SPOOL_REC_SIZE)
+
+#define ACK_BIT(k)   (1u << (k))
+
+typedef struct {
+    int64_t  ts_ms_utc;
+    uint32_t seq;        // append order, recovers head/tail after reboot
+    float    t_c;
+    uint8_t  sr;
+    uint8_t  ch;         // 0xFF (erased) in records written before channels: channel 0
+    uint8_t  rsvd[2];    // left erased (0xFF)
+    uint32_t crc;        // crc32 over the 20 bytes above
+    uint8_t  ack;        // bit k set until sink k acks it
+    uint8_t  pad[7];     // left erased (0xFF)
+} spool_rec_t;
+
+_Static_assert(sizeof(spool_rec_t) == SPOOL_REC_SIZE, "spool record must be 32 bytes");
+
+#define REC_CRC_LEN  offsetof(spool_rec_t, crc)
+#define REC_ACK_OFF  offsetof(spool_rec_t, ack)
+
+static const esp_partition_t *s_part = NULL;
+static SemaphoreHandle_t s_lock = NULL;
+static uint32_t s_slots = 0;     // total record slots
+static uint32_t s_head = 0;      // next slot to write
+static uint32_t s_count = 0;     // slots from the furthest-behind sink's tail up to head
+static uint32_t s_next_seq = 1;
+static int      s_sinks = 1;
+static uint8_t  s_ack_mask = 0x01;   // bits of the sinks in use
+// per sink: oldest slot it has not acked, and slots from there up to head
+static uint32_t s_tail[SPOOL_SINKS_MAX];
+static uint32_t s_scount[SPOOL_SINKS_MAX];
+static uint32_t s_peek_seq[SPOOL_SINKS_MAX][SPOOL_PEEK_MAX];  // seqs handed out by each sink's last peek
+static int      s_peek_n[SPOOL_SINKS_MAX];
+static spool_stats_t s_stats;
+
+static uint32_t rec_crc(const spool_rec_t *rec)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)rec, REC_CRC_LEN);
+}
+
+static bool rec_valid(const spool_rec_t *rec)
+{
+    return rec->seq != 0xFFFFFFFFu && rec->crc == rec_crc(rec);
+}
+
+static bool slot_erased(uint32_t slot)
+{
+    uint8_t b[SPOOL_REC_SIZE];
+    if (esp_partition_read(s_part, slot * SPOOL_REC_SIZE, b, sizeof(b)) != ESP_OK) return false;
+    for (size_t i = 0; i < sizeof(b); ++i) if (b[i] != 0xFF) return false;
+    return true;
+}
+
+// The ring holds on to records until the furthest-behind sink is done
+static void update_count(void)
+{
+    s_count = 0;
+    for (int k = 0; k < s_sinks; ++k) if (s_scount[k] > s_count) s_count = s_scount[k];
+}
+
+// Scan every slot once to find the newest record (head) and, per sink,
+// the oldest record it never acked (its tail)
+static void recover(void)
+{
+    spool_rec_t recs[16];
+    uint32_t max_seq = 0, min_pending[SPOOL_SINKS_MAX];
+    bool any = false;
+
+    s_head = 0;
+    for (int k = 0; k < s_sinks; ++k) min_pending[k] = 0xFFFFFFFFu;
+    for (uint32_t slot = 0; slot < s_slots; slot += 16) {
+        if (esp_partition_read(s_part, slot * SPOOL_REC_SIZE, recs, sizeof(recs)) != ESP_OK) continue;
+        for (uint32_t i = 0; i < 16; ++i) {
+            const spool_rec_t *rec = &recs[i];
+            if (!rec_valid(rec)) continue;
+            if (!any || rec->seq > max_seq) { max_seq = rec->seq; s_head = (slot + i + 1) % s_slots; }
+            for (int k = 0; k < s_sinks; ++k) {
+                if ((rec->ack & ACK_BIT(k)) && rec->seq < min_pending[k]) {
+                    min_pending[k] = rec->seq; s_tail[k] = slot + i;
+                }
+            }
+            any = true;
+        }
+    }
+    s_next_seq = any ? max_seq + 1 : 1;
+
+    // skip slots left half-written by a crash; the next sector start is erased on entry
+    while (s_head % SLOTS_PER_SECTOR != 0 && !slot_erased(s_head)) s_head = (s_head + 1) % s_slots;
+
+    for (int k = 0; k < s_sinks; ++k) {
+        if (min_pending[k] == 0xFFFFFFFFu) s_tail[k] = s_head;
+        s_scount[k] = (s_head + s_slots - s_tail[k]) % s_slots;
+    }
+    update_count();
+}
+
+esp_err_t spool_init(int sinks)
+{
+    s_sinks = sinks < 1 ? 1 : sinks > SPOOL_SINKS_MAX ? SPOOL_SINKS_MAX : sinks;
+    s_ack_mask = (uint8_t)((1u << s_sinks) - 1);
+
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, SPOOL_LABEL);
+    if (!s_part) {
+        ESP_LOGW(TAG, "No '%s' partition; flash spool disabled", SPOOL_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    // need at least two sectors so the head never erases the sector it is leaving
+    s_slots = (s_part->size / SPOOL_SECTOR_SIZE) * SLOTS_PER_SECTOR;
+    if (s_slots < 2 * SLOTS_PER_SECTOR) {
+        ESP_LOGE(TAG, "'%s' partition too small (%u bytes)", SPOOL_LABEL, (unsigned)s_part->size);
+        s_part = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) { s_part = NULL; return ESP_ERR_NO_MEM; }
+
+    int64_t t0 = esp_timer_get_time();
+    recover();
+    s_stats.capacity = s_slots;
+    ESP_LOGI(TAG, "Mounted %u slots for %d sink(s): %u pending, head=%u (scan %lld ms)",
+             (unsigned)s_slots, s_sinks, (unsigned)s_count, (unsigned)s_head,
+             (long long)((esp_timer_get_time() - t0) / 1000));
+    return ESP_OK;
+}
+
+bool spool_append(const reading_t *r)
+{
+    if (!s_part || !r) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int64_t t0 = esp_timer_get_time();
+
+    if (s_head % SLOTS_PER_SECTOR == 0) {
+        // entering a sector: if a sink's oldest unacked records live here, the ring is full → drop them
+        uint32_t sector = s_head / SLOTS_PER_SECTOR;
+        uint32_t lost_max = 0;
+        for (int k = 0; k < s_sinks; ++k) {
+            if (s_scount[k] == 0 || s_tail[k] / SLOTS_PER_SECTOR != sector) continue;
+            uint32_t lost = SLOTS_PER_SECTOR - (s_tail[k] % SLOTS_PER_SECTOR);
+            if (lost > lost_max) lost_max = lost;
+            s_scount[k] -= lost;
+            s_tail[k] = (sector + 1) * SLOTS_PER_SECTOR % s_slots;
+        }
+        if (lost_max) {
+            s_stats.dropped += lost_max;
+            update_count();
+            ESP_LOGW(TAG, "Spool full: dropped %u oldest slot(s)", (unsigned)lost_max);
+        }
+        if (esp_partition_erase_range(s_part, sector * SPOOL_SECTOR_SIZE, SPOOL_SECTOR_SIZE) != ESP_OK) {
+            ESP_LOGE(TAG, "Erase of sector %u failed", (unsigned)sector);
+            xSemaphoreGive(s_lock);
+            return false;
+        }
+        s_stats.erases++;
+    }
+
+    spool_rec_t rec;
+    memset(&rec, 0xFF, sizeof(rec));
+    rec.ts_ms_utc = r->ts_ms_utc;
+    rec.seq = s_next_seq;
+    rec.t_c = r->t_c;
+    rec.sr = r->sr;
+    rec.ch = r->ch;
+    rec.crc = rec_crc(&rec);
+
+    bool ok = esp_partition_write(s_part, s_head * SPOOL_REC_SIZE, &rec, sizeof(rec)) == ESP_OK;
+    // on a failed write the slot is skipped so the next append lands on erased flash
+    s_head = (s_head + 1) % s_slots;
+    for (int k = 0; k < s_sinks; ++k) s_scount[k]++;
+    s_count++;
+    if (ok) {
+        s_next_seq++;
+        s_stats.appended++;
+    }
+    s_stats.append_us += esp_timer_get_time() - t0;
+    xSemaphoreGive(s_lock);
+    return ok;
+}
+
+// Reads the record in slot; true if it is valid and sink has not acked it
+static bool read_pending(uint32_t slot, int sink, spool_rec_t *rec)
+{
+    return esp_partition_read(s_part, slot * SPOOL_REC_SIZE, rec, sizeof(*rec)) == ESP_OK &&
+           rec_valid(rec) && (rec->ack & ACK_BIT(sink));
+}
+
+static bool sink_ok(int sink)
+{
+    return s_part && sink >= 0 && sink < s_sinks;
+}
+
+int spool_peek_n(int sink, reading_t *out, int max)
+{
+    if (!sink_ok(sink) || !out || max <= 0) return 0;
+    if (max > SPOOL_PEEK_MAX) max = SPOOL_PEEK_MAX;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int64_t t0 = esp_timer_get_time();
+
+    // torn/unreadable slots at the tail are skipped for good
+    spool_rec_t rec;
+    bool moved = false;
+    while (s_scount[sink] > 0 && !read_pending(s_tail[sink], sink, &rec)) {
+        s_tail[sink] = (s_tail[sink] + 1) % s_slots;
+        s_scount[sink]--;
+        moved = true;
+    }
+    if (moved) update_count();
+
+    int n = 0;
+    for (uint32_t i = 0; i < s_scount[sink] && n < max; ++i) {
+        if (!read_pending((s_tail[sink] + i) % s_slots, sink, &rec)) continue;
+        out[n].ts_ms_utc = rec.ts_ms_utc;
+        out[n].t_c = rec.t_c;
+        out[n].sr = rec.sr;
+        out[n].ch = rec.ch == 0xFF ? 0 : rec.ch;
+        s_peek_seq[sink][n++] = rec.seq;
+    }
+    s_peek_n[sink] = n;
+    s_stats.drain_us += esp_timer_get_time() - t0;
+    xSemaphoreGive(s_lock);
+    return n;
+}
+
+uint32_t spool_peek_seq(int sink, int i)
+{
+    if (!sink_ok(sink) || i < 0 || i >= s_peek_n[sink]) return 0;
+    return s_peek_seq[sink][i];
+}
+
+void spool_commit_n(int sink, int n)
+{
+    if (!sink_ok(sink) || n <= 0 || s_peek_n[sink] == 0) return;
+    if (n > s_peek_n[sink]) n = s_peek_n[sink];
+    spool_commit_seq(sink, s_peek_seq[sink][n - 1]);
+    s_peek_n[sink] = 0;
+}
+
+// Commits by sequence number rather than by position, so a sector that an
+// append recycled since the peek cannot make us ack records never sent.
+void spool_commit_seq(int sink, uint32_t last)
+{
+    if (!sink_ok(sink) || last == 0) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int64_t t0 = esp_timer_get_time();
+
+    spool_rec_t rec;
+    while (s_scount[sink] > 0) {
+        uint32_t slot = s_tail[sink];
+        if (read_pending(slot, sink, &rec)) {
+            if (rec.seq > last) break;
+            // clear only this sink's bit; the others keep theirs
+            uint8_t ack = rec.ack & (uint8_t)~ACK_BIT(sink);
+            esp_partition_write(s_part, slot * SPOOL_REC_SIZE + REC_ACK_OFF, &ack, 1);
+            if ((ack & s_ack_mask) == 0) s_stats.drained++;
+        }
+        s_tail[sink] = (slot + 1) % s_slots;
+        s_scount[sink]--;
+    }
+    update_count();
+    s_stats.drain_us += esp_timer_get_time() - t0;
+    xSemaphoreGive(s_lock);
+}
+
+uint32_t spool_count(void)
+{
+    return s_part ? s_count : 0;
+}
+
+uint32_t spool_count_sink(int sink)
+{
+    return sink_ok(sink) ? s_scount[sink] : 0;
+}
+
+void spool_get_stats(spool_stats_t *st)
+{
+    if (!st) return;
+    if (s_lock) xSemaphoreTake(s_lock, portMAX_DELAY);
+    *st = s_stats;
+    st->pending = s_count;
+    for (int k = 0; k < s_sinks; ++k) st->sink_pending[k] = s_scount[k];
+    if (s_lock) xSemaphoreGive(s_lock);
+}
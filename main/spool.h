@@ -0,0 +1,58 @@
+//spool.h
+// Flash-backed overflow queue for readings (the "spool" data partition)
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "reading.h"
+
+// Consumers (delivery sinks) tracked per record: one bit of its ack byte each
+#define SPOOL_SINKS_MAX 8
+
+typedef struct {
+    uint32_t capacity;    // record slots in the partition
+    uint32_t pending;     // slots between tail and head (not yet drained by every sink)
+    uint32_t sink_pending[SPOOL_SINKS_MAX];  // the same, per sink
+    uint32_t appended;    // records written since boot
+    uint32_t drained;     // records acked by their last sink since boot
+    uint32_t dropped;     // undrained records lost to a sector erase (ring full)
+    uint32_t erases;      // sector erases since boot
+    int64_t  append_us;   // total time spent in spool_append (incl. erases)
+    int64_t  drain_us;    // total time spent peeking and committing
+} spool_stats_t;
+
+/* Mount the partition and recover head/tails from the records on flash.
+   sinks (1..SPOOL_SINKS_MAX) independent consumers each see every record
+   and ack it on their own; a record is drained once all of them have.
+   Returns ESP_ERR_NOT_FOUND if there is no "spool" partition; the spool
+   then stays disabled and every call below is a no-op. */
+esp_err_t spool_init(int sinks);
+
+// Append one reading; when the ring is full the oldest sector is recycled
+bool spool_append(const reading_t *r);
+
+// Most readings one spool_peek_n can hand out
+#define SPOOL_PEEK_MAX 64
+
+// Copy up to max oldest readings not yet acked by sink into out, left in place.
+// Returns how many were copied (0 if empty).
+int spool_peek_n(int sink, reading_t *out, int max);
+
+// Ack the first n readings of sink's last spool_peek_n on flash
+void spool_commit_n(int sink, int n);
+
+// Sequence number of reading i (from 0) of sink's last spool_peek_n, 0 if none
+uint32_t spool_peek_seq(int sink, int i);
+
+// Ack sink's records up to and including sequence number seq. Records
+// appended after it are left alone, so a peek can be committed after later
+// peeks of the same sink (several uploads in flight).
+void spool_commit_seq(int sink, uint32_t seq);
+
+// Slots not yet drained by every sink (0 = empty)
+uint32_t spool_count(void);
+
+// Slots not yet acked by sink
+uint32_t spool_count_sink(int sink);
+
+void spool_get_stats(spool_stats_t *st);
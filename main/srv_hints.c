@@ -0,0 +1,88 @@
+//srv_hints.c
+//Parses the server's cadence / batch / retry-after hints out of a response
+/*
+Pure parsing and clamping, no state: the uploader applies the result
+(Temperature-Sensor.c). Headers are the cheap path for the server (no
+body change on existing endpoints); the body fields are there for
+servers or proxies that strip custom headers. Retry-After in its
+HTTP-date form needs a synced clock to mean anything and is ignored.
+*/
+#include "srv_hints.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static long clamp(long v, long lo, long hi)
+{
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+// A non-negative decimal; false for anything else (dates, garbage, empty)
+static bool parse_num(const char *s, long *out)
+{
+    if (!s) return false;
+    while (*s == ' ') s++;
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (end == s || v < 0) return false;
+    while (*end == ' ') end++;
+    if (*end && *end != ',' && *end != '}') return false;
+    *out = v;
+    return true;
+}
+
+void srv_hints_clear(srv_hints_t *h)
+{
+    h->period_ms = 0;
+    h->batch = 0;
+    h->retry_after_s = -1;
+}
+
+static void set_period(srv_hints_t *h, long v)
+{
+    if (v > 0) h->period_ms = (int32_t)clamp(v, SRV_PERIOD_MIN_MS, SRV_PERIOD_MAX_MS);
+}
+
+static void set_batch(srv_hints_t *h, long v)
+{
+    if (v > 0) h->batch = (int16_t)clamp(v, 1, 1000);
+}
+
+bool srv_hints_header(srv_hints_t *h, const char *key, const char *value)
+{
+    long v;
+    if (!key || !parse_num(value, &v)) return false;
+    if (strcasecmp(key, "X-Sample-Period-Ms") == 0) {
+        set_period(h, v);
+    } else if (strcasecmp(key, "X-Batch-Max") == 0) {
+        set_batch(h, v);
+    } else if (strcasecmp(key, "Retry-After") == 0) {
+        h->retry_after_s = (int32_t)clamp(v, 0, SRV_RETRY_MAX_S);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// "key":<number> anywhere in body
+static bool body_num(const char *body, const char *key, long *out)
+{
+    const char *p = strstr(body, key);
+    return p && parse_num(p + strlen(key), out);
+}
+
+void srv_hints_body(srv_hints_t *h, const char *body)
+{
+    long v;
+    if (!body || !*body) return;
+    if (!h->period_ms && body_num(body, "\"period_ms\":", &v)) set_period(h, v);
+    if (!h->batch && body_num(body, "\"batch_max\":", &v)) set_batch(h, v);
+    if (h->retry_after_s < 0 && body_num(body, "\"retry_after\":", &v)) {
+        h->retry_after_s = (int32_t)clamp(v, 0, SRV_RETRY_MAX_S);
+    }
+}
+
+bool srv_hints_any(const srv_hints_t *h)
+{
+    return h->period_ms || h->batch || h->retry_after_s >= 0;
+}
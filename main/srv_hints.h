@@ -0,0 +1,35 @@
+//srv_hints.h
+// Cadence / batch size / retry-after hints an ingest server sends back
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A server under load asks devices to slow down (or one watching a critical
+   freezer asks it to speed up) on any response, /ingest, /ingest/batch or
+   /health alike, with response headers:
+     X-Sample-Period-Ms: <ms>    desired sample / upload period
+     X-Batch-Max: <n>            readings per request
+     Retry-After: <s>            no uploads for s seconds (delta-seconds only)
+   or the same as fields of a JSON body:
+     {"period_ms":60000,"batch_max":8,"retry_after":120}
+   Values are clamped to the ranges below; anything else is ignored. */
+
+#define SRV_PERIOD_MIN_MS  5000                  // fastest cadence a server can ask for
+#define SRV_PERIOD_MAX_MS  (60 * 60 * 1000)      // slowest
+#define SRV_RETRY_MAX_S    (60 * 60)
+
+typedef struct {
+    int32_t period_ms;       // 0 = not given
+    int16_t batch;           // 0 = not given
+    int32_t retry_after_s;   // -1 = not given
+} srv_hints_t;
+
+void srv_hints_clear(srv_hints_t *h);
+
+// One response header (HTTP_EVENT_ON_HEADER); true if it was a hint
+bool srv_hints_header(srv_hints_t *h, const char *key, const char *value);
+
+// Hint fields in a (possibly truncated) JSON body; headers take precedence
+void srv_hints_body(srv_hints_t *h, const char *body);
+
+bool srv_hints_any(const srv_hints_t *h);
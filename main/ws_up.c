@@ -0,0 +1,216 @@
+//ws_up.c
+//Streams queued readings over a long-lived WebSocket, one connection per sink
+/*
+Compared with a POST per batch there are no request/response headers and no
+per-request round-trip: a new reading is one small frame on a connection
+that is already open. The frame window and its commits to the sample queue
+are ack_win.c; this file maps it onto esp_websocket_client: send = one
+frame with a sequence number, ack = the server echoing that number.
+
+Backpressure: at most WS_WINDOW unacknowledged frames are out, and a frame
+the socket cannot take within WS_SEND_TIMEOUT_MS is not retried in a loop.
+Either way the readings simply stay in the sample queue (and spill to the
+spool), where they are kept in order, instead of piling up in lwIP buffers.
+*/
+#include "ws_up.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_crt_bundle.h"
+#include "esp_websocket_client.h"
+#include "sample_q.h"      // SQ_SINKS
+#include "ack_win.h"
+#include "ingest_enc.h"    // INGEST_JSON_MAX
+
+static const char *TAG = "ws_up";
+
+#define WS_OP_TEXT   0x1
+#define WS_OP_BINARY 0x2
+
+typedef struct {
+    esp_websocket_client_handle_t c;
+    char        uri[160];
+    ws_up_cfg_t cfg;
+    ack_win_t   win;
+    uint32_t    seq;               // last frame sequence number sent
+    int64_t     connect_start_us;
+    volatile int64_t connect_us;   // last TCP/TLS connect + upgrade time
+
+    // stats
+    uint32_t connects, drops, send_full;
+    uint64_t bytes;
+} ws_sess_t;
+
+static ws_sess_t s_sess[SQ_SINKS];
+
+// one frame per sink (seq or the JSON envelope around the body), static to
+// keep it off t_upl's stack; JSON is the largest ingest_enc.h format
+static uint8_t s_frame[SQ_SINKS][32 + INGEST_JSON_MAX(WS_BATCH_MAX)];
+
+// An ack frame's sequence number, or 0 if it isn't one
+static int parse_ack(const esp_websocket_event_data_t *d)
+{
+    if (d->payload_offset != 0 || d->data_len <= 0) return 0;   // acks are small: first fragment only
+    if (d->op_code == WS_OP_BINARY && d->data_len >= 4) {
+        const uint8_t *p = (const uint8_t *)d->data_ptr;
+        uint32_t seq = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+        return (int)(seq & 0x7FFFFFFF);
+    }
+    if (d->op_code == WS_OP_TEXT) {
+        char txt[64];
+        int n = d->data_len < (int)sizeof(txt) - 1 ? d->data_len : (int)sizeof(txt) - 1;
+        memcpy(txt, d->data_ptr, n);
+        txt[n] = 0;
+        const char *q = strstr(txt, "\"seq\":");
+        if (q) return (int)(strtoul(q + 6, NULL, 10) & 0x7FFFFFFF);
+    }
+    return 0;
+}
+
+// runs in the websocket client's task
+static void ws_evt(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    ws_sess_t *s = (ws_sess_t *)arg;
+    switch ((esp_websocket_event_id_t)id) {
+    case WEBSOCKET_EVENT_BEFORE_CONNECT:
+        s->connect_start_us = esp_timer_get_time();
+        break;
+    case WEBSOCKET_EVENT_CONNECTED:
+        s->connect_us = esp_timer_get_time() - s->connect_start_us;
+        ack_win_link(&s->win, true);
+        s->connects++;
+        ESP_LOGI(TAG, "sink %d connected to %s", (int)(s - s_sess), s->uri);
+        break;
+    case WEBSOCKET_EVENT_DISCONNECTED:
+    case WEBSOCKET_EVENT_CLOSED:
+        if (s->win.up) {
+            s->drops++;
+            ESP_LOGW(TAG, "sink %d disconnected from %s", (int)(s - s_sess), s->uri);
+        }
+        ack_win_link(&s->win, false);
+        break;
+    case WEBSOCKET_EVENT_DATA:
+        ack_win_acked(&s->win, parse_ack((const esp_websocket_event_data_t *)data));
+        break;
+    default:
+        break;
+    }
+}
+
+// ack_win_send_t: one frame, id = its sequence number
+static int ws_send(void *ctx, const reading_t *rs, int n)
+{
+    ws_sess_t *s = (ws_sess_t *)ctx;
+    int sink = (int)(s - s_sess);
+    uint8_t *f = s_frame[sink];
+    const size_t cap = sizeof(s_frame[0]);
+    uint32_t seq = s->seq % 0x7FFFFFFF + 1;   // 1..INT32_MAX, 0 means "no ack"
+    int len, sc;
+
+    if (s->cfg.text) {
+        int h = snprintf((char *)f, cap, "{\"seq\":%u,\"batch\":", (unsigned)seq);
+        int b = s->cfg.enc(f + h, cap - h - 1, rs, n);
+        if (b < 0) return -1;
+        len = h + b;
+        f[len++] = '}';
+        sc = esp_websocket_client_send_text(s->c, (const char *)f, len, pdMS_TO_TICKS(WS_SEND_TIMEOUT_MS));
+    } else {
+        f[0] = seq & 0xFF; f[1] = (seq >> 8) & 0xFF; f[2] = (seq >> 16) & 0xFF; f[3] = seq >> 24;
+        int b = s->cfg.enc(f + 4, cap - 4, rs, n);
+        if (b < 0) return -1;
+        len = 4 + b;
+        sc = esp_websocket_client_send_bin(s->c, (const char *)f, len, pdMS_TO_TICKS(WS_SEND_TIMEOUT_MS));
+    }
+    if (sc < 0) {
+        s->send_full++;   // socket full or link down: the window waits, the queue holds the rest
+        return 0;
+    }
+    s->seq = seq;
+    s->bytes += len;
+    return (int)seq;
+}
+
+bool ws_up_open(int sink, const ws_up_cfg_t *cfg)
+{
+    if (sink < 0 || sink >= SQ_SINKS) return false;
+    ws_sess_t *s = &s_sess[sink];
+    if (s->c && strcmp(s->uri, cfg->uri) == 0) return true;
+    ws_up_close(sink);
+
+    // frames of the old connection are lost with it: resends = false
+    if (!ack_win_init(&s->win, sink, WS_WINDOW, WS_BATCH_MAX, WS_ACK_TIMEOUT_MS, false, ws_send, s)) {
+        return false;
+    }
+    strncpy(s->uri, cfg->uri, sizeof(s->uri) - 1);
+    s->cfg = *cfg;
+
+    bool tls = strncmp(cfg->uri, "wss://", 6) == 0;
+    esp_websocket_client_config_t wc = {
+        .uri = s->uri,
+        .headers = cfg->headers,
+        .crt_bundle_attach = tls ? esp_crt_bundle_attach : NULL,
+        .reconnect_timeout_ms = 5000,
+        .network_timeout_ms = 10000,
+        .ping_interval_sec = 30,   // keeps NAT state alive and notices a dead peer
+    };
+    s->c = esp_websocket_client_init(&wc);
+    if (!s->c) { ESP_LOGW(TAG, "websocket client init failed"); return false; }
+    esp_websocket_register_events(s->c, WEBSOCKET_EVENT_ANY, ws_evt, s);
+    if (esp_websocket_client_start(s->c) != ESP_OK) {
+        ESP_LOGW(TAG, "websocket client start failed");
+        esp_websocket_client_destroy(s->c);
+        s->c = NULL;
+        return false;
+    }
+    ESP_LOGI(TAG, "sink %d: streaming to %s (%s frames)", sink, s->uri, cfg->text ? "text" : "binary");
+    return true;
+}
+
+void ws_up_close(int sink)
+{
+    if (sink < 0 || sink >= SQ_SINKS) return;
+    ws_sess_t *s = &s_sess[sink];
+    if (!s->c) return;
+    esp_websocket_client_destroy(s->c);   // closes the connection and stops the client task
+    s->c = NULL;
+    s->win.up = false;
+    s->uri[0] = 0;
+    ack_win_reset(&s->win);
+}
+
+bool ws_up_connected(int sink, int wait_ms)
+{
+    if (sink < 0 || sink >= SQ_SINKS || !s_sess[sink].c) return false;
+    for (int t = 0; !s_sess[sink].win.up && t < wait_ms; t += 100) vTaskDelay(pdMS_TO_TICKS(100));
+    return s_sess[sink].win.up;
+}
+
+int ws_up_flush(int sink, int *frames)
+{
+    *frames = 0;
+    if (sink < 0 || sink >= SQ_SINKS || !s_sess[sink].c) return -1;
+    return ack_win_flush(&s_sess[sink].win, frames);
+}
+
+int64_t ws_up_rtt_us(int sink)
+{
+    if (sink < 0 || sink >= SQ_SINKS) return 0;
+    return s_sess[sink].win.ack_us_last ? s_sess[sink].win.ack_us_last : s_sess[sink].connect_us;
+}
+
+void ws_up_log_stats(int sink)
+{
+    if (sink < 0 || sink >= SQ_SINKS) return;
+    const ws_sess_t *s = &s_sess[sink];
+    const ack_win_t *w = &s->win;
+    if (!s->c && !w->sent) return;
+    ESP_LOGI(TAG, "ws %d: %s, %u frame(s) (%llu B), %u acked (avg %lld ms max %lld ms), %d in flight, %u send stall(s), %u ack timeout(s), %u connect(s), %u drop(s)",
+             sink, w->up ? "up" : "down", (unsigned)w->sent, (unsigned long long)s->bytes, (unsigned)w->acked,
+             (long long)(w->acked ? w->ack_us_total / w->acked / 1000 : 0), (long long)(w->ack_us_max / 1000),
+             w->count, (unsigned)s->send_full, (unsigned)w->timeouts, (unsigned)s->connects, (unsigned)s->drops);
+}
@@ -0,0 +1,51 @@
+//ws_up.h
+// WebSocket uplink: one long-lived connection per sink, readings streamed as frames
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "reading.h"
+
+#define WS_WINDOW          4       // frames in flight (sent, ack pending), <= ACK_WIN_MAX
+#define WS_BATCH_MAX       8       // readings per frame, <= ACK_WIN_BATCH
+#define WS_ACK_TIMEOUT_MS  10000   // ack overdue → forget the window and resend
+#define WS_SEND_TIMEOUT_MS 1000    // socket still full after this → stop sending, readings stay queued
+
+/* One frame per message of up to WS_BATCH_MAX readings:
+     binary:  seq:u32 LE | ingest_enc.h body (INGEST_FMT_BIN / INGEST_FMT_DELTA)
+     text:    {"seq":N,"batch":<ingest_enc_json body>}
+   The server acks every frame it stored with a text frame containing
+   "seq":N, or a binary frame starting with the seq. An echo server
+   therefore acks everything, which makes it a usable test stand-in. */
+
+// Encodes n readings as one body; returns its length or -1 if cap is too small
+typedef int (*ws_up_enc_t)(uint8_t *dst, size_t cap, const reading_t *rs, int n);
+
+typedef struct {
+    const char *uri;       // ws://host[:port]/path or wss://...
+    const char *headers;   // extra handshake headers, "Name: value\r\n" each, or NULL
+    bool        text;      // JSON in text frames, else binary frames
+    ws_up_enc_t enc;
+} ws_up_cfg_t;
+
+/* Starts sink's connection; esp_websocket_client reconnects on its own after
+   a drop. No-op while already open for the same uri; another uri closes the
+   old connection first. Frames in flight when the link drops are sent again
+   on the new connection (WebSocket has no resend of its own). */
+bool ws_up_open(int sink, const ws_up_cfg_t *cfg);
+void ws_up_close(int sink);
+
+// Connection up, waiting up to wait_ms for one that is still connecting
+bool ws_up_connected(int sink, int wait_ms);
+
+/* Streams sink's backlog (sample_q.h) with up to WS_WINDOW frames in flight
+   (ack_win.h) and returns once everything sent is acknowledged. Returns the
+   readings delivered, or -1 if the link dropped or an ack timed out;
+   unacknowledged readings stay queued. *frames counts the frames sent. */
+int ws_up_flush(int sink, int *frames);
+
+// Send → ack time of the last acknowledged frame, or the last connect time
+// before the first ack (0 = neither yet)
+int64_t ws_up_rtt_us(int sink);
+
+void ws_up_log_stats(int sink);